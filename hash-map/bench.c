@@ -0,0 +1,263 @@
+#define _DEFAULT_SOURCE
+#include "corpus.h"
+#include "writer.h"
+#include "hashMap.h"
+#include "tokenizer.h"
+#include "concordance.h"
+#include "profile.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#define BENCH_MAX_SIZES 32
+
+typedef struct BenchResult BenchResult;
+
+/*
+ * Measurements of one concordance run, sent from the child that counted.
+ */
+struct BenchResult
+{
+    long long words;
+    int distinct;
+    int resizes;
+    double seconds;
+};
+
+/**
+ * Counts the words of the file the way prog does, sequentially with read-ahead
+ * or with several threads over a mapping of the file.
+ * @param fileName
+ * @param threads Number of threads, or 0 to count sequentially.
+ * @param result Filled with the measurements.
+ * @return 1 on success, 0 if the file could not be read.
+ */
+static int countFile(const char *fileName, int threads, BenchResult *result)
+{
+    double start = wallSeconds();
+    HashMap *map;
+    if (threads > 0)
+    {
+        size_t length;
+        char *data = tokenizerMapFile(fileName, &length);
+        if (data == NULL)
+        {
+            return 0;
+        }
+        ConcordanceStats stats;
+        map = concordanceCountParallel(data, length, threads, &stats);
+        tokenizerUnmapFile(data, length);
+        result->words = 0;
+        for (int i = 0; i < threads; i++)
+        {
+            result->words += stats.tokens[i];
+        }
+        result->resizes = stats.resizes;
+    }
+    else
+    {
+        FILE *file = fopen(fileName, "r");
+        if (file == NULL)
+        {
+            return 0;
+        }
+        map = hashMapNew(10);
+        Tokenizer *tokenizer = tokenizerNew(file);
+        tokenizerPipeline(tokenizer, BLOCK_READER_DEPTH);
+        result->words = concordanceCount(map, tokenizer);
+        tokenizerDelete(tokenizer);
+        fclose(file);
+        result->resizes = map->resizes;
+    }
+    result->seconds = wallSeconds() - start;
+    result->distinct = hashMapSize(map);
+    hashMapDelete(map);
+    return 1;
+}
+
+/**
+ * Counts the file in a child process, so that its peak memory use is measured
+ * on its own.
+ * @param fileName
+ * @param threads
+ * @param result Filled with the measurements.
+ * @param peakKilobytes Set to the child's peak resident set size.
+ * @return 1 on success, 0 on failure.
+ */
+static int benchFile(const char *fileName, int threads, BenchResult *result,
+                     long *peakKilobytes)
+{
+    int channel[2];
+    if (pipe(channel) != 0)
+    {
+        return 0;
+    }
+    fflush(stdout);
+    pid_t child = fork();
+    if (child < 0)
+    {
+        close(channel[0]);
+        close(channel[1]);
+        return 0;
+    }
+    if (child == 0)
+    {
+        close(channel[0]);
+        BenchResult counted;
+        int ok = countFile(fileName, threads, &counted) &&
+                 write(channel[1], &counted, sizeof(counted)) == sizeof(counted);
+        _exit(ok ? 0 : 1);
+    }
+
+    close(channel[1]);
+    ssize_t got = read(channel[0], result, sizeof(BenchResult));
+    close(channel[0]);
+    int status;
+    struct rusage usage;
+    if (wait4(child, &status, 0, &usage) < 0 || !WIFEXITED(status) ||
+        WEXITSTATUS(status) != 0 || got != sizeof(BenchResult))
+    {
+        return 0;
+    }
+    *peakKilobytes = usage.ru_maxrss;
+    return 1;
+}
+
+/**
+ * Prints the command line usage.
+ * @param program
+ */
+static void printUsage(const char *program)
+{
+    fprintf(stderr, "Usage: %s [--sizes=BYTES[K|M|G],...] [--vocabulary=WORDS] [--exponent=S]\n"
+                    "           [--seed=N] [--dictionary=PATH] [-j threads]\n",
+            program);
+}
+
+/**
+ * Generates a Zipfian corpus of each of the given sizes in a temporary file,
+ * counts it with the concordance and prints a table of the word rate, peak
+ * memory and number of table resizes per size.
+ * @param argc
+ * @param argv
+ * @return 0 on success, 1 on failure.
+ */
+int main(int argc, const char **argv)
+{
+    const char *sizes = "1M,10M,100M";
+    int vocabulary = 0;
+    double exponent = 1.0;
+    unsigned long long seed = 1;
+    const char *dictionary = "dictionary.txt";
+    int threads = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strncmp(argv[i], "--sizes=", 8) == 0)
+        {
+            sizes = argv[i] + 8;
+        }
+        else if (strncmp(argv[i], "--vocabulary=", 13) == 0)
+        {
+            vocabulary = atoi(argv[i] + 13);
+        }
+        else if (strncmp(argv[i], "--exponent=", 11) == 0)
+        {
+            exponent = atof(argv[i] + 11);
+        }
+        else if (strncmp(argv[i], "--seed=", 7) == 0)
+        {
+            seed = strtoull(argv[i] + 7, NULL, 10);
+        }
+        else if (strncmp(argv[i], "--dictionary=", 13) == 0)
+        {
+            dictionary = argv[i] + 13;
+        }
+        else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+        {
+            threads = atoi(argv[++i]);
+        }
+        else
+        {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    unsigned long long bytes[BENCH_MAX_SIZES];
+    int numSizes = 0;
+    char *list = strdup(sizes);
+    for (char *size = strtok(list, ","); size != NULL; size = strtok(NULL, ","))
+    {
+        if (numSizes == BENCH_MAX_SIZES || !corpusParseSize(size, &bytes[numSizes]))
+        {
+            free(list);
+            printUsage(argv[0]);
+            return 1;
+        }
+        numSizes++;
+    }
+    free(list);
+    if (vocabulary < 0 || exponent < 0 || threads < 0 || threads > CONCORDANCE_MAX_THREADS)
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    const char *directory = getenv("TMPDIR") != NULL ? getenv("TMPDIR") : "/tmp";
+    char fileName[4096];
+    snprintf(fileName, sizeof(fileName), "%s/benchCorpusXXXXXX", directory);
+    int fd = mkstemp(fileName);
+    if (fd < 0)
+    {
+        fprintf(stderr, "Could not create a file in %s\n", directory);
+        return 1;
+    }
+    close(fd);
+
+    printf("%-12s %12s %10s %10s %14s %14s %8s\n", "Bytes", "Words", "Distinct",
+           "Seconds", "Words/sec", "Peak RSS (KB)", "Resizes");
+    int status = 0;
+    for (int i = 0; i < numSizes && status == 0; i++)
+    {
+        // Every size starts from the same seed, so smaller corpora are
+        // prefixes of larger ones.
+        Corpus *corpus = corpusNew(dictionary, vocabulary, exponent, seed);
+        FILE *file = corpus != NULL ? fopen(fileName, "w") : NULL;
+        if (file == NULL)
+        {
+            fprintf(stderr, "Could not generate the corpus from %s\n", dictionary);
+            if (corpus != NULL)
+            {
+                corpusDelete(corpus);
+            }
+            status = 1;
+            break;
+        }
+        Writer writer;
+        writerInit(&writer, file, WRITER_BUFFER_SIZE);
+        corpusWrite(corpus, &writer, bytes[i]);
+        writerCleanUp(&writer);
+        fclose(file);
+        corpusDelete(corpus);
+
+        BenchResult result;
+        long peak;
+        if (!benchFile(fileName, threads, &result, &peak))
+        {
+            fprintf(stderr, "Counting %llu bytes failed\n", bytes[i]);
+            status = 1;
+            break;
+        }
+        printf("%-12llu %12lld %10d %10.3f %14.0f %14ld %8d\n", bytes[i], result.words,
+               result.distinct, result.seconds,
+               result.seconds > 0 ? result.words / result.seconds : 0, peak,
+               result.resizes);
+    }
+    unlink(fileName);
+    return status;
+}
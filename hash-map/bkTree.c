@@ -0,0 +1,143 @@
+#include "bkTree.h"
+#include "levenshtein.h"
+#include <stdlib.h>
+#include <assert.h>
+
+/**
+ * Builds a tree over the words, inserting them in order. The words must stay
+ * valid for the life of the tree and be distinct.
+ * @param words
+ * @param numWords
+ * @return The tree.
+ */
+BkTree *bkTreeNew(const char *const *words, int numWords)
+{
+    assert(words != NULL || numWords == 0);
+    BkTree *tree = malloc(sizeof(BkTree));
+    tree->words = words;
+    tree->numWords = numWords;
+    tree->root = numWords > 0 ? 0 : -1;
+    tree->firstChild = malloc(sizeof(int) * (numWords + 1));
+    tree->nextSibling = malloc(sizeof(int) * (numWords + 1));
+    tree->edge = malloc(sizeof(int) * (numWords + 1));
+    for (int i = 0; i < numWords; i++)
+    {
+        tree->firstChild[i] = -1;
+        tree->nextSibling[i] = -1;
+        tree->edge[i] = 0;
+    }
+
+    for (int i = 1; i < numWords; i++)
+    {
+        int node = tree->root;
+        while (1)
+        {
+            int distance = levenshteinDistance(words[i], words[node]);
+            int child = tree->firstChild[node];
+            while (child >= 0 && tree->edge[child] != distance)
+            {
+                child = tree->nextSibling[child];
+            }
+            if (child < 0)
+            {
+                tree->edge[i] = distance;
+                tree->nextSibling[i] = tree->firstChild[node];
+                tree->firstChild[node] = i;
+                break;
+            }
+            node = child;
+        }
+    }
+    return tree;
+}
+
+/**
+ * Frees the tree. Does not free the words.
+ * @param tree
+ */
+void bkTreeDelete(BkTree *tree)
+{
+    assert(tree != NULL);
+    free(tree->firstChild);
+    free(tree->nextSibling);
+    free(tree->edge);
+    free(tree);
+}
+
+/**
+ * Finds every word within the given distance of the query.
+ * @param tree
+ * @param word
+ * @param maxDistance
+ * @param matches Set to an allocated array of the words found, in no
+ *                particular order, to be freed by the caller.
+ * @param visited If not NULL, incremented by the number of distances computed.
+ * @return Number of words found.
+ */
+int bkTreeSearch(BkTree *tree, const char *word, int maxDistance,
+                 Suggestion **matches, long long *visited)
+{
+    assert(tree != NULL);
+    assert(word != NULL);
+    int capacity = 16;
+    int found = 0;
+    *matches = malloc(sizeof(Suggestion) * capacity);
+    if (tree->root < 0)
+    {
+        return 0;
+    }
+
+    int stackCapacity = 64;
+    int *stack = malloc(sizeof(int) * stackCapacity);
+    int depth = 0;
+    stack[depth++] = tree->root;
+    long long computed = 0;
+    while (depth > 0)
+    {
+        // Children are only reached within maxDistance of their edge, so the
+        // distance is not needed beyond the largest edge plus maxDistance.
+        int node = stack[--depth];
+        int largestEdge = 0;
+        for (int child = tree->firstChild[node]; child >= 0; child = tree->nextSibling[child])
+        {
+            largestEdge = tree->edge[child] > largestEdge ? tree->edge[child] : largestEdge;
+        }
+        int limit = largestEdge + maxDistance;
+        int distance = levenshteinBounded(word, tree->words[node], limit);
+        computed++;
+        if (distance > limit)
+        {
+            continue;
+        }
+        if (distance <= maxDistance)
+        {
+            if (found == capacity)
+            {
+                capacity *= 2;
+                *matches = realloc(*matches, sizeof(Suggestion) * capacity);
+            }
+            (*matches)[found].word = node;
+            (*matches)[found].distance = distance;
+            found++;
+        }
+        for (int child = tree->firstChild[node]; child >= 0; child = tree->nextSibling[child])
+        {
+            if (tree->edge[child] >= distance - maxDistance &&
+                tree->edge[child] <= distance + maxDistance)
+            {
+                if (depth == stackCapacity)
+                {
+                    stackCapacity *= 2;
+                    stack = realloc(stack, sizeof(int) * stackCapacity);
+                }
+                stack[depth++] = child;
+            }
+        }
+    }
+    free(stack);
+    if (visited != NULL)
+    {
+        *visited += computed;
+    }
+    return found;
+}
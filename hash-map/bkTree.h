@@ -0,0 +1,32 @@
+#ifndef BK_TREE_H
+#define BK_TREE_H
+
+#include "suggest.h"
+
+typedef struct BkTree BkTree;
+
+/*
+ * A Burkhard-Keller tree over a list of words under the Levenshtein distance.
+ * Each child hangs off its parent by its distance to it, so by the triangle
+ * inequality a search for words within k of a query only descends into the
+ * children whose edge is within k of the query's distance to their parent.
+ * Node i is word i; children are kept as linked lists in arrays.
+ */
+struct BkTree
+{
+    const char *const *words;
+    int numWords;
+    int root;
+    // First child and next sibling of each node, -1 for none.
+    int *firstChild;
+    int *nextSibling;
+    // Distance of each node to its parent.
+    int *edge;
+};
+
+BkTree *bkTreeNew(const char *const *words, int numWords);
+void bkTreeDelete(BkTree *tree);
+int bkTreeSearch(BkTree *tree, const char *word, int maxDistance,
+                 Suggestion **matches, long long *visited);
+
+#endif
@@ -0,0 +1,237 @@
+#define _POSIX_C_SOURCE 200809L
+#include "blockReader.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+
+/**
+ * Fills a block from the file, with pread at the reader's offset when the
+ * file supports it and with read otherwise (pipes, terminals).
+ * @param reader
+ * @param block
+ * @return Number of bytes read, 0 at the end of the file, -1 on error.
+ */
+static ssize_t readBlock(BlockReader *reader, char *block)
+{
+    size_t filled = 0;
+    while (filled < reader->blockSize)
+    {
+        ssize_t got;
+        if (reader->offset >= 0)
+        {
+            got = pread(reader->fd, block + filled, reader->blockSize - filled,
+                        (off_t)reader->offset);
+        }
+        else
+        {
+            got = read(reader->fd, block + filled, reader->blockSize - filled);
+        }
+        if (got < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (got < 0)
+        {
+            return filled > 0 ? (ssize_t)filled : -1;
+        }
+        if (got == 0)
+        {
+            break;
+        }
+        filled += (size_t)got;
+        if (reader->offset >= 0)
+        {
+            reader->offset += got;
+        }
+        else
+        {
+            // A pipe returns whatever is available. Keep filling the block
+            // while the consumer has other blocks to work on, but hand it over
+            // as soon as the consumer runs dry.
+            pthread_mutex_lock(&reader->lock);
+            int starving = reader->count == 0;
+            pthread_mutex_unlock(&reader->lock);
+            if (starving)
+            {
+                break;
+            }
+        }
+    }
+    return (ssize_t)filled;
+}
+
+/**
+ * Body of the reader thread: fills free blocks in ring order until the end of
+ * the file, an error, or a stop request.
+ * @param argument The BlockReader.
+ */
+static void *readerThread(void *argument)
+{
+    BlockReader *reader = argument;
+    pthread_mutex_lock(&reader->lock);
+    while (!reader->stop)
+    {
+        if (reader->count == reader->depth)
+        {
+            pthread_cond_wait(&reader->notFull, &reader->lock);
+            continue;
+        }
+
+        // The tail block is not visible to the consumer until count grows, so
+        // it is filled without holding the lock.
+        int tail = (reader->head + reader->count) % reader->depth;
+        pthread_mutex_unlock(&reader->lock);
+        ssize_t got = readBlock(reader, reader->blocks[tail]);
+        int error = got < 0 ? errno : 0;
+        pthread_mutex_lock(&reader->lock);
+
+        if (got <= 0)
+        {
+            reader->error = error;
+            break;
+        }
+        reader->lengths[tail] = (size_t)got;
+        reader->count++;
+        pthread_cond_signal(&reader->notEmpty);
+    }
+    reader->done = 1;
+    pthread_cond_signal(&reader->notEmpty);
+    pthread_mutex_unlock(&reader->lock);
+    return NULL;
+}
+
+/**
+ * Frees the reader's blocks and synchronization objects.
+ * @param reader
+ */
+static void blockReaderFree(BlockReader *reader)
+{
+    pthread_mutex_destroy(&reader->lock);
+    pthread_cond_destroy(&reader->notEmpty);
+    pthread_cond_destroy(&reader->notFull);
+    for (int i = 0; i < reader->depth; i++)
+    {
+        free(reader->blocks[i]);
+    }
+    free(reader->blocks);
+    free(reader->lengths);
+    free(reader);
+}
+
+/**
+ * Starts reading the file from its current offset on a new thread. The
+ * descriptor must not be read by anyone else until the reader is deleted.
+ * @param fd
+ * @param blockSize Size of each block in bytes.
+ * @param depth Number of blocks, at least 2: one being consumed while the
+ *              others are being read.
+ * @return The reader, or NULL if the thread could not be started.
+ */
+BlockReader *blockReaderNew(int fd, size_t blockSize, int depth)
+{
+    assert(fd >= 0);
+    assert(blockSize > 0);
+    assert(depth >= 2);
+    BlockReader *reader = malloc(sizeof(BlockReader));
+    reader->fd = fd;
+    off_t offset = lseek(fd, 0, SEEK_CUR);
+    reader->offset = offset < 0 ? -1 : (long long)offset;
+    if (reader->offset >= 0)
+    {
+        posix_fadvise(fd, offset, 0, POSIX_FADV_SEQUENTIAL);
+    }
+    reader->blockSize = blockSize;
+    reader->depth = depth;
+    reader->blocks = malloc(sizeof(char *) * depth);
+    reader->lengths = malloc(sizeof(size_t) * depth);
+    for (int i = 0; i < depth; i++)
+    {
+        reader->blocks[i] = malloc(blockSize);
+        reader->lengths[i] = 0;
+    }
+    reader->head = 0;
+    reader->count = 0;
+    reader->consumed = 0;
+    reader->done = 0;
+    reader->stop = 0;
+    reader->error = 0;
+    pthread_mutex_init(&reader->lock, NULL);
+    pthread_cond_init(&reader->notEmpty, NULL);
+    pthread_cond_init(&reader->notFull, NULL);
+    if (pthread_create(&reader->thread, NULL, readerThread, reader) != 0)
+    {
+        blockReaderFree(reader);
+        return NULL;
+    }
+    return reader;
+}
+
+/**
+ * Stops the reader thread and frees the reader. Does not close the file.
+ * @param reader
+ */
+void blockReaderDelete(BlockReader *reader)
+{
+    assert(reader != NULL);
+    pthread_mutex_lock(&reader->lock);
+    reader->stop = 1;
+    pthread_cond_signal(&reader->notFull);
+    pthread_mutex_unlock(&reader->lock);
+    pthread_join(reader->thread, NULL);
+    blockReaderFree(reader);
+}
+
+/**
+ * Copies up to length bytes of the file into destination, waiting for the
+ * reader thread if no block is full yet.
+ * @param reader
+ * @param destination
+ * @param length
+ * @return Number of bytes copied, 0 at the end of the file or after a failed
+ *         read, which leaves error set.
+ */
+size_t blockReaderRead(BlockReader *reader, char *destination, size_t length)
+{
+    assert(reader != NULL);
+    assert(destination != NULL);
+    size_t copied = 0;
+    pthread_mutex_lock(&reader->lock);
+    while (copied < length)
+    {
+        if (reader->count == 0)
+        {
+            // Return what we have rather than waiting for more.
+            if (reader->done || copied > 0)
+            {
+                break;
+            }
+            pthread_cond_wait(&reader->notEmpty, &reader->lock);
+            continue;
+        }
+
+        // The head block belongs to the consumer until count shrinks.
+        int head = reader->head;
+        size_t available = reader->lengths[head] - reader->consumed;
+        size_t take = available < length - copied ? available : length - copied;
+        pthread_mutex_unlock(&reader->lock);
+        memcpy(destination + copied, reader->blocks[head] + reader->consumed,
+               take);
+        pthread_mutex_lock(&reader->lock);
+
+        copied += take;
+        reader->consumed += take;
+        if (reader->consumed == reader->lengths[head])
+        {
+            reader->head = (head + 1) % reader->depth;
+            reader->count--;
+            reader->consumed = 0;
+            pthread_cond_signal(&reader->notFull);
+        }
+    }
+    pthread_mutex_unlock(&reader->lock);
+    return copied;
+}
@@ -0,0 +1,49 @@
+#ifndef BLOCK_READER_H
+#define BLOCK_READER_H
+
+#include <stddef.h>
+#include <pthread.h>
+
+#define BLOCK_READER_BLOCK_SIZE (1 << 20)
+#define BLOCK_READER_DEPTH 3
+
+typedef struct BlockReader BlockReader;
+
+/*
+ * Reads a file on a dedicated thread into a ring of large blocks, so the disk
+ * keeps reading while the consumer tokenizes and hashes. The blocks form a
+ * bounded queue: the reader waits when all of them are full and the consumer
+ * waits when all of them are empty.
+ */
+struct BlockReader
+{
+    int fd;
+    // Input offset of the next read, or -1 if the file does not support pread.
+    long long offset;
+    // Ring of depth blocks of blockSize bytes and the number of bytes in each.
+    char **blocks;
+    size_t *lengths;
+    size_t blockSize;
+    int depth;
+    // Index of the first full block, number of full blocks, and number of
+    // bytes of the first full block already consumed.
+    int head;
+    int count;
+    size_t consumed;
+    // 1 once the reader reached the end of the file or failed.
+    int done;
+    // 1 when the consumer asks the reader to stop early.
+    int stop;
+    // errno of a failed read, 0 if none.
+    int error;
+    pthread_mutex_t lock;
+    pthread_cond_t notEmpty;
+    pthread_cond_t notFull;
+    pthread_t thread;
+};
+
+BlockReader *blockReaderNew(int fd, size_t blockSize, int depth);
+void blockReaderDelete(BlockReader *reader);
+size_t blockReaderRead(BlockReader *reader, char *destination, size_t length);
+
+#endif
@@ -0,0 +1,467 @@
+#define _POSIX_C_SOURCE 200809L
+#include "checkpoint.h"
+#include "tokenizer.h"
+#include "writer.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+
+/*
+ * Checkpoint file layout. All integers are varints (7 bits per byte, low bits
+ * first) and strings are a varint length followed by the bytes:
+ *
+ *   magic "CONCKPT1"
+ *   number of files, then for each: name, offset, tail
+ *   number of words, then for each: word, count
+ */
+#define CHECKPOINT_MAGIC "CONCKPT1"
+#define CHECKPOINT_MAGIC_LENGTH 8
+
+/**
+ * Creates an empty checkpoint: no words counted and no files seen.
+ * @return The allocated checkpoint.
+ */
+Checkpoint *checkpointNew(void)
+{
+    Checkpoint *checkpoint = malloc(sizeof(Checkpoint));
+    checkpoint->map = hashMapNew(10);
+    checkpoint->capacity = 4;
+    checkpoint->numFiles = 0;
+    checkpoint->files = malloc(sizeof(CheckpointFile) * checkpoint->capacity);
+    return checkpoint;
+}
+
+/**
+ * Frees the checkpoint, its map and its file records.
+ * @param checkpoint
+ */
+void checkpointDelete(Checkpoint *checkpoint)
+{
+    for (int i = 0; i < checkpoint->numFiles; i++)
+    {
+        free(checkpoint->files[i].name);
+        free(checkpoint->files[i].tail);
+    }
+    free(checkpoint->files);
+    hashMapDelete(checkpoint->map);
+    free(checkpoint);
+}
+
+static char *copyString(const char *string, size_t length)
+{
+    char *copy = malloc(length + 1);
+    memcpy(copy, string, length);
+    copy[length] = '\0';
+    return copy;
+}
+
+/**
+ * Returns the record of the named file, adding one with nothing counted if
+ * the file has not been seen.
+ * @param checkpoint
+ * @param name
+ * @return File record.
+ */
+static CheckpointFile *checkpointFile(Checkpoint *checkpoint, const char *name)
+{
+    for (int i = 0; i < checkpoint->numFiles; i++)
+    {
+        if (strcmp(checkpoint->files[i].name, name) == 0)
+        {
+            return &checkpoint->files[i];
+        }
+    }
+    if (checkpoint->numFiles == checkpoint->capacity)
+    {
+        checkpoint->capacity *= 2;
+        checkpoint->files = realloc(checkpoint->files,
+                                    sizeof(CheckpointFile) * checkpoint->capacity);
+    }
+    CheckpointFile *file = &checkpoint->files[checkpoint->numFiles++];
+    file->name = copyString(name, strlen(name));
+    file->offset = 0;
+    file->tail = copyString("", 0);
+    return file;
+}
+
+static void writeVarint(Writer *writer, unsigned long long value)
+{
+    while (value >= 0x80)
+    {
+        writerChar(writer, (char)(value | 0x80));
+        value >>= 7;
+    }
+    writerChar(writer, (char)value);
+}
+
+static void writeBytes(Writer *writer, const char *string)
+{
+    size_t length = strlen(string);
+    writeVarint(writer, length);
+    writerString(writer, string, length);
+}
+
+/**
+ * Writes the checkpoint atomically: it is written to a temporary file next to
+ * the target, flushed to disk and renamed over the target, and the directory
+ * is flushed too, so a crash leaves either the old or the new checkpoint,
+ * never a partial one.
+ * @param checkpoint
+ * @param path
+ * @return 1 on success, 0 on failure.
+ */
+int checkpointSave(Checkpoint *checkpoint, const char *path)
+{
+    size_t pathLength = strlen(path);
+    char *temporary = malloc(pathLength + 5);
+    memcpy(temporary, path, pathLength);
+    strcpy(temporary + pathLength, ".tmp");
+    FILE *file = fopen(temporary, "wb");
+    if (file == NULL)
+    {
+        free(temporary);
+        return 0;
+    }
+
+    Writer writer;
+    writerInit(&writer, file, WRITER_BUFFER_SIZE);
+    writerString(&writer, CHECKPOINT_MAGIC, CHECKPOINT_MAGIC_LENGTH);
+    writeVarint(&writer, checkpoint->numFiles);
+    for (int i = 0; i < checkpoint->numFiles; i++)
+    {
+        writeBytes(&writer, checkpoint->files[i].name);
+        writeVarint(&writer, checkpoint->files[i].offset);
+        writeBytes(&writer, checkpoint->files[i].tail);
+    }
+    HashMap *map = checkpoint->map;
+    writeVarint(&writer, hashMapSize(map));
+    for (int i = 0; i < hashMapCapacity(map); i++)
+    {
+        for (HashLink *link = map->table[i]; link != NULL; link = link->next)
+        {
+            writeBytes(&writer, link->key);
+            writeVarint(&writer, (unsigned int)link->value);
+        }
+    }
+    writerCleanUp(&writer);
+
+    int ok = !ferror(file) && fsync(fileno(file)) == 0;
+    ok = fclose(file) == 0 && ok;
+    ok = ok && writerReplaceFile(temporary, path);
+    if (!ok)
+    {
+        remove(temporary);
+    }
+    free(temporary);
+    return ok;
+}
+
+/*
+ * Read position in a loaded checkpoint. Reads past the end set failed.
+ */
+typedef struct Reader
+{
+    const unsigned char *data;
+    size_t length;
+    size_t at;
+    int failed;
+} Reader;
+
+static unsigned long long readVarint(Reader *reader)
+{
+    unsigned long long value = 0;
+    int shift = 0;
+    while (reader->at < reader->length && shift < 64)
+    {
+        unsigned char byte = reader->data[reader->at++];
+        value |= (unsigned long long)(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+        {
+            return value;
+        }
+        shift += 7;
+    }
+    reader->failed = 1;
+    return 0;
+}
+
+/**
+ * Reads a string and returns a pointer to its bytes in the loaded data.
+ * @param reader
+ * @param length Set to the string length.
+ * @return Pointer to the bytes, or NULL past the end.
+ */
+static const char *readBytes(Reader *reader, size_t *length)
+{
+    *length = readVarint(reader);
+    if (reader->failed || *length > reader->length - reader->at)
+    {
+        reader->failed = 1;
+        return NULL;
+    }
+    const char *bytes = (const char *)reader->data + reader->at;
+    reader->at += *length;
+    return bytes;
+}
+
+/**
+ * Loads a checkpoint saved with checkpointSave. The file is read in one go
+ * and parsed in memory, and the map is sized for all words up front, so
+ * loading takes time proportional to the checkpoint, not to the corpus.
+ * @param path
+ * @return The loaded checkpoint, a new empty checkpoint if the file does not
+ * exist, or NULL if it is not a valid checkpoint.
+ */
+Checkpoint *checkpointLoad(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        return checkpointNew();
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    rewind(file);
+    unsigned char *data = malloc(size > 0 ? size : 1);
+    size_t read = fread(data, 1, size, file);
+    fclose(file);
+
+    Reader reader = {data, read, 0, 0};
+    if (read < CHECKPOINT_MAGIC_LENGTH ||
+        memcmp(data, CHECKPOINT_MAGIC, CHECKPOINT_MAGIC_LENGTH) != 0)
+    {
+        free(data);
+        return NULL;
+    }
+    reader.at = CHECKPOINT_MAGIC_LENGTH;
+
+    Checkpoint *checkpoint = checkpointNew();
+    unsigned long long numFiles = readVarint(&reader);
+    for (unsigned long long i = 0; i < numFiles && !reader.failed; i++)
+    {
+        size_t nameLength;
+        size_t tailLength;
+        const char *name = readBytes(&reader, &nameLength);
+        unsigned long long offset = readVarint(&reader);
+        const char *tail = readBytes(&reader, &tailLength);
+        if (reader.failed)
+        {
+            break;
+        }
+        char *nameCopy = copyString(name, nameLength);
+        CheckpointFile *record = checkpointFile(checkpoint, nameCopy);
+        free(nameCopy);
+        record->offset = offset;
+        free(record->tail);
+        record->tail = copyString(tail, tailLength);
+    }
+
+    unsigned long long numWords = readVarint(&reader);
+    if (!reader.failed && numWords <= reader.length)
+    {
+        hashMapDelete(checkpoint->map);
+        checkpoint->map = hashMapNew((int)(numWords / MAX_TABLE_LOAD) + 1);
+    }
+    char *word = NULL;
+    size_t wordCapacity = 0;
+    for (unsigned long long i = 0; i < numWords && !reader.failed; i++)
+    {
+        size_t length;
+        const char *bytes = readBytes(&reader, &length);
+        int count = (int)readVarint(&reader);
+        if (reader.failed)
+        {
+            break;
+        }
+        if (length + 1 > wordCapacity)
+        {
+            wordCapacity = 2 * (length + 1);
+            word = realloc(word, wordCapacity);
+        }
+        memcpy(word, bytes, length);
+        word[length] = '\0';
+        hashMapPut(checkpoint->map, word, count);
+    }
+    free(word);
+    free(data);
+
+    if (reader.failed)
+    {
+        checkpointDelete(checkpoint);
+        return NULL;
+    }
+    return checkpoint;
+}
+
+/**
+ * Turns upper case letters into lower case in place, as the tokenizer does.
+ * @param bytes
+ * @param length
+ */
+static void foldCase(char *bytes, size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        if (bytes[i] >= 'A' && bytes[i] <= 'Z')
+        {
+            bytes[i] += 'a' - 'A';
+        }
+    }
+}
+
+/**
+ * Checks that the file still holds the saved tail word at the saved offset,
+ * which catches most files rewritten rather than appended to.
+ * @param fp
+ * @param record
+ * @param fold 1 if the tail was case folded when it was saved.
+ * @return 1 if the tail is unchanged, 0 otherwise.
+ */
+static int checkpointTailMatches(FILE *fp, CheckpointFile *record, int fold)
+{
+    size_t length = strlen(record->tail);
+    if (length == 0)
+    {
+        return 1;
+    }
+    char *bytes = malloc(length + 1);
+    int matches = pread(fileno(fp), bytes, length, (off_t)record->offset) == (ssize_t)length;
+    if (matches && fold)
+    {
+        foldCase(bytes, length);
+    }
+    matches = matches && memcmp(bytes, record->tail, length) == 0;
+    free(bytes);
+    return matches;
+}
+
+/**
+ * Adds the count of the word to the map, adding the word if it is not in it.
+ * @param map
+ * @param word
+ * @param count
+ */
+static void addCount(HashMap *map, const char *word, int count)
+{
+    int *value = hashMapGet(map, word);
+    if (value != NULL)
+    {
+        *value += count;
+    }
+    else
+    {
+        hashMapPut(map, word, count);
+    }
+}
+
+/**
+ * Counts the bytes of the file that were not counted yet into the checkpoint
+ * and records the new progress. The tail word of the previous run is taken
+ * back out first and counted again along with whatever was appended to it.
+ * The new words are counted apart and only added once the whole file was
+ * read, so a file that fails leaves the checkpoint as it was.
+ * @param checkpoint
+ * @param name
+ * @return Number of words counted, or -1 if the file could not be read, is
+ * shorter than when it was last counted or no longer holds the tail word.
+ */
+long long checkpointCountFile(Checkpoint *checkpoint, const char *name)
+{
+    FILE *fp = fopen(name, "r");
+    if (fp == NULL)
+    {
+        return -1;
+    }
+    CheckpointFile *record = checkpointFile(checkpoint, name);
+    Tokenizer tokenizer;
+    tokenizerInit(&tokenizer, fp, TOKENIZER_BLOCK_SIZE);
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    if (size < 0 || (unsigned long long)size < record->offset + strlen(record->tail) ||
+        !checkpointTailMatches(fp, record, tokenizer.foldCase) ||
+        !tokenizerSeek(&tokenizer, record->offset))
+    {
+        tokenizerCleanUp(&tokenizer);
+        fclose(fp);
+        return -1;
+    }
+
+    HashMap *counts = hashMapNew(1024);
+    char *word;
+    int length;
+    long long words = 0;
+    unsigned long long lastStart = record->offset;
+    unsigned long long lastEnd = record->offset;
+    while (tokenizerNext(&tokenizer, &word, &length))
+    {
+        addCount(counts, word, 1);
+        lastStart = tokenizer.offset + (unsigned long long)(word - tokenizer.buffer);
+        lastEnd = lastStart + length;
+        words++;
+    }
+    unsigned long long end = tokenizer.offset + tokenizer.length;
+    int error = tokenizer.error;
+    int fold = tokenizer.foldCase;
+    tokenizerCleanUp(&tokenizer);
+    if (error != 0)
+    {
+        hashMapDelete(counts);
+        fclose(fp);
+        return -1;
+    }
+
+    char *tail;
+    unsigned long long offset;
+    if (words > 0 && lastEnd == end)
+    {
+        // The last word runs into the end of the file and may continue. It is
+        // no longer buffered, so read it back and fold it as the tokenizer
+        // did, to match the word that was counted.
+        // A tail that cannot be read back fails the file: recording none
+        // would count the word again in full on the next run.
+        size_t tailLength = lastEnd - lastStart;
+        offset = lastStart;
+        tail = malloc(tailLength + 1);
+        if (pread(fileno(fp), tail, tailLength, (off_t)lastStart) != (ssize_t)tailLength)
+        {
+            free(tail);
+            hashMapDelete(counts);
+            fclose(fp);
+            return -1;
+        }
+        tail[tailLength] = '\0';
+        if (fold)
+        {
+            foldCase(tail, tailLength);
+        }
+    }
+    else
+    {
+        offset = end;
+        tail = copyString("", 0);
+    }
+    fclose(fp);
+
+    if (record->tail[0] != '\0')
+    {
+        int *count = hashMapGet(checkpoint->map, record->tail);
+        if (count != NULL && --(*count) == 0)
+        {
+            hashMapRemove(checkpoint->map, record->tail);
+        }
+    }
+    for (int i = 0; i < hashMapCapacity(counts); i++)
+    {
+        for (HashLink *link = counts->table[i]; link != NULL; link = link->next)
+        {
+            addCount(checkpoint->map, link->key, link->value);
+        }
+    }
+    hashMapDelete(counts);
+    free(record->tail);
+    record->tail = tail;
+    record->offset = offset;
+    return words;
+}
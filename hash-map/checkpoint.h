@@ -0,0 +1,41 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "hashMap.h"
+
+typedef struct CheckpointFile CheckpointFile;
+typedef struct Checkpoint Checkpoint;
+
+/*
+ * How far an input file has been counted. A word running up to the end of the
+ * file may continue when the file grows, so it is counted but remembered as
+ * the tail, and counting resumes from its start.
+ */
+struct CheckpointFile
+{
+    char *name;
+    // Bytes counted, not including the tail.
+    unsigned long long offset;
+    // Word counted at the end of the file, or an empty string.
+    char *tail;
+};
+
+/*
+ * A concordance together with the progress through each input file, saved
+ * between runs so only newly appended bytes have to be counted.
+ */
+struct Checkpoint
+{
+    HashMap *map;
+    CheckpointFile *files;
+    int numFiles;
+    int capacity;
+};
+
+Checkpoint *checkpointNew(void);
+void checkpointDelete(Checkpoint *checkpoint);
+Checkpoint *checkpointLoad(const char *path);
+int checkpointSave(Checkpoint *checkpoint, const char *path);
+long long checkpointCountFile(Checkpoint *checkpoint, const char *name);
+
+#endif
@@ -0,0 +1,308 @@
+#define _POSIX_C_SOURCE 200809L
+#include "concordance.h"
+#include "profile.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+
+/**
+ * Increments the count of the given word, adding it with a count of 1 if it
+ * is not in the map yet.
+ * @param map
+ * @param word
+ * @return The new count of the word.
+ */
+int concordanceAdd(HashMap *map, const char *word)
+{
+    int *value = hashMapGet(map, word);
+    if (value != NULL)
+    {
+        return ++(*value);
+    }
+    hashMapPut(map, word, 1);
+    return 1;
+}
+
+/**
+ * Counts every word the tokenizer yields into the map.
+ * @param map
+ * @param tokenizer
+ * @return Number of words counted.
+ */
+long long concordanceCount(HashMap *map, Tokenizer *tokenizer)
+{
+    char *word;
+    int length;
+    long long tokens = 0;
+    while (tokenizerNext(tokenizer, &word, &length))
+    {
+        concordanceAdd(map, word);
+        tokens++;
+    }
+    return tokens;
+}
+
+// Initial capacity of the thread-local maps. They only ever double, so every
+// local map and the result map have capacities that are multiples of it.
+#define LOCAL_CAPACITY 1024
+
+typedef struct CountTask CountTask;
+typedef struct MergeTask MergeTask;
+
+/*
+ * A chunk of the input counted by one thread into its own map.
+ */
+struct CountTask
+{
+    char *data;
+    size_t length;
+    HashMap *map;
+    long long tokens;
+    double seconds;
+};
+
+/*
+ * A range of bucket numbers modulo LOCAL_CAPACITY, read from all the
+ * thread-local maps and filled in the result map by one thread.
+ */
+struct MergeTask
+{
+    HashMap *result;
+    CountTask *counts;
+    int numCounts;
+    int first;
+    int last;
+    int created;
+};
+
+static void *countChunk(void *arg)
+{
+    CountTask *task = arg;
+    double start = wallSeconds();
+    Tokenizer tokenizer;
+    tokenizerInitBuffer(&tokenizer, task->data, task->length);
+    task->map = hashMapNew(LOCAL_CAPACITY);
+    task->tokens = concordanceCount(task->map, &tokenizer);
+    tokenizerCleanUp(&tokenizer);
+    task->seconds = wallSeconds() - start;
+    return NULL;
+}
+
+static void *mergeRange(void *arg)
+{
+    MergeTask *task = arg;
+    task->created = 0;
+    for (int i = 0; i < task->numCounts; i++)
+    {
+        task->created += hashMapMergeRange(task->result, task->counts[i].map, LOCAL_CAPACITY,
+                                           task->first, task->last);
+    }
+    return NULL;
+}
+
+/**
+ * Builds the concordance of a memory range with several threads. The range is
+ * split at word boundaries into one chunk per thread, and each chunk is
+ * counted into a thread-local map. The result map is then sized for all the
+ * distinct words up front and filled in parallel. All the capacities are
+ * multiples of LOCAL_CAPACITY, and each thread owns a range of bucket numbers
+ * modulo it: it reads only those buckets of each local map and writes only
+ * those of the result, so no locking is needed in either phase and each
+ * thread merges only its share of the words.
+ * @param data Writable input, with a spare byte at data[length].
+ * @param length
+ * @param threads Number of threads, at most CONCORDANCE_MAX_THREADS.
+ * @param stats Filled with timing information if not NULL.
+ * @return The concordance map.
+ */
+HashMap *concordanceCountParallel(char *data, size_t length, int threads,
+                                  ConcordanceStats *stats)
+{
+    assert(data != NULL);
+    assert(threads > 0 && threads <= CONCORDANCE_MAX_THREADS);
+
+    CountTask counts[CONCORDANCE_MAX_THREADS];
+    MergeTask merges[CONCORDANCE_MAX_THREADS];
+    pthread_t workers[CONCORDANCE_MAX_THREADS];
+
+    // Count phase
+    double start = wallSeconds();
+    size_t from = 0;
+    for (int i = 0; i < threads; i++)
+    {
+        size_t to = i == threads - 1 ? length
+                                     : tokenizerBoundary(data, length, length / threads * (i + 1));
+        if (to < from)
+        {
+            to = from;
+        }
+        counts[i].data = data + from;
+        counts[i].length = to - from;
+        pthread_create(&workers[i], NULL, countChunk, &counts[i]);
+        from = to;
+    }
+    int distinct = 0;
+    for (int i = 0; i < threads; i++)
+    {
+        pthread_join(workers[i], NULL);
+        distinct += hashMapSize(counts[i].map);
+    }
+    double countEnd = wallSeconds();
+
+    // Merge phase. Sizing for the sum of the local sizes keeps the table load
+    // under MAX_TABLE_LOAD, so the merged map never has to resize.
+    int capacity = LOCAL_CAPACITY;
+    while (capacity < distinct / MAX_TABLE_LOAD + 1)
+    {
+        capacity *= 2;
+    }
+    HashMap *result = hashMapNew(capacity);
+    for (int i = 0; i < threads; i++)
+    {
+        merges[i].result = result;
+        merges[i].counts = counts;
+        merges[i].numCounts = threads;
+        merges[i].first = LOCAL_CAPACITY * i / threads;
+        merges[i].last = LOCAL_CAPACITY * (i + 1) / threads;
+        pthread_create(&workers[i], NULL, mergeRange, &merges[i]);
+    }
+    for (int i = 0; i < threads; i++)
+    {
+        pthread_join(workers[i], NULL);
+        result->size += merges[i].created;
+    }
+    double mergeEnd = wallSeconds();
+
+    if (stats != NULL)
+    {
+        stats->threads = threads;
+        for (int i = 0; i < threads; i++)
+        {
+            stats->tokens[i] = counts[i].tokens;
+            stats->countSeconds[i] = counts[i].seconds;
+        }
+        stats->countPhaseSeconds = countEnd - start;
+        stats->mergeSeconds = mergeEnd - countEnd;
+        stats->resizes = result->resizes;
+        for (int i = 0; i < threads; i++)
+        {
+            stats->resizes += counts[i].map->resizes;
+        }
+    }
+
+    for (int i = 0; i < threads; i++)
+    {
+        hashMapDelete(counts[i].map);
+    }
+    return result;
+}
+
+/**
+ * Prints the per-thread throughput of a parallel run and how well the count
+ * phase scaled: the efficiency is the total busy time of the threads divided
+ * by the time all threads were available.
+ * @param stats
+ */
+void concordancePrintStats(ConcordanceStats *stats)
+{
+    long long tokens = 0;
+    double busy = 0;
+    printf("\nScaling report (%d threads)\n", stats->threads);
+    printf("%-8s %14s %12s %16s\n", "Thread", "Words", "Seconds", "Words/sec");
+    for (int i = 0; i < stats->threads; i++)
+    {
+        double seconds = stats->countSeconds[i];
+        printf("%-8d %14lld %12.6f %16.0f\n", i, stats->tokens[i], seconds,
+               seconds > 0 ? stats->tokens[i] / seconds : 0);
+        tokens += stats->tokens[i];
+        busy += seconds;
+    }
+    double total = stats->countPhaseSeconds + stats->mergeSeconds;
+    printf("Count phase: %f seconds\n", stats->countPhaseSeconds);
+    printf("Merge phase: %f seconds\n", stats->mergeSeconds);
+    printf("Table resizes: %d\n", stats->resizes);
+    printf("Words/sec: %.0f\n", total > 0 ? tokens / total : 0);
+    printf("Count efficiency: %.1f%%\n",
+           stats->countPhaseSeconds > 0
+               ? 100 * busy / (stats->threads * stats->countPhaseSeconds)
+               : 100);
+}
+
+/**
+ * Initializes an empty list tracking the given number of most frequent words.
+ * @param top
+ * @param capacity Number of words to track.
+ */
+void topWordsInit(TopWords *top, int capacity)
+{
+    assert(capacity > 0);
+    top->entries = malloc(sizeof(TopWord) * capacity);
+    top->size = 0;
+    top->capacity = capacity;
+}
+
+/**
+ * Frees the words and the entry array of the list.
+ * @param top
+ */
+void topWordsCleanUp(TopWords *top)
+{
+    for (int i = 0; i < top->size; i++)
+    {
+        free(top->entries[i].word);
+    }
+    free(top->entries);
+    top->entries = NULL;
+    top->size = 0;
+}
+
+/**
+ * Records the new count of a word. Counts must only ever grow. Entries are
+ * kept sorted by count, so a word whose count does not beat the smallest
+ * tracked count is rejected with a single comparison; only the rare words
+ * that do are searched for and moved up. Any untracked word has a count no
+ * larger than the smallest tracked one, so the list is always the exact top.
+ * @param top
+ * @param word
+ * @param count
+ */
+void topWordsUpdate(TopWords *top, const char *word, int count)
+{
+    if (top->size == top->capacity && count <= top->entries[top->size - 1].count)
+    {
+        return;
+    }
+
+    int i = 0;
+    while (i < top->size && strcmp(top->entries[i].word, word) != 0)
+    {
+        i++;
+    }
+    if (i == top->size)
+    {
+        if (top->size < top->capacity)
+        {
+            top->size++;
+        }
+        else
+        {
+            // Evict the smallest entry.
+            i = top->size - 1;
+            free(top->entries[i].word);
+        }
+        top->entries[i].word = malloc(strlen(word) + 1);
+        strcpy(top->entries[i].word, word);
+    }
+    top->entries[i].count = count;
+
+    // Move the entry up past smaller counts.
+    TopWord entry = top->entries[i];
+    while (i > 0 && top->entries[i - 1].count < entry.count)
+    {
+        top->entries[i] = top->entries[i - 1];
+        i--;
+    }
+    top->entries[i] = entry;
+}
@@ -0,0 +1,60 @@
+#ifndef CONCORDANCE_H
+#define CONCORDANCE_H
+
+#include "hashMap.h"
+#include "tokenizer.h"
+#include <stddef.h>
+
+#define CONCORDANCE_MAX_THREADS 64
+
+typedef struct ConcordanceStats ConcordanceStats;
+typedef struct TopWord TopWord;
+typedef struct TopWords TopWords;
+
+/*
+ * Timing and throughput of a parallel concordance run, for the scaling report.
+ */
+struct ConcordanceStats
+{
+    int threads;
+    // Words counted by each thread.
+    long long tokens[CONCORDANCE_MAX_THREADS];
+    // Wall time each thread spent counting its chunk.
+    double countSeconds[CONCORDANCE_MAX_THREADS];
+    // Wall time of the whole counting phase.
+    double countPhaseSeconds;
+    // Wall time of the merge phase.
+    double mergeSeconds;
+    // Resizes of the thread-local maps and the merged map together.
+    int resizes;
+};
+
+/*
+ * The most frequent words seen so far, kept up to date as counts grow so
+ * reports never have to scan the whole map.
+ */
+struct TopWord
+{
+    char *word;
+    int count;
+};
+
+struct TopWords
+{
+    // Tracked words sorted by count, largest first.
+    TopWord *entries;
+    int size;
+    int capacity;
+};
+
+int concordanceAdd(HashMap *map, const char *word);
+long long concordanceCount(HashMap *map, Tokenizer *tokenizer);
+HashMap *concordanceCountParallel(char *data, size_t length, int threads,
+                                  ConcordanceStats *stats);
+void concordancePrintStats(ConcordanceStats *stats);
+
+void topWordsInit(TopWords *top, int capacity);
+void topWordsCleanUp(TopWords *top);
+void topWordsUpdate(TopWords *top, const char *word, int count);
+
+#endif
@@ -0,0 +1,292 @@
+#include "corpus.h"
+#include "tokenizer.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+
+/**
+ * Returns the next 64 random bits (SplitMix64).
+ * @param state
+ */
+static uint64_t nextRandom(uint64_t *state)
+{
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+/**
+ * Returns a random integer in [0, n).
+ * @param state
+ * @param n
+ */
+static int randomBelow(uint64_t *state, int n)
+{
+    return (int)(((nextRandom(state) >> 32) * (uint64_t)n) >> 32);
+}
+
+/**
+ * Returns a random double in [0, 1).
+ * @param state
+ */
+static double randomUnit(uint64_t *state)
+{
+    return (nextRandom(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/**
+ * Builds the alias table for the Zipf weights 1 / (rank + 1)^exponent with
+ * Vose's method: ranks with less than the average weight are paired with one
+ * rank that has more and makes up the difference.
+ * @param corpus
+ * @param exponent
+ */
+static void buildAliasTable(Corpus *corpus, double exponent)
+{
+    int n = corpus->numWords;
+    double *scaled = malloc(sizeof(double) * n);
+    int *small = malloc(sizeof(int) * n);
+    int *large = malloc(sizeof(int) * n);
+    double total = 0;
+    for (int i = 0; i < n; i++)
+    {
+        scaled[i] = pow(i + 1, -exponent);
+        total += scaled[i];
+    }
+    int numSmall = 0;
+    int numLarge = 0;
+    for (int i = 0; i < n; i++)
+    {
+        scaled[i] *= n / total;
+        if (scaled[i] < 1)
+        {
+            small[numSmall++] = i;
+        }
+        else
+        {
+            large[numLarge++] = i;
+        }
+    }
+    while (numSmall > 0 && numLarge > 0)
+    {
+        int less = small[--numSmall];
+        int more = large[--numLarge];
+        corpus->keep[less] = scaled[less];
+        corpus->alias[less] = more;
+        scaled[more] -= 1 - scaled[less];
+        if (scaled[more] < 1)
+        {
+            small[numSmall++] = more;
+        }
+        else
+        {
+            large[numLarge++] = more;
+        }
+    }
+    // Whatever is left is 1 up to rounding.
+    while (numLarge > 0)
+    {
+        int i = large[--numLarge];
+        corpus->keep[i] = 1;
+        corpus->alias[i] = i;
+    }
+    while (numSmall > 0)
+    {
+        int i = small[--numSmall];
+        corpus->keep[i] = 1;
+        corpus->alias[i] = i;
+    }
+    free(scaled);
+    free(small);
+    free(large);
+}
+
+/**
+ * Loads the dictionary and prepares sampling from it.
+ * @param dictionary Path of a file of words.
+ * @param vocabulary Number of distinct words to use, or 0 for all of them.
+ * @param exponent Zipf exponent, 1 for natural language.
+ * @param seed
+ * @return The generator, or NULL if the dictionary has no words or could not
+ *         be read.
+ */
+Corpus *corpusNew(const char *dictionary, int vocabulary, double exponent,
+                  uint64_t seed)
+{
+    assert(vocabulary >= 0);
+    assert(exponent >= 0);
+    size_t length;
+    char *text = tokenizerMapFile(dictionary, &length);
+    if (text == NULL)
+    {
+        return NULL;
+    }
+
+    Corpus *corpus = malloc(sizeof(Corpus));
+    corpus->text = text;
+    corpus->textLength = length;
+    corpus->state = seed;
+    int capacity = 1024;
+    corpus->words = malloc(sizeof(char *) * capacity);
+    corpus->numWords = 0;
+    Tokenizer tokenizer;
+    tokenizerInitBuffer(&tokenizer, text, length);
+    char *word;
+    int wordLength;
+    while (tokenizerNext(&tokenizer, &word, &wordLength))
+    {
+        if (corpus->numWords == capacity)
+        {
+            capacity *= 2;
+            corpus->words = realloc(corpus->words, sizeof(char *) * capacity);
+        }
+        corpus->words[corpus->numWords++] = word;
+    }
+    tokenizerCleanUp(&tokenizer);
+    if (corpus->numWords == 0)
+    {
+        corpus->keep = NULL;
+        corpus->alias = NULL;
+        corpus->lengths = NULL;
+        corpusDelete(corpus);
+        return NULL;
+    }
+
+    // Shuffle so the ranks are not in alphabetical order, then keep the most
+    // frequent vocabulary words.
+    for (int i = corpus->numWords - 1; i > 0; i--)
+    {
+        int j = randomBelow(&corpus->state, i + 1);
+        char *swap = corpus->words[i];
+        corpus->words[i] = corpus->words[j];
+        corpus->words[j] = swap;
+    }
+    if (vocabulary > 0 && vocabulary < corpus->numWords)
+    {
+        corpus->numWords = vocabulary;
+    }
+    corpus->lengths = malloc(sizeof(int) * corpus->numWords);
+    for (int i = 0; i < corpus->numWords; i++)
+    {
+        corpus->lengths[i] = (int)strlen(corpus->words[i]);
+    }
+    corpus->keep = malloc(sizeof(double) * corpus->numWords);
+    corpus->alias = malloc(sizeof(int) * corpus->numWords);
+    buildAliasTable(corpus, exponent);
+    return corpus;
+}
+
+/**
+ * Frees the generator and unmaps its dictionary.
+ * @param corpus
+ */
+void corpusDelete(Corpus *corpus)
+{
+    assert(corpus != NULL);
+    tokenizerUnmapFile(corpus->text, corpus->textLength);
+    free(corpus->words);
+    free(corpus->lengths);
+    free(corpus->keep);
+    free(corpus->alias);
+    free(corpus);
+}
+
+/**
+ * Draws the rank of a word.
+ * @param corpus
+ * @return Index into words, 0 being the most frequent.
+ */
+int corpusSample(Corpus *corpus)
+{
+    int i = randomBelow(&corpus->state, corpus->numWords);
+    return randomUnit(&corpus->state) < corpus->keep[i] ? i : corpus->alias[i];
+}
+
+/**
+ * Writes sentences of random words until at least the given number of bytes
+ * has been written. Sentences are 4 to 19 words long, start with a capital
+ * letter and end with a period and a newline.
+ * @param corpus
+ * @param writer
+ * @param bytes
+ * @return Number of words written.
+ */
+long long corpusWrite(Corpus *corpus, Writer *writer, unsigned long long bytes)
+{
+    assert(corpus != NULL);
+    assert(writer != NULL);
+    unsigned long long written = 0;
+    long long words = 0;
+    char capital[64];
+    while (written < bytes)
+    {
+        int sentence = 4 + randomBelow(&corpus->state, 16);
+        for (int i = 0; i < sentence && written < bytes; i++)
+        {
+            int rank = corpusSample(corpus);
+            const char *word = corpus->words[rank];
+            int length = corpus->lengths[rank];
+            if (i > 0)
+            {
+                writerChar(writer, ' ');
+                written++;
+            }
+            else if (length < (int)sizeof(capital))
+            {
+                memcpy(capital, word, length);
+                if (capital[0] >= 'a' && capital[0] <= 'z')
+                {
+                    capital[0] -= 'a' - 'A';
+                }
+                word = capital;
+            }
+            writerString(writer, word, length);
+            written += length;
+            words++;
+        }
+        writerString(writer, ".\n", 2);
+        written += 2;
+    }
+    return words;
+}
+
+/**
+ * Parses a size in bytes with an optional K, M or G suffix (powers of 1024).
+ * @param text
+ * @param bytes Set to the size.
+ * @return 1 if the size is valid, 0 otherwise.
+ */
+int corpusParseSize(const char *text, unsigned long long *bytes)
+{
+    char *end;
+    double value = strtod(text, &end);
+    if (end == text || value < 0)
+    {
+        return 0;
+    }
+    switch (*end)
+    {
+    case 'G':
+    case 'g':
+        value *= 1024;
+        // fall through
+    case 'M':
+    case 'm':
+        value *= 1024;
+        // fall through
+    case 'K':
+    case 'k':
+        value *= 1024;
+        end++;
+        break;
+    }
+    if (*end != '\0')
+    {
+        return 0;
+    }
+    *bytes = (unsigned long long)value;
+    return 1;
+}
@@ -0,0 +1,41 @@
+#ifndef CORPUS_H
+#define CORPUS_H
+
+#include "writer.h"
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct Corpus Corpus;
+
+/*
+ * Generates text whose word frequencies follow Zipf's law: the word of rank r
+ * occurs in proportion to 1 / r^exponent. The vocabulary is drawn from a
+ * dictionary file and ranked in a shuffled order, and words are sampled in
+ * constant time with Walker's alias method. The same seed always gives the
+ * same text.
+ */
+struct Corpus
+{
+    // Mapped dictionary file; words point into it.
+    char *text;
+    size_t textLength;
+    // Vocabulary, most frequent first.
+    char **words;
+    int *lengths;
+    int numWords;
+    // Alias table: rank i is kept with probability keep[i], otherwise
+    // alias[i] is used instead.
+    double *keep;
+    int *alias;
+    // Random number generator state.
+    uint64_t state;
+};
+
+Corpus *corpusNew(const char *dictionary, int vocabulary, double exponent,
+                  uint64_t seed);
+void corpusDelete(Corpus *corpus);
+int corpusSample(Corpus *corpus);
+long long corpusWrite(Corpus *corpus, Writer *writer, unsigned long long bytes);
+int corpusParseSize(const char *text, unsigned long long *bytes);
+
+#endif
@@ -0,0 +1,101 @@
+#include "corpus.h"
+#include "writer.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * Prints the command line usage.
+ * @param program
+ */
+static void printUsage(const char *program)
+{
+    fprintf(stderr, "Usage: %s [--size=BYTES[K|M|G]] [--vocabulary=WORDS] [--exponent=S]\n"
+                    "           [--seed=N] [--dictionary=PATH] [output|-]\n",
+            program);
+}
+
+/**
+ * Writes a synthetic corpus with Zipfian word frequencies, drawn from
+ * dictionary.txt by default, to the output file or standard output. The same
+ * options always produce the same corpus.
+ * @param argc
+ * @param argv
+ * @return 0 on success, 1 on invalid arguments or if a file could not be
+ *         opened.
+ */
+int main(int argc, const char **argv)
+{
+    unsigned long long bytes = 1 << 20;
+    int vocabulary = 0;
+    double exponent = 1.0;
+    unsigned long long seed = 1;
+    const char *dictionary = "dictionary.txt";
+    const char *output = "-";
+    for (int i = 1; i < argc; i++)
+    {
+        if (strncmp(argv[i], "--size=", 7) == 0)
+        {
+            if (!corpusParseSize(argv[i] + 7, &bytes))
+            {
+                printUsage(argv[0]);
+                return 1;
+            }
+        }
+        else if (strncmp(argv[i], "--vocabulary=", 13) == 0)
+        {
+            vocabulary = atoi(argv[i] + 13);
+        }
+        else if (strncmp(argv[i], "--exponent=", 11) == 0)
+        {
+            exponent = atof(argv[i] + 11);
+        }
+        else if (strncmp(argv[i], "--seed=", 7) == 0)
+        {
+            seed = strtoull(argv[i] + 7, NULL, 10);
+        }
+        else if (strncmp(argv[i], "--dictionary=", 13) == 0)
+        {
+            dictionary = argv[i] + 13;
+        }
+        else if (argv[i][0] == '-' && argv[i][1] != '\0')
+        {
+            printUsage(argv[0]);
+            return 1;
+        }
+        else
+        {
+            output = argv[i];
+        }
+    }
+    if (vocabulary < 0 || exponent < 0)
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    Corpus *corpus = corpusNew(dictionary, vocabulary, exponent, seed);
+    if (corpus == NULL)
+    {
+        fprintf(stderr, "Could not read dictionary: %s\n", dictionary);
+        return 1;
+    }
+    FILE *file = strcmp(output, "-") == 0 ? stdout : fopen(output, "w");
+    if (file == NULL)
+    {
+        fprintf(stderr, "Could not open file: %s\n", output);
+        corpusDelete(corpus);
+        return 1;
+    }
+    Writer writer;
+    writerInit(&writer, file, WRITER_BUFFER_SIZE);
+    long long words = corpusWrite(corpus, &writer, bytes);
+    writerCleanUp(&writer);
+    fprintf(stderr, "Wrote %lld words from a vocabulary of %d\n", words, corpus->numWords);
+    if (file != stdout)
+    {
+        fclose(file);
+    }
+    corpusDelete(corpus);
+    return 0;
+}
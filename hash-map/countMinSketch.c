@@ -0,0 +1,147 @@
+#include "countMinSketch.h"
+#include "fnv.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <assert.h>
+
+/**
+ * Creates a sketch whose estimates exceed the true counts by at most epsilon
+ * times the total count with probability 1 - delta. It has ceil(e / epsilon)
+ * counters per row and ceil(ln(1 / delta)) rows, fixed for its lifetime.
+ * @param epsilon Relative error bound, in (0, 1), giving at most
+ * COUNT_MIN_SKETCH_MAX_WIDTH counters per row.
+ * @param delta Probability of exceeding the bound, in (0, 1).
+ * @return The allocated sketch, or NULL if its counters could not be allocated.
+ */
+CountMinSketch *countMinSketchNew(double epsilon, double delta)
+{
+    assert(epsilon > 0 && epsilon < 1);
+    assert(delta > 0 && delta < 1);
+    assert(exp(1.0) / epsilon <= COUNT_MIN_SKETCH_MAX_WIDTH);
+    CountMinSketch *sketch = malloc(sizeof(CountMinSketch));
+    sketch->width = (int)ceil(exp(1.0) / epsilon);
+    sketch->depth = (int)ceil(log(1.0 / delta));
+    if (sketch->depth < 1)
+    {
+        sketch->depth = 1;
+    }
+    if (sketch->depth > COUNT_MIN_SKETCH_MAX_DEPTH)
+    {
+        sketch->depth = COUNT_MIN_SKETCH_MAX_DEPTH;
+    }
+    sketch->counters = calloc((size_t)sketch->width * sketch->depth, sizeof(unsigned int));
+    if (sketch->counters == NULL)
+    {
+        free(sketch);
+        return NULL;
+    }
+    sketch->total = 0;
+    return sketch;
+}
+
+/**
+ * Frees the sketch and its counters.
+ * @param sketch
+ */
+void countMinSketchDelete(CountMinSketch *sketch)
+{
+    free(sketch->counters);
+    free(sketch);
+}
+
+/**
+ * Hashes a key to 64 bits with FNV-1a followed by a final mix. The two halves
+ * are used as independent hashes.
+ * @param key
+ * @return Hash value.
+ */
+static unsigned long long hashKey(const char *key)
+{
+    unsigned long long h = fnvHashString64(key);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+/**
+ * Computes the counter index of the key in each row, combining two hashes as
+ * h1 + i * h2 so one hash computation serves all rows.
+ * @param sketch
+ * @param key
+ * @param indices Filled with depth indices into counters.
+ */
+static void counterIndices(CountMinSketch *sketch, const char *key, size_t *indices)
+{
+    unsigned long long h = hashKey(key);
+    unsigned int h1 = (unsigned int)h;
+    unsigned int h2 = (unsigned int)(h >> 32) | 1;
+    for (int i = 0; i < sketch->depth; i++)
+    {
+        indices[i] = (size_t)i * sketch->width + (h1 + (unsigned int)i * h2) % sketch->width;
+    }
+}
+
+/**
+ * Counts one occurrence of the key with a conservative update: only the
+ * counters that are below the new estimate are raised to it, which keeps
+ * estimates much tighter than incrementing every row.
+ * @param sketch
+ * @param key
+ * @return The new estimate of the key's count.
+ */
+unsigned int countMinSketchAdd(CountMinSketch *sketch, const char *key)
+{
+    size_t indices[COUNT_MIN_SKETCH_MAX_DEPTH];
+    counterIndices(sketch, key, indices);
+    unsigned int estimate = sketch->counters[indices[0]];
+    for (int i = 1; i < sketch->depth; i++)
+    {
+        if (sketch->counters[indices[i]] < estimate)
+        {
+            estimate = sketch->counters[indices[i]];
+        }
+    }
+    estimate++;
+    for (int i = 0; i < sketch->depth; i++)
+    {
+        if (sketch->counters[indices[i]] < estimate)
+        {
+            sketch->counters[indices[i]] = estimate;
+        }
+    }
+    sketch->total++;
+    return estimate;
+}
+
+/**
+ * Returns the estimated count of the key, never below its true count.
+ * @param sketch
+ * @param key
+ * @return Estimated count.
+ */
+unsigned int countMinSketchEstimate(CountMinSketch *sketch, const char *key)
+{
+    size_t indices[COUNT_MIN_SKETCH_MAX_DEPTH];
+    counterIndices(sketch, key, indices);
+    unsigned int estimate = sketch->counters[indices[0]];
+    for (int i = 1; i < sketch->depth; i++)
+    {
+        if (sketch->counters[indices[i]] < estimate)
+        {
+            estimate = sketch->counters[indices[i]];
+        }
+    }
+    return estimate;
+}
+
+/**
+ * Returns the memory used by the counters in bytes.
+ * @param sketch
+ * @return Counter memory.
+ */
+size_t countMinSketchBytes(CountMinSketch *sketch)
+{
+    return (size_t)sketch->width * sketch->depth * sizeof(unsigned int);
+}
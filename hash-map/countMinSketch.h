@@ -0,0 +1,37 @@
+#ifndef COUNT_MIN_SKETCH_H
+#define COUNT_MIN_SKETCH_H
+
+#include <stddef.h>
+#include <limits.h>
+
+// Most rows a sketch can have, enough for delta down to about 1e-13.
+#define COUNT_MIN_SKETCH_MAX_DEPTH 30
+// Most counters a row can have, so that all the counters of a sketch can be
+// numbered with an int. Epsilon must be at least e divided by this.
+#define COUNT_MIN_SKETCH_MAX_WIDTH (INT_MAX / COUNT_MIN_SKETCH_MAX_DEPTH)
+
+typedef struct CountMinSketch CountMinSketch;
+
+/*
+ * Approximate counts in fixed memory. Each key increments one counter in each
+ * of depth rows, and its estimate is the smallest of those counters. An
+ * estimate is never below the true count, and with probability 1 - delta it
+ * exceeds it by at most epsilon times the total of all counts.
+ */
+struct CountMinSketch
+{
+    int width;
+    int depth;
+    // depth rows of width counters.
+    unsigned int *counters;
+    // Sum of all counts added.
+    unsigned long long total;
+};
+
+CountMinSketch *countMinSketchNew(double epsilon, double delta);
+void countMinSketchDelete(CountMinSketch *sketch);
+unsigned int countMinSketchAdd(CountMinSketch *sketch, const char *key);
+unsigned int countMinSketchEstimate(CountMinSketch *sketch, const char *key);
+size_t countMinSketchBytes(CountMinSketch *sketch);
+
+#endif
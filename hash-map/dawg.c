@@ -0,0 +1,439 @@
+#include "dawg.h"
+#include "fnv.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+
+typedef struct DawgWord DawgWord;
+
+/*
+ * A word and its number, for sorting the words.
+ */
+struct DawgWord
+{
+    const char *word;
+    int id;
+};
+
+static int compareWords(const void *a, const void *b)
+{
+    return strcmp(((const DawgWord *)a)->word, ((const DawgWord *)b)->word);
+}
+
+/**
+ * Hashes a node from its final flag and the labels and merged targets of its
+ * children.
+ * @param final
+ * @param labels
+ * @param targets
+ * @param numChildren
+ * @return The hash.
+ */
+static uint32_t hashNode(int final, const unsigned char *labels, const int *targets,
+                         int numChildren)
+{
+    uint32_t hash = fnvHash32(&final, sizeof(final), FNV_OFFSET_32);
+    hash = fnvHash32(labels, numChildren, hash);
+    return fnvHash32(targets, sizeof(int) * numChildren, hash);
+}
+
+/**
+ * Builds the minimal graph of the words. The words are inserted in byte order
+ * into a trie, whose children then come in label order and after their
+ * parent. Going through the trie backwards therefore reaches every node after
+ * its children, which are already merged, and a node is merged with an equal
+ * node of the graph if there is one, found by hashing. The words must stay
+ * valid for the life of the graph and be distinct.
+ * @param words
+ * @param numWords
+ * @return The graph.
+ */
+Dawg *dawgNew(const char *const *words, int numWords)
+{
+    assert(words != NULL || numWords == 0);
+    Dawg *dawg = malloc(sizeof(Dawg));
+    dawg->words = words;
+    dawg->numWords = numWords;
+    dawg->maxLength = 0;
+    dawg->order = malloc(sizeof(int) * (numWords + 1));
+    DawgWord *sorted = malloc(sizeof(DawgWord) * (numWords + 1));
+    size_t letters = 0;
+    for (int i = 0; i < numWords; i++)
+    {
+        int length = (int)strlen(words[i]);
+        dawg->maxLength = length > dawg->maxLength ? length : dawg->maxLength;
+        letters += length;
+        sorted[i].word = words[i];
+        sorted[i].id = i;
+    }
+    qsort(sorted, numWords, sizeof(DawgWord), compareWords);
+    for (int i = 0; i < numWords; i++)
+    {
+        dawg->order[i] = sorted[i].id;
+    }
+    free(sorted);
+
+    // Trie of the words, each node hanging off its parent by one letter.
+    int maxNodes = (int)letters + 1;
+    int *firstChild = malloc(sizeof(int) * maxNodes);
+    int *lastChild = malloc(sizeof(int) * maxNodes);
+    int *nextSibling = malloc(sizeof(int) * maxNodes);
+    unsigned char *trieLabel = malloc(maxNodes);
+    unsigned char *trieFinal = calloc(maxNodes, 1);
+    int *path = malloc(sizeof(int) * (dawg->maxLength + 1));
+    int numTrieNodes = 1;
+    firstChild[0] = -1;
+    nextSibling[0] = -1;
+    path[0] = 0;
+    const char *previous = "";
+    for (int i = 0; i < numWords; i++)
+    {
+        const char *word = words[dawg->order[i]];
+        int common = 0;
+        while (word[common] != '\0' && word[common] == previous[common])
+        {
+            common++;
+        }
+        int node = path[common];
+        for (int j = common; word[j] != '\0'; j++)
+        {
+            int child = numTrieNodes++;
+            firstChild[child] = -1;
+            nextSibling[child] = -1;
+            trieLabel[child] = (unsigned char)word[j];
+            if (firstChild[node] < 0)
+            {
+                firstChild[node] = child;
+            }
+            else
+            {
+                nextSibling[lastChild[node]] = child;
+            }
+            lastChild[node] = child;
+            node = child;
+            path[j + 1] = node;
+        }
+        trieFinal[node] = 1;
+        previous = word;
+    }
+
+    // Merge the trie from the leaves up.
+    dawg->firstEdge = malloc(sizeof(int) * (numTrieNodes + 1));
+    dawg->final = malloc(numTrieNodes);
+    dawg->count = malloc(sizeof(int) * numTrieNodes);
+    dawg->label = malloc(numTrieNodes);
+    dawg->target = malloc(sizeof(int) * numTrieNodes);
+    dawg->numNodes = 0;
+    dawg->numEdges = 0;
+    int numSlots = 1;
+    while (numSlots < 2 * numTrieNodes)
+    {
+        numSlots *= 2;
+    }
+    int *slots = malloc(sizeof(int) * numSlots);
+    for (int i = 0; i < numSlots; i++)
+    {
+        slots[i] = -1;
+    }
+    int *merged = malloc(sizeof(int) * numTrieNodes);
+    unsigned char *labels = malloc(256);
+    int *targets = malloc(sizeof(int) * 256);
+    for (int node = numTrieNodes - 1; node >= 0; node--)
+    {
+        int numChildren = 0;
+        for (int child = firstChild[node]; child >= 0; child = nextSibling[child])
+        {
+            labels[numChildren] = trieLabel[child];
+            targets[numChildren] = merged[child];
+            numChildren++;
+        }
+        uint32_t slot = hashNode(trieFinal[node], labels, targets, numChildren) & (numSlots - 1);
+        while (slots[slot] >= 0)
+        {
+            int other = slots[slot];
+            int first = dawg->firstEdge[other];
+            if (dawg->final[other] == trieFinal[node] &&
+                dawg->firstEdge[other + 1] - first == numChildren &&
+                memcmp(dawg->label + first, labels, numChildren) == 0 &&
+                memcmp(dawg->target + first, targets, sizeof(int) * numChildren) == 0)
+            {
+                break;
+            }
+            slot = (slot + 1) & (numSlots - 1);
+        }
+        if (slots[slot] < 0)
+        {
+            // A new node, with its edges after those of the previous one.
+            int added = dawg->numNodes++;
+            dawg->firstEdge[added] = dawg->numEdges;
+            dawg->final[added] = trieFinal[node];
+            dawg->count[added] = trieFinal[node];
+            for (int i = 0; i < numChildren; i++)
+            {
+                dawg->label[dawg->numEdges] = labels[i];
+                dawg->target[dawg->numEdges] = targets[i];
+                dawg->numEdges++;
+                dawg->count[added] += dawg->count[targets[i]];
+            }
+            dawg->firstEdge[added + 1] = dawg->numEdges;
+            slots[slot] = added;
+        }
+        merged[node] = slots[slot];
+    }
+    dawg->root = merged[0];
+    free(targets);
+    free(labels);
+    free(merged);
+    free(slots);
+    free(path);
+    free(trieFinal);
+    free(trieLabel);
+    free(nextSibling);
+    free(lastChild);
+    free(firstChild);
+
+    dawg->firstEdge = realloc(dawg->firstEdge, sizeof(int) * (dawg->numNodes + 1));
+    dawg->final = realloc(dawg->final, dawg->numNodes);
+    dawg->count = realloc(dawg->count, sizeof(int) * dawg->numNodes);
+    dawg->label = realloc(dawg->label, dawg->numEdges + 1);
+    dawg->target = realloc(dawg->target, sizeof(int) * (dawg->numEdges + 1));
+    return dawg;
+}
+
+/**
+ * Frees the graph. Does not free the words.
+ * @param dawg
+ */
+void dawgDelete(Dawg *dawg)
+{
+    assert(dawg != NULL);
+    free(dawg->firstEdge);
+    free(dawg->final);
+    free(dawg->count);
+    free(dawg->label);
+    free(dawg->target);
+    free(dawg->order);
+    free(dawg);
+}
+
+/**
+ * @param dawg
+ * @return Bytes allocated for the graph, not counting the words.
+ */
+size_t dawgBytes(Dawg *dawg)
+{
+    return sizeof(Dawg) + (sizeof(int) * 2 + 1) * (size_t)dawg->numNodes + sizeof(int) +
+           (sizeof(int) + 1) * (size_t)dawg->numEdges + sizeof(int) * (size_t)dawg->numWords;
+}
+
+/**
+ * Finds a word, counting the words before it in byte order on the way down.
+ * @param dawg
+ * @param word
+ * @return Number of the word, or -1 if it is not in the graph.
+ */
+int dawgFind(Dawg *dawg, const char *word)
+{
+    assert(dawg != NULL);
+    assert(word != NULL);
+    int node = dawg->root;
+    int rank = 0;
+    for (const unsigned char *c = (const unsigned char *)word; *c != '\0'; c++)
+    {
+        rank += dawg->final[node];
+        int edge = dawg->firstEdge[node];
+        int end = dawg->firstEdge[node + 1];
+        while (edge < end && dawg->label[edge] < *c)
+        {
+            rank += dawg->count[dawg->target[edge]];
+            edge++;
+        }
+        if (edge == end || dawg->label[edge] != *c)
+        {
+            return -1;
+        }
+        node = dawg->target[edge];
+    }
+    return dawg->final[node] ? dawg->order[rank] : -1;
+}
+
+/**
+ * Walks the graph depth first in byte order with one row of the edit distance
+ * table per letter of the path, skipping the nodes below a row that is all
+ * more than the limit. The limit is maxDistance, lowered to the one of the
+ * heap if there is one.
+ * @param dawg
+ * @param word
+ * @param maxDistance
+ * @param heap Heap offered the words within the limit, or NULL to collect
+ *             them in matches.
+ * @param matches
+ * @param found
+ * @return Number of rows computed.
+ */
+static long long walk(Dawg *dawg, const char *word, int maxDistance, SuggestionHeap *heap,
+                      Suggestion **matches, int *found)
+{
+    const unsigned char *query = (const unsigned char *)word;
+    int m = (int)strlen(word);
+    int capacity = 16;
+    if (heap == NULL)
+    {
+        *matches = malloc(sizeof(Suggestion) * capacity);
+    }
+    *found = 0;
+    if (dawg->numWords == 0)
+    {
+        return 0;
+    }
+
+    int *rows = malloc(sizeof(int) * (m + 1) * (dawg->maxLength + 1));
+    for (int j = 0; j <= m; j++)
+    {
+        rows[j] = j;
+    }
+    // Edges still to visit, with their depth and the rank of their first word.
+    int stackCapacity = 64;
+    int (*stack)[3] = malloc(sizeof(int[3]) * stackCapacity);
+    int depth = 0;
+    int node = dawg->root;
+    int nodeDepth = 0;
+    int rank = 0;
+    long long computed = 0;
+    while (1)
+    {
+        const int *row = rows + nodeDepth * (m + 1);
+        int limit = heap != NULL ? suggestionHeapLimit(heap, -1, maxDistance) : maxDistance;
+        if (dawg->final[node] && row[m] <= limit)
+        {
+            if (heap != NULL)
+            {
+                suggestionHeapOffer(heap, dawg->order[rank], row[m]);
+                limit = suggestionHeapLimit(heap, -1, maxDistance);
+            }
+            else
+            {
+                if (*found == capacity)
+                {
+                    capacity *= 2;
+                    *matches = realloc(*matches, sizeof(Suggestion) * capacity);
+                }
+                (*matches)[*found].word = dawg->order[rank];
+                (*matches)[*found].distance = row[m];
+            }
+            (*found)++;
+        }
+        int smallest = row[0];
+        for (int j = 1; j <= m; j++)
+        {
+            smallest = row[j] < smallest ? row[j] : smallest;
+        }
+        if (smallest <= limit)
+        {
+            // Pushed last to first, so that the first label comes out first.
+            int childRank = rank + dawg->count[node];
+            for (int edge = dawg->firstEdge[node + 1] - 1; edge >= dawg->firstEdge[node]; edge--)
+            {
+                childRank -= dawg->count[dawg->target[edge]];
+                if (depth == stackCapacity)
+                {
+                    stackCapacity *= 2;
+                    stack = realloc(stack, sizeof(int[3]) * stackCapacity);
+                }
+                stack[depth][0] = edge;
+                stack[depth][1] = nodeDepth + 1;
+                stack[depth][2] = childRank;
+                depth++;
+            }
+        }
+        if (depth == 0)
+        {
+            break;
+        }
+
+        // The row of the next edge follows the row of its parent, which is
+        // still the one above it.
+        depth--;
+        int edge = stack[depth][0];
+        nodeDepth = stack[depth][1];
+        rank = stack[depth][2];
+        node = dawg->target[edge];
+        unsigned char letter = dawg->label[edge];
+        const int *above = rows + (nodeDepth - 1) * (m + 1);
+        int *next = rows + nodeDepth * (m + 1);
+        next[0] = nodeDepth;
+        for (int j = 1; j <= m; j++)
+        {
+            int value = above[j - 1] + (query[j - 1] != letter);
+            value = above[j] + 1 < value ? above[j] + 1 : value;
+            value = next[j - 1] + 1 < value ? next[j - 1] + 1 : value;
+            next[j] = value;
+        }
+        computed++;
+    }
+    free(stack);
+    free(rows);
+    return computed;
+}
+
+/**
+ * Finds every word within the given distance of the query.
+ * @param dawg
+ * @param word
+ * @param maxDistance
+ * @param matches Set to an allocated array of the words found, in byte order,
+ *                to be freed by the caller.
+ * @param visited If not NULL, incremented by the number of rows computed.
+ * @return Number of words found.
+ */
+int dawgWithin(Dawg *dawg, const char *word, int maxDistance, Suggestion **matches,
+               long long *visited)
+{
+    assert(dawg != NULL);
+    assert(word != NULL);
+    assert(maxDistance >= 0);
+    int found;
+    long long computed = walk(dawg, word, maxDistance, NULL, matches, &found);
+    if (visited != NULL)
+    {
+        *visited += computed;
+    }
+    return found;
+}
+
+/**
+ * Finds the closest words to a word. Gives the same suggestions as
+ * suggestScan. Most words have enough words within one or two edits, so the
+ * walk is first limited to as few edits as the lengths allow and the limit is
+ * doubled until the heap fills: the rows of a narrow walk stop much sooner,
+ * and a word far from every dictionary word takes only a few walks.
+ * @param dawg
+ * @param word
+ * @param best Filled with the closest words, nearest first, ties in
+ *             dictionary order.
+ * @param count Number of words wanted.
+ * @return Number of words found.
+ */
+int dawgSuggest(Dawg *dawg, const char *word, Suggestion *best, int count)
+{
+    assert(dawg != NULL);
+    assert(word != NULL);
+    int length = (int)strlen(word);
+    int largest = length > dawg->maxLength ? length : dawg->maxLength;
+    // No word is closer than the length difference to the longest word.
+    int maxDistance = length - dawg->maxLength > 1 ? length - dawg->maxLength : 1;
+    SuggestionHeap heap;
+    while (1)
+    {
+        maxDistance = maxDistance < largest ? maxDistance : largest;
+        suggestionHeapInit(&heap, best, count);
+        int offered;
+        walk(dawg, word, maxDistance, &heap, NULL, &offered);
+        if (heap.size == count || maxDistance >= largest)
+        {
+            return suggestionHeapSort(&heap);
+        }
+        maxDistance *= 2;
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef DAWG_H
+#define DAWG_H
+
+#include "suggest.h"
+#include <stddef.h>
+
+typedef struct Dawg Dawg;
+
+/*
+ * A minimal directed acyclic word graph: the trie of the words in byte order
+ * with equal subtrees merged, so that words share their common suffixes as
+ * well as their prefixes. Each node counts the words below it, which gives
+ * every word its rank in byte order on the way down, and order maps ranks
+ * back to word numbers. Searches walk it with one row of the edit distance
+ * table per letter, so the rows of a prefix are computed once for all the
+ * words sharing it. Edges of node v are firstEdge[v] to firstEdge[v + 1] - 1,
+ * sorted by label.
+ */
+struct Dawg
+{
+    const char *const *words;
+    int numWords;
+    int maxLength;
+    int numNodes;
+    int numEdges;
+    int root;
+    int *firstEdge;
+    // Words ending at each node and below it.
+    unsigned char *final;
+    int *count;
+    unsigned char *label;
+    int *target;
+    // Word number of each rank.
+    int *order;
+};
+
+Dawg *dawgNew(const char *const *words, int numWords);
+void dawgDelete(Dawg *dawg);
+size_t dawgBytes(Dawg *dawg);
+int dawgFind(Dawg *dawg, const char *word);
+int dawgWithin(Dawg *dawg, const char *word, int maxDistance, Suggestion **matches,
+               long long *visited);
+int dawgSuggest(Dawg *dawg, const char *word, Suggestion *best, int count);
+
+#endif
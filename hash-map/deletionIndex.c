@@ -0,0 +1,460 @@
+#define _POSIX_C_SOURCE 200809L
+#include "deletionIndex.h"
+#include "levenshtein.h"
+#include "fnv.h"
+#include "writer.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*
+ * Index file layout, in native byte order so that it can be mapped as is:
+ *
+ *   DeletionHeader
+ *   offsets, numBuckets + 1 uint32_t
+ *   entries, numEntries DeletionEntry
+ *
+ * The checksum is a hash of the dictionary the index was built from, so an
+ * index is never used with another dictionary.
+ */
+#define DELETION_INDEX_MAGIC "DELIDX01"
+#define DELETION_INDEX_MAGIC_LENGTH 8
+
+typedef struct DeletionHeader DeletionHeader;
+
+struct DeletionHeader
+{
+    char magic[DELETION_INDEX_MAGIC_LENGTH];
+    uint32_t maxDistance;
+    uint32_t prefixLength;
+    uint32_t numWords;
+    uint32_t numBuckets;
+    uint32_t numEntries;
+    uint32_t checksum;
+};
+
+/**
+ * Hashes all the words, in order, to tell dictionaries apart.
+ * @param words
+ * @param numWords
+ * @return The hash.
+ */
+static uint32_t checksumWords(const char *const *words, int numWords)
+{
+    uint32_t hash = FNV_OFFSET_32;
+    for (int i = 0; i < numWords; i++)
+    {
+        hash = fnvHash32(words[i], strlen(words[i]) + 1, hash);
+    }
+    return hash;
+}
+
+/**
+ * Returns the number of ways to delete up to maxDistance characters from a
+ * string of the given length, counting the string itself.
+ * @param length
+ * @param maxDistance
+ */
+static int countDeletions(int length, int maxDistance)
+{
+    int total = 0;
+    int ways = 1;
+    for (int k = 0; k <= maxDistance && k <= length; k++)
+    {
+        total += ways;
+        ways = ways * (length - k) / (k + 1);
+    }
+    return total;
+}
+
+/**
+ * Adds the hashes of the strings obtained by deleting up to maxDistance more
+ * characters at or after the given position. Each set of positions is
+ * deleted once, but repeated letters can still give the same string twice.
+ * @param string
+ * @param length
+ * @param from First position that may be deleted.
+ * @param maxDistance
+ * @param hashes
+ * @param count Number of hashes so far.
+ * @return The new number of hashes.
+ */
+static int addDeletions(const char *string, int length, int from, int maxDistance,
+                        uint32_t *hashes, int count)
+{
+    char shorter[DELETION_INDEX_MAX_PREFIX];
+    for (int i = from; i < length; i++)
+    {
+        memcpy(shorter, string, i);
+        memcpy(shorter + i, string + i + 1, length - i - 1);
+        hashes[count++] = fnvHash32(shorter, length - 1, FNV_OFFSET_32);
+        if (maxDistance > 1)
+        {
+            count = addDeletions(shorter, length - 1, i, maxDistance - 1, hashes, count);
+        }
+    }
+    return count;
+}
+
+static int compareUnsigned(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Hashes the distinct deletions of the prefix of a word.
+ * @param word
+ * @param prefixLength
+ * @param maxDistance
+ * @param hashes Room for countDeletions(prefixLength, maxDistance) hashes.
+ * @return The number of distinct hashes.
+ */
+static int hashDeletions(const char *word, int prefixLength, int maxDistance, uint32_t *hashes)
+{
+    int length = (int)strnlen(word, prefixLength);
+    hashes[0] = fnvHash32(word, length, FNV_OFFSET_32);
+    int count = maxDistance > 0 ? addDeletions(word, length, 0, maxDistance, hashes, 1) : 1;
+    qsort(hashes, count, sizeof(uint32_t), compareUnsigned);
+    int distinct = 1;
+    for (int i = 1; i < count; i++)
+    {
+        if (hashes[i] != hashes[distinct - 1])
+        {
+            hashes[distinct++] = hashes[i];
+        }
+    }
+    return distinct;
+}
+
+/**
+ * Builds the index of the words. The words must stay valid for the life of
+ * the index.
+ * @param words
+ * @param numWords
+ * @param maxDistance Largest distance searched, at most
+ *                    DELETION_INDEX_MAX_DISTANCE.
+ * @param prefixLength Number of leading characters indexed, at most
+ *                     DELETION_INDEX_MAX_PREFIX.
+ * @return The index.
+ */
+DeletionIndex *deletionIndexNew(const char *const *words, int numWords, int maxDistance,
+                                int prefixLength)
+{
+    assert(words != NULL || numWords == 0);
+    assert(maxDistance >= 0 && maxDistance <= DELETION_INDEX_MAX_DISTANCE);
+    assert(prefixLength > 0 && prefixLength <= DELETION_INDEX_MAX_PREFIX);
+    uint32_t *hashes = malloc(sizeof(uint32_t) * countDeletions(prefixLength, maxDistance));
+    size_t capacity = (size_t)numWords * 4 + 16;
+    DeletionEntry *pairs = malloc(sizeof(DeletionEntry) * capacity);
+    size_t numPairs = 0;
+    for (int i = 0; i < numWords; i++)
+    {
+        int count = hashDeletions(words[i], prefixLength, maxDistance, hashes);
+        if (numPairs + count > capacity)
+        {
+            capacity = (numPairs + count) * 2;
+            pairs = realloc(pairs, sizeof(DeletionEntry) * capacity);
+        }
+        for (int j = 0; j < count; j++)
+        {
+            pairs[numPairs].hash = hashes[j];
+            pairs[numPairs].word = (uint32_t)i;
+            numPairs++;
+        }
+    }
+    free(hashes);
+    assert(numPairs <= UINT32_MAX);
+
+    DeletionIndex *index = malloc(sizeof(DeletionIndex));
+    index->words = words;
+    index->numWords = numWords;
+    index->maxDistance = maxDistance;
+    index->prefixLength = prefixLength;
+    index->numEntries = (uint32_t)numPairs;
+    index->numBuckets = 1;
+    while (index->numBuckets < index->numEntries / 2)
+    {
+        index->numBuckets *= 2;
+    }
+    index->mapping = NULL;
+    index->mappingLength = 0;
+
+    // Counting sort of the pairs by bucket, keeping word order in each.
+    uint32_t mask = index->numBuckets - 1;
+    index->offsets = calloc(index->numBuckets + 1, sizeof(uint32_t));
+    for (size_t i = 0; i < numPairs; i++)
+    {
+        index->offsets[(pairs[i].hash & mask) + 1]++;
+    }
+    for (uint32_t i = 0; i < index->numBuckets; i++)
+    {
+        index->offsets[i + 1] += index->offsets[i];
+    }
+    index->entries = malloc(sizeof(DeletionEntry) * (numPairs + 1));
+    uint32_t *next = malloc(sizeof(uint32_t) * index->numBuckets);
+    memcpy(next, index->offsets, sizeof(uint32_t) * index->numBuckets);
+    for (size_t i = 0; i < numPairs; i++)
+    {
+        index->entries[next[pairs[i].hash & mask]++] = pairs[i];
+    }
+    free(next);
+    free(pairs);
+    return index;
+}
+
+/**
+ * Writes the index to a file atomically, through a temporary file flushed to
+ * disk and renamed over the target, whose directory is then flushed too.
+ * @param index
+ * @param fileName
+ * @return 1 on success, 0 on failure.
+ */
+int deletionIndexSave(DeletionIndex *index, const char *fileName)
+{
+    assert(index != NULL);
+    size_t nameLength = strlen(fileName);
+    char *temporary = malloc(nameLength + 5);
+    memcpy(temporary, fileName, nameLength);
+    strcpy(temporary + nameLength, ".tmp");
+    FILE *file = fopen(temporary, "wb");
+    if (file == NULL)
+    {
+        free(temporary);
+        return 0;
+    }
+
+    DeletionHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, DELETION_INDEX_MAGIC, DELETION_INDEX_MAGIC_LENGTH);
+    header.maxDistance = (uint32_t)index->maxDistance;
+    header.prefixLength = (uint32_t)index->prefixLength;
+    header.numWords = (uint32_t)index->numWords;
+    header.numBuckets = index->numBuckets;
+    header.numEntries = index->numEntries;
+    header.checksum = checksumWords(index->words, index->numWords);
+    int ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+             fwrite(index->offsets, sizeof(uint32_t), index->numBuckets + 1, file) ==
+                 index->numBuckets + 1 &&
+             fwrite(index->entries, sizeof(DeletionEntry), index->numEntries, file) ==
+                 index->numEntries;
+    ok = ok && fflush(file) == 0 && fsync(fileno(file)) == 0;
+    ok = fclose(file) == 0 && ok;
+    ok = ok && writerReplaceFile(temporary, fileName);
+    if (!ok)
+    {
+        remove(temporary);
+    }
+    free(temporary);
+    return ok;
+}
+
+/**
+ * Checks that the mapped tables can be searched without reading past them:
+ * the bucket offsets run in order from 0 to the number of entries, and every
+ * entry is a word of the dictionary.
+ * @param offsets
+ * @param numBuckets
+ * @param entries
+ * @param numEntries
+ * @param numWords
+ * @return 1 if the tables are consistent, 0 otherwise.
+ */
+static int tablesValid(const uint32_t *offsets, uint32_t numBuckets,
+                       const DeletionEntry *entries, uint32_t numEntries, int numWords)
+{
+    if (offsets[0] != 0 || offsets[numBuckets] != numEntries)
+    {
+        return 0;
+    }
+    for (uint32_t i = 0; i < numBuckets; i++)
+    {
+        if (offsets[i] > offsets[i + 1])
+        {
+            return 0;
+        }
+    }
+    for (uint32_t i = 0; i < numEntries; i++)
+    {
+        if (entries[i].word >= (uint32_t)numWords)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Maps an index saved by deletionIndexSave. The tables are used in place, so
+ * the pages are shared by every process using the same file; they are only
+ * read through once, to check that they are consistent.
+ * @param fileName
+ * @param words The words the index was built from.
+ * @param numWords
+ * @return The index, or NULL if the file could not be mapped, is not an
+ *         index, was built from other words or is damaged.
+ */
+DeletionIndex *deletionIndexLoad(const char *fileName, const char *const *words, int numWords)
+{
+    int fd = open(fileName, O_RDONLY);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(DeletionHeader))
+    {
+        close(fd);
+        return NULL;
+    }
+    size_t length = (size_t)info.st_size;
+    char *data = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        return NULL;
+    }
+
+    DeletionHeader header;
+    memcpy(&header, data, sizeof(header));
+    size_t expected = sizeof(header) + sizeof(uint32_t) * ((size_t)header.numBuckets + 1) +
+                      sizeof(DeletionEntry) * (size_t)header.numEntries;
+    if (memcmp(header.magic, DELETION_INDEX_MAGIC, DELETION_INDEX_MAGIC_LENGTH) != 0 ||
+        header.maxDistance > DELETION_INDEX_MAX_DISTANCE || header.prefixLength == 0 ||
+        header.prefixLength > DELETION_INDEX_MAX_PREFIX || header.numBuckets == 0 ||
+        (header.numBuckets & (header.numBuckets - 1)) != 0 || length != expected ||
+        header.numWords != (uint32_t)numWords ||
+        header.checksum != checksumWords(words, numWords))
+    {
+        munmap(data, length);
+        return NULL;
+    }
+    const uint32_t *offsets = (const uint32_t *)(data + sizeof(header));
+    if (!tablesValid(offsets, header.numBuckets,
+                     (const DeletionEntry *)(offsets + header.numBuckets + 1),
+                     header.numEntries, numWords))
+    {
+        munmap(data, length);
+        return NULL;
+    }
+
+    DeletionIndex *index = malloc(sizeof(DeletionIndex));
+    index->words = words;
+    index->numWords = numWords;
+    index->maxDistance = (int)header.maxDistance;
+    index->prefixLength = (int)header.prefixLength;
+    index->numBuckets = header.numBuckets;
+    index->numEntries = header.numEntries;
+    index->offsets = (uint32_t *)(data + sizeof(header));
+    index->entries = (DeletionEntry *)(index->offsets + index->numBuckets + 1);
+    index->mapping = data;
+    index->mappingLength = length;
+    return index;
+}
+
+/**
+ * Frees or unmaps the index. Does not free the words.
+ * @param index
+ */
+void deletionIndexDelete(DeletionIndex *index)
+{
+    assert(index != NULL);
+    if (index->mapping != NULL)
+    {
+        munmap(index->mapping, index->mappingLength);
+    }
+    else
+    {
+        free(index->offsets);
+        free(index->entries);
+    }
+    free(index);
+}
+
+/**
+ * Returns the size of the index tables in bytes.
+ * @param index
+ */
+size_t deletionIndexBytes(DeletionIndex *index)
+{
+    return sizeof(uint32_t) * ((size_t)index->numBuckets + 1) +
+           sizeof(DeletionEntry) * (size_t)index->numEntries;
+}
+
+/**
+ * Finds every word within the given distance of the query. The words sharing
+ * a deletion hash with the query's prefix are the candidates, and their
+ * distance to the query is computed to keep those within the distance. The
+ * index is only read, so it can be searched by several threads at once.
+ * @param index
+ * @param word
+ * @param maxDistance At most the distance the index was built for.
+ * @param matches Set to an allocated array of the words found, in no
+ *                particular order, to be freed by the caller.
+ * @param visited If not NULL, incremented by the number of distances computed.
+ * @return Number of words found.
+ */
+int deletionIndexSearch(DeletionIndex *index, const char *word, int maxDistance,
+                        Suggestion **matches, long long *visited)
+{
+    assert(index != NULL);
+    assert(word != NULL);
+    assert(maxDistance >= 0 && maxDistance <= index->maxDistance);
+    uint32_t hashes[countDeletions(index->prefixLength, maxDistance)];
+    int numHashes = hashDeletions(word, index->prefixLength, maxDistance, hashes);
+
+    int capacity = 64;
+    int numCandidates = 0;
+    uint32_t *candidates = malloc(sizeof(uint32_t) * capacity);
+    uint32_t mask = index->numBuckets - 1;
+    for (int i = 0; i < numHashes; i++)
+    {
+        uint32_t bucket = hashes[i] & mask;
+        for (uint32_t j = index->offsets[bucket]; j < index->offsets[bucket + 1]; j++)
+        {
+            if (index->entries[j].hash != hashes[i])
+            {
+                continue;
+            }
+            if (numCandidates == capacity)
+            {
+                capacity *= 2;
+                candidates = realloc(candidates, sizeof(uint32_t) * capacity);
+            }
+            candidates[numCandidates++] = index->entries[j].word;
+        }
+    }
+
+    // A word shares several deletions with the query, but is checked once.
+    qsort(candidates, numCandidates, sizeof(uint32_t), compareUnsigned);
+    int found = 0;
+    int checked = 0;
+    *matches = malloc(sizeof(Suggestion) * (numCandidates + 1));
+    for (int i = 0; i < numCandidates; i++)
+    {
+        if (i > 0 && candidates[i] == candidates[i - 1])
+        {
+            continue;
+        }
+        int distance = levenshteinBounded(word, index->words[candidates[i]], maxDistance);
+        checked++;
+        if (distance <= maxDistance)
+        {
+            (*matches)[found].word = (int)candidates[i];
+            (*matches)[found].distance = distance;
+            found++;
+        }
+    }
+    free(candidates);
+    if (visited != NULL)
+    {
+        *visited += checked;
+    }
+    return found;
+}
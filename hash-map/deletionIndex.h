@@ -0,0 +1,62 @@
+#ifndef DELETION_INDEX_H
+#define DELETION_INDEX_H
+
+#include "suggest.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define DELETION_INDEX_MAX_DISTANCE 4
+#define DELETION_INDEX_MAX_PREFIX 32
+#define DELETION_INDEX_DISTANCE 2
+#define DELETION_INDEX_PREFIX 7
+
+typedef struct DeletionIndex DeletionIndex;
+typedef struct DeletionEntry DeletionEntry;
+
+/*
+ * A deletion of a dictionary word, by the hash of the deleted string.
+ */
+struct DeletionEntry
+{
+    uint32_t hash;
+    uint32_t word;
+};
+
+/*
+ * A symmetric delete index (as in SymSpell): every string obtained by deleting
+ * up to maxDistance characters from the first prefixLength characters of each
+ * word is hashed and mapped to the word. Two words within edit distance k have
+ * prefixes that become equal after at most k deletions from each, so the words
+ * near a query are found among those sharing a deletion of its prefix, and
+ * only the query's deletions are generated at lookup. Longer prefixes and
+ * larger distances cost memory; shorter prefixes give more candidates to
+ * check. Only hashes are kept, so the index is a bucket offset table and an
+ * array of entries that can be saved and mapped back from a file.
+ */
+struct DeletionIndex
+{
+    const char *const *words;
+    int numWords;
+    int maxDistance;
+    int prefixLength;
+    // Entries of bucket i are entries[offsets[i]] to entries[offsets[i + 1]].
+    // The number of buckets is a power of two.
+    uint32_t *offsets;
+    DeletionEntry *entries;
+    uint32_t numBuckets;
+    uint32_t numEntries;
+    // Mapped file the tables point into, or NULL if they were allocated.
+    void *mapping;
+    size_t mappingLength;
+};
+
+DeletionIndex *deletionIndexNew(const char *const *words, int numWords, int maxDistance,
+                                int prefixLength);
+DeletionIndex *deletionIndexLoad(const char *fileName, const char *const *words, int numWords);
+int deletionIndexSave(DeletionIndex *index, const char *fileName);
+void deletionIndexDelete(DeletionIndex *index);
+size_t deletionIndexBytes(DeletionIndex *index);
+int deletionIndexSearch(DeletionIndex *index, const char *word, int maxDistance,
+                        Suggestion **matches, long long *visited);
+
+#endif
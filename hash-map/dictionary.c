@@ -0,0 +1,325 @@
+#define _POSIX_C_SOURCE 200809L
+#include "dictionary.h"
+#include "tokenizer.h"
+#include "fnv.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+
+typedef struct SplitTask SplitTask;
+typedef struct IndexTask IndexTask;
+
+/*
+ * A newline-aligned range of the file split into words by one thread.
+ */
+struct SplitTask
+{
+    char *data;
+    size_t length;
+    char **words;
+    int *lengths;
+    uint32_t *hashes;
+    int numWords;
+};
+
+/*
+ * A range of buckets filled by one thread from all the words.
+ */
+struct IndexTask
+{
+    Dictionary *dictionary;
+    int first;
+    int last;
+    // Set for each word that repeats an earlier one and is left out.
+    char *duplicate;
+};
+
+static void *splitRange(void *arg)
+{
+    SplitTask *task = arg;
+    // A word is at least one byte plus its newline, except perhaps the last.
+    int capacity = (int)(task->length / 2 + 1);
+    task->words = malloc(sizeof(char *) * capacity);
+    task->lengths = malloc(sizeof(int) * capacity);
+    task->hashes = malloc(sizeof(uint32_t) * capacity);
+    task->numWords = 0;
+
+    Tokenizer tokenizer;
+    tokenizerInitBuffer(&tokenizer, task->data, task->length);
+    char *word;
+    int length;
+    while (tokenizerNext(&tokenizer, &word, &length))
+    {
+        if (task->numWords == capacity)
+        {
+            capacity *= 2;
+            task->words = realloc(task->words, sizeof(char *) * capacity);
+            task->lengths = realloc(task->lengths, sizeof(int) * capacity);
+            task->hashes = realloc(task->hashes, sizeof(uint32_t) * capacity);
+        }
+        task->words[task->numWords] = word;
+        task->hashes[task->numWords] = fnvHashString32(word, &task->lengths[task->numWords]);
+        task->numWords++;
+    }
+    tokenizerCleanUp(&tokenizer);
+    return NULL;
+}
+
+static void *indexRange(void *arg)
+{
+    IndexTask *task = arg;
+    Dictionary *dictionary = task->dictionary;
+    uint32_t mask = (uint32_t)dictionary->numBuckets - 1;
+    for (int i = 0; i < dictionary->numWords; i++)
+    {
+        int bucket = (int)(dictionary->hashes[i] & mask);
+        if (bucket < task->first || bucket >= task->last)
+        {
+            continue;
+        }
+        int j = dictionary->buckets[bucket];
+        while (j >= 0 && (dictionary->hashes[j] != dictionary->hashes[i] ||
+                          dictionary->lengths[j] != dictionary->lengths[i] ||
+                          memcmp(dictionary->words[j], dictionary->words[i],
+                                 dictionary->lengths[i]) != 0))
+        {
+            j = dictionary->next[j];
+        }
+        if (j >= 0)
+        {
+            task->duplicate[i] = 1;
+            continue;
+        }
+        dictionary->next[i] = dictionary->buckets[bucket];
+        dictionary->buckets[bucket] = i;
+    }
+    return NULL;
+}
+
+/**
+ * Renumbers the words without the duplicates, keeping the index valid.
+ * Duplicates are never linked into the index, so only kept words are.
+ * @param dictionary
+ * @param duplicate
+ */
+static void removeDuplicates(Dictionary *dictionary, const char *duplicate)
+{
+    int *renumber = malloc(sizeof(int) * dictionary->numWords);
+    int kept = 0;
+    for (int i = 0; i < dictionary->numWords; i++)
+    {
+        renumber[i] = kept;
+        kept += !duplicate[i];
+    }
+    if (kept == dictionary->numWords)
+    {
+        free(renumber);
+        return;
+    }
+    // Words only move down, so each slot is read before it is overwritten.
+    for (int i = 0; i < dictionary->numWords; i++)
+    {
+        if (duplicate[i])
+        {
+            continue;
+        }
+        int to = renumber[i];
+        dictionary->words[to] = dictionary->words[i];
+        dictionary->lengths[to] = dictionary->lengths[i];
+        dictionary->hashes[to] = dictionary->hashes[i];
+        dictionary->next[to] = dictionary->next[i] >= 0 ? renumber[dictionary->next[i]] : -1;
+    }
+    for (int i = 0; i < dictionary->numBuckets; i++)
+    {
+        if (dictionary->buckets[i] >= 0)
+        {
+            dictionary->buckets[i] = renumber[dictionary->buckets[i]];
+        }
+    }
+    dictionary->numWords = kept;
+    free(renumber);
+}
+
+/**
+ * Loads a dictionary with several threads. The mapped file is split into one
+ * newline-aligned range per thread, and each thread splits its range into
+ * words and hashes them. The index is then sized for all the words and filled
+ * in parallel, each thread owning a range of its buckets, so no locking is
+ * needed in either phase. Words are folded to lower case, and repeated words
+ * are kept once.
+ * @param fileName
+ * @param threads Number of threads, at most DICTIONARY_MAX_THREADS.
+ * @return The dictionary, or NULL if the file could not be mapped.
+ */
+Dictionary *dictionaryLoad(const char *fileName, int threads)
+{
+    assert(threads > 0 && threads <= DICTIONARY_MAX_THREADS);
+    size_t length;
+    char *data = tokenizerMapFile(fileName, &length);
+    if (data == NULL)
+    {
+        return NULL;
+    }
+
+    SplitTask splits[DICTIONARY_MAX_THREADS];
+    IndexTask indexes[DICTIONARY_MAX_THREADS];
+    pthread_t workers[DICTIONARY_MAX_THREADS];
+
+    // Split phase. Words only ever end before a newline or at the end of the
+    // file, so no thread terminates a word in another thread's range.
+    size_t from = 0;
+    for (int i = 0; i < threads; i++)
+    {
+        size_t to = length;
+        if (i < threads - 1)
+        {
+            size_t at = length / threads * (i + 1);
+            char *newline = at < length ? memchr(data + at, '\n', length - at) : NULL;
+            to = newline != NULL ? (size_t)(newline - data) + 1 : length;
+        }
+        if (to < from)
+        {
+            to = from;
+        }
+        splits[i].data = data + from;
+        splits[i].length = to - from;
+        pthread_create(&workers[i], NULL, splitRange, &splits[i]);
+        from = to;
+    }
+    int numWords = 0;
+    for (int i = 0; i < threads; i++)
+    {
+        pthread_join(workers[i], NULL);
+        numWords += splits[i].numWords;
+    }
+
+    Dictionary *dictionary = malloc(sizeof(Dictionary));
+    dictionary->data = data;
+    dictionary->length = length;
+    dictionary->words = malloc(sizeof(char *) * (numWords + 1));
+    dictionary->lengths = malloc(sizeof(int) * (numWords + 1));
+    dictionary->hashes = malloc(sizeof(uint32_t) * (numWords + 1));
+    dictionary->next = malloc(sizeof(int) * (numWords + 1));
+    dictionary->numWords = 0;
+    for (int i = 0; i < threads; i++)
+    {
+        int n = splits[i].numWords;
+        memcpy(dictionary->words + dictionary->numWords, splits[i].words, sizeof(char *) * n);
+        memcpy(dictionary->lengths + dictionary->numWords, splits[i].lengths, sizeof(int) * n);
+        memcpy(dictionary->hashes + dictionary->numWords, splits[i].hashes, sizeof(uint32_t) * n);
+        dictionary->numWords += n;
+        free(splits[i].words);
+        free(splits[i].lengths);
+        free(splits[i].hashes);
+    }
+
+    // Index phase
+    dictionary->numBuckets = 1;
+    while (dictionary->numBuckets < numWords)
+    {
+        dictionary->numBuckets *= 2;
+    }
+    dictionary->buckets = malloc(sizeof(int) * dictionary->numBuckets);
+    memset(dictionary->buckets, 0xff, sizeof(int) * dictionary->numBuckets);
+    char *duplicate = calloc(numWords + 1, 1);
+    for (int i = 0; i < threads; i++)
+    {
+        indexes[i].dictionary = dictionary;
+        indexes[i].first = (int)((long long)dictionary->numBuckets * i / threads);
+        indexes[i].last = (int)((long long)dictionary->numBuckets * (i + 1) / threads);
+        indexes[i].duplicate = duplicate;
+        pthread_create(&workers[i], NULL, indexRange, &indexes[i]);
+    }
+    for (int i = 0; i < threads; i++)
+    {
+        pthread_join(workers[i], NULL);
+    }
+    removeDuplicates(dictionary, duplicate);
+    free(duplicate);
+    dictionary->maxLength = 0;
+    for (int i = 0; i < dictionary->numWords; i++)
+    {
+        if (dictionary->lengths[i] > dictionary->maxLength)
+        {
+            dictionary->maxLength = dictionary->lengths[i];
+        }
+    }
+    return dictionary;
+}
+
+/**
+ * Unmaps the file and frees the dictionary.
+ * @param dictionary
+ */
+void dictionaryDelete(Dictionary *dictionary)
+{
+    assert(dictionary != NULL);
+    tokenizerUnmapFile(dictionary->data, dictionary->length);
+    free(dictionary->words);
+    free(dictionary->lengths);
+    free(dictionary->hashes);
+    free(dictionary->next);
+    free(dictionary->buckets);
+    free(dictionary);
+}
+
+/**
+ * Looks up a word. The word must already be lower case.
+ * @param dictionary
+ * @param word
+ * @return The number of the word, or -1 if it is not in the dictionary.
+ */
+int dictionaryFind(Dictionary *dictionary, const char *word)
+{
+    assert(dictionary != NULL);
+    assert(word != NULL);
+    int length;
+    uint32_t hash = fnvHashString32(word, &length);
+    int i = dictionary->buckets[hash & (uint32_t)(dictionary->numBuckets - 1)];
+    while (i >= 0 && (dictionary->hashes[i] != hash || dictionary->lengths[i] != length ||
+                      memcmp(dictionary->words[i], word, length) != 0))
+    {
+        i = dictionary->next[i];
+    }
+    return i;
+}
+
+/**
+ * Finds several words at once. All the words of a group are hashed and their
+ * buckets prefetched before any chain is followed, so that the cache misses
+ * of the group overlap instead of coming one after the other.
+ * @param dictionary
+ * @param words
+ * @param count Number of words.
+ * @param found Set to the number of each word, -1 for those not found.
+ */
+void dictionaryFindBatch(Dictionary *dictionary, const char *const *words, int count, int *found)
+{
+    assert(dictionary != NULL);
+    assert(words != NULL || count == 0);
+    uint32_t hashes[DICTIONARY_BATCH];
+    int lengths[DICTIONARY_BATCH];
+    uint32_t mask = (uint32_t)(dictionary->numBuckets - 1);
+    for (int first = 0; first < count; first += DICTIONARY_BATCH)
+    {
+        int size = count - first < DICTIONARY_BATCH ? count - first : DICTIONARY_BATCH;
+        for (int k = 0; k < size; k++)
+        {
+            hashes[k] = fnvHashString32(words[first + k], &lengths[k]);
+            __builtin_prefetch(&dictionary->buckets[hashes[k] & mask]);
+        }
+        for (int k = 0; k < size; k++)
+        {
+            int i = dictionary->buckets[hashes[k] & mask];
+            while (i >= 0 &&
+                   (dictionary->hashes[i] != hashes[k] || dictionary->lengths[i] != lengths[k] ||
+                    memcmp(dictionary->words[i], words[first + k], lengths[k]) != 0))
+            {
+                i = dictionary->next[i];
+            }
+            found[first + k] = i;
+        }
+    }
+}
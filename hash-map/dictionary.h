@@ -0,0 +1,42 @@
+#ifndef DICTIONARY_H
+#define DICTIONARY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define DICTIONARY_MAX_THREADS 64
+#define DICTIONARY_BATCH 16
+
+typedef struct Dictionary Dictionary;
+
+/*
+ * A read-only set of words loaded from a file of one word per line. The file
+ * is mapped into memory and each word is terminated in place, so words point
+ * into the mapping and nothing is allocated per word. Words are found through
+ * a chained hash index of word numbers sized for one word per bucket.
+ */
+struct Dictionary
+{
+    // Private, writable mapping of the file.
+    char *data;
+    size_t length;
+    // Distinct words in file order, and their lengths and hashes.
+    char **words;
+    int *lengths;
+    uint32_t *hashes;
+    int numWords;
+    // Length of the longest word.
+    int maxLength;
+    // First word of each bucket and next word of the same bucket, -1 for none.
+    // The number of buckets is a power of two.
+    int *buckets;
+    int *next;
+    int numBuckets;
+};
+
+Dictionary *dictionaryLoad(const char *fileName, int threads);
+void dictionaryDelete(Dictionary *dictionary);
+int dictionaryFind(Dictionary *dictionary, const char *word);
+void dictionaryFindBatch(Dictionary *dictionary, const char *const *words, int count, int *found);
+
+#endif
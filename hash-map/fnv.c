@@ -0,0 +1,56 @@
+#include "fnv.h"
+
+#define FNV_PRIME_32 16777619u
+#define FNV_PRIME_64 1099511628211ULL
+
+/**
+ * Hashes bytes with 32-bit FNV-1a, going on from the given hash so that
+ * several ranges can be hashed as one.
+ * @param bytes
+ * @param length
+ * @param hash FNV_OFFSET_32, or the hash of the bytes before.
+ * @return The hash.
+ */
+uint32_t fnvHash32(const void *bytes, size_t length, uint32_t hash)
+{
+    const unsigned char *p = bytes;
+    for (size_t i = 0; i < length; i++)
+    {
+        hash = (hash ^ p[i]) * FNV_PRIME_32;
+    }
+    return hash;
+}
+
+/**
+ * Hashes a string with 32-bit FNV-1a, measuring its length on the way.
+ * @param string
+ * @param length Set to the length of the string.
+ * @return The hash.
+ */
+uint32_t fnvHashString32(const char *string, int *length)
+{
+    uint32_t hash = FNV_OFFSET_32;
+    const unsigned char *p = (const unsigned char *)string;
+    while (*p != '\0')
+    {
+        hash = (hash ^ *p++) * FNV_PRIME_32;
+    }
+    *length = (int)((const char *)p - string);
+    return hash;
+}
+
+/**
+ * Hashes a string with 64-bit FNV-1a. The low bits mix poorly, so callers
+ * using them apply a final mix.
+ * @param string
+ * @return The hash.
+ */
+uint64_t fnvHashString64(const char *string)
+{
+    uint64_t hash = FNV_OFFSET_64;
+    for (const unsigned char *p = (const unsigned char *)string; *p != '\0'; p++)
+    {
+        hash = (hash ^ *p) * FNV_PRIME_64;
+    }
+    return hash;
+}
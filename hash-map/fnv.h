@@ -0,0 +1,15 @@
+#ifndef FNV_H
+#define FNV_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Starting values of the 32 and 64-bit FNV-1a hashes.
+#define FNV_OFFSET_32 2166136261u
+#define FNV_OFFSET_64 1469598103934665603ULL
+
+uint32_t fnvHash32(const void *bytes, size_t length, uint32_t hash);
+uint32_t fnvHashString32(const char *string, int *length);
+uint64_t fnvHashString64(const char *string);
+
+#endif
@@ -62,6 +62,7 @@ void hashMapInit(HashMap *map, int capacity)
 {
     map->capacity = capacity;
     map->size = 0;
+    map->resizes = 0;
     map->table = malloc(sizeof(HashLink *) * capacity);
     for (int i = 0; i < capacity; i++)
     {
@@ -185,10 +186,30 @@ void resizeTable(HashMap *map, int capacity)
 
     map->table = new->table;
     map->capacity = new->capacity;
+    map->resizes++;
 
     free(new);
 }
 
+/**
+ * Returns the index of the bucket that holds (or would hold) the given key.
+ * @param map
+ * @param key
+ * @return Bucket index.
+ */
+int hashMapBucket(HashMap *map, const char *key)
+{
+    assert(map != 0);
+    assert(key != 0);
+
+    int idx = HASH_FUNCTION(key) % hashMapCapacity(map);
+
+    if (idx < 0)
+        idx += hashMapCapacity(map);
+
+    return idx;
+}
+
 /**
  * Updates the given key-value pair in the hash table. If a link with the given
  * key already exists, this will just update the value and skip traversing. Otherwise, it will
@@ -239,6 +260,57 @@ void hashMapPut(HashMap *map, const char *key, int value)
     }
 }
 
+/**
+ * Adds the value of each link of src whose bucket number modulo period is in
+ * [first, last) to the link with the same key in dst, creating the link if
+ * needed. The capacities of both maps must be multiples of period, so these
+ * keys fall in the buckets of dst whose number modulo period is in the same
+ * range, and only those buckets of src are read. This never resizes dst and
+ * does not update its size, so several threads can merge disjoint ranges into
+ * the same map at once. Add the returned counts to dst->size when they are
+ * done.
+ * @param dst
+ * @param src
+ * @param period Common divisor of the capacities of both maps.
+ * @param first First bucket number modulo period to merge.
+ * @param last One past the last bucket number modulo period to merge.
+ * @return Number of links created in dst.
+ */
+int hashMapMergeRange(HashMap *dst, HashMap *src, int period, int first, int last)
+{
+    assert(dst != 0);
+    assert(src != 0);
+    assert(hashMapCapacity(dst) % period == 0 && hashMapCapacity(src) % period == 0);
+
+    int created = 0;
+    for (int base = 0; base < hashMapCapacity(src); base += period)
+    {
+        for (int i = base + first; i < base + last; i++)
+        {
+            for (struct HashLink *link = src->table[i]; link != NULL; link = link->next)
+            {
+                int idx = hashMapBucket(dst, link->key);
+                struct HashLink *current = dst->table[idx];
+                while (current != NULL && strcmp(current->key, link->key) != 0)
+                {
+                    current = current->next;
+                }
+
+                if (current != NULL)
+                {
+                    current->value += link->value;
+                }
+                else
+                {
+                    dst->table[idx] = hashLinkNew(link->key, link->value, dst->table[idx]);
+                    created++;
+                }
+            }
+        }
+    }
+    return created;
+}
+
 /**
  * Removes and frees the link with the given key from the table. If no such link
  * exists, this does nothing. Remember to search the entire linked list at the
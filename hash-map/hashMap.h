@@ -26,6 +26,8 @@ struct HashMap
     int size;
     // Number of buckets in the table.
     int capacity;
+    // Number of times the table has grown.
+    int resizes;
 };
 
 HashMap* hashMapNew(int capacity);
@@ -33,6 +35,8 @@ void hashMapDelete(HashMap* map);
 int* hashMapGet(HashMap* map, const char* key);
 void hashMapPut(HashMap* map, const char* key, int value);
 void hashMapRemove(HashMap* map, const char* key);
+int hashMapBucket(HashMap* map, const char* key);
+int hashMapMergeRange(HashMap* dst, HashMap* src, int period, int first, int last);
 int hashMapContainsKey(HashMap* map, const char* key);
 
 int hashMapSize(HashMap* map);
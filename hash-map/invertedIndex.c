@@ -0,0 +1,269 @@
+#include "invertedIndex.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+/**
+ * Creates an empty index.
+ * @return The allocated index.
+ */
+InvertedIndex *invertedIndexNew(void)
+{
+    InvertedIndex *index = malloc(sizeof(InvertedIndex));
+    index->words = hashMapNew(1024);
+    index->capacity = 1024;
+    index->size = 0;
+    index->lists = malloc(sizeof(PostingList) * index->capacity);
+    index->positions = 0;
+    return index;
+}
+
+/**
+ * Frees the index, its word map and all posting lists.
+ * @param index
+ */
+void invertedIndexDelete(InvertedIndex *index)
+{
+    for (int i = 0; i < index->size; i++)
+    {
+        free(index->lists[i].bytes);
+    }
+    free(index->lists);
+    hashMapDelete(index->words);
+    free(index);
+}
+
+/**
+ * Appends an unsigned integer to the list, 7 bits per byte, low bits first,
+ * with the high bit set on all bytes but the last.
+ * @param list
+ * @param value
+ */
+static void putVarint(PostingList *list, unsigned long long value)
+{
+    if (list->length + 10 > list->capacity)
+    {
+        list->capacity = list->capacity * 2 + 16;
+        list->bytes = realloc(list->bytes, list->capacity);
+    }
+    while (value >= 0x80)
+    {
+        list->bytes[list->length++] = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    list->bytes[list->length++] = (unsigned char)value;
+}
+
+/**
+ * Reads an integer written by putVarint.
+ * @param bytes
+ * @param at Index of the first byte, advanced past the integer.
+ * @return The integer.
+ */
+static unsigned long long getVarint(const unsigned char *bytes, size_t *at)
+{
+    unsigned long long value = 0;
+    int shift = 0;
+    unsigned char byte;
+    do
+    {
+        byte = bytes[(*at)++];
+        value |= (unsigned long long)(byte & 0x7f) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    return value;
+}
+
+/**
+ * Adds the next word of the input at the given line and column. Each posting
+ * is stored as the position delta, the line delta and either the column delta
+ * (same line) or the column itself (new line), so frequent words take about
+ * three bytes per occurrence.
+ * @param index
+ * @param word
+ * @param line
+ * @param column
+ */
+void invertedIndexAdd(InvertedIndex *index, const char *word, long long line,
+                      long long column)
+{
+    int *id = hashMapGet(index->words, word);
+    PostingList *list;
+    if (id != NULL)
+    {
+        list = &index->lists[*id];
+    }
+    else
+    {
+        if (index->size == index->capacity)
+        {
+            index->capacity *= 2;
+            index->lists = realloc(index->lists, sizeof(PostingList) * index->capacity);
+        }
+        hashMapPut(index->words, word, index->size);
+        list = &index->lists[index->size++];
+        list->bytes = NULL;
+        list->length = 0;
+        list->capacity = 0;
+        list->count = 0;
+        list->last.position = 0;
+        list->last.line = 1;
+        list->last.column = 0;
+    }
+
+    long long position = index->positions++;
+    putVarint(list, position - list->last.position);
+    putVarint(list, line - list->last.line);
+    putVarint(list, line == list->last.line ? column - list->last.column : column);
+    list->last.position = position;
+    list->last.line = line;
+    list->last.column = column;
+    list->count++;
+}
+
+/**
+ * Adds every word the tokenizer yields. Turns on line tracking, so it must be
+ * called before the tokenizer has returned any word.
+ * @param index
+ * @param tokenizer
+ * @return Number of words added.
+ */
+long long invertedIndexBuild(InvertedIndex *index, Tokenizer *tokenizer)
+{
+    char *word;
+    int length;
+    long long words = 0;
+    tokenizerTrackLines(tokenizer);
+    while (tokenizerNext(tokenizer, &word, &length))
+    {
+        invertedIndexAdd(index, word, tokenizer->wordLine, tokenizer->wordColumn);
+        words++;
+    }
+    return words;
+}
+
+/**
+ * Decodes a posting list.
+ * @param list
+ * @param postings Array with room for list->count postings.
+ */
+static void postingListDecode(PostingList *list, Posting *postings)
+{
+    Posting last = {0, 1, 0};
+    size_t at = 0;
+    for (int i = 0; i < list->count; i++)
+    {
+        long long positionDelta = (long long)getVarint(list->bytes, &at);
+        long long lineDelta = (long long)getVarint(list->bytes, &at);
+        long long column = (long long)getVarint(list->bytes, &at);
+        last.position += positionDelta;
+        last.column = lineDelta == 0 ? last.column + column : column;
+        last.line += lineDelta;
+        postings[i] = last;
+    }
+}
+
+/**
+ * Finds all occurrences of a word.
+ * @param index
+ * @param word
+ * @param postings Set to an allocated array of the occurrences in input order,
+ * or NULL if there are none. The caller frees it.
+ * @return Number of occurrences.
+ */
+int invertedIndexLookup(InvertedIndex *index, const char *word, Posting **postings)
+{
+    int *id = hashMapGet(index->words, word);
+    *postings = NULL;
+    if (id == NULL)
+    {
+        return 0;
+    }
+    PostingList *list = &index->lists[*id];
+    *postings = malloc(sizeof(Posting) * list->count);
+    postingListDecode(list, *postings);
+    return list->count;
+}
+
+/**
+ * Finds all occurrences of a phrase, the given words in consecutive positions.
+ * The posting lists are walked in lockstep, each advancing to the position the
+ * current start of the phrase requires of it.
+ * @param index
+ * @param words
+ * @param numWords
+ * @param postings Set to an allocated array of the occurrences of the first
+ * word of the phrase, or NULL if there are none. The caller frees it.
+ * @return Number of occurrences.
+ */
+int invertedIndexPhrase(InvertedIndex *index, const char **words, int numWords,
+                        Posting **postings)
+{
+    assert(numWords > 0);
+    Posting **lists = malloc(sizeof(Posting *) * numWords);
+    int *counts = malloc(sizeof(int) * numWords);
+    int *at = calloc(numWords, sizeof(int));
+    int found = 0;
+    int missing = 0;
+    for (int k = 0; k < numWords; k++)
+    {
+        counts[k] = invertedIndexLookup(index, words[k], &lists[k]);
+        missing |= counts[k] == 0;
+    }
+
+    *postings = NULL;
+    if (!missing)
+    {
+        *postings = malloc(sizeof(Posting) * counts[0]);
+        for (int i = 0; i < counts[0]; i++)
+        {
+            long long start = lists[0][i].position;
+            int k = 1;
+            for (; k < numWords; k++)
+            {
+                while (at[k] < counts[k] && lists[k][at[k]].position < start + k)
+                {
+                    at[k]++;
+                }
+                if (at[k] == counts[k] || lists[k][at[k]].position != start + k)
+                {
+                    break;
+                }
+            }
+            if (k == numWords)
+            {
+                (*postings)[found++] = lists[0][i];
+            }
+        }
+        if (found == 0)
+        {
+            free(*postings);
+            *postings = NULL;
+        }
+    }
+
+    for (int k = 0; k < numWords; k++)
+    {
+        free(lists[k]);
+    }
+    free(lists);
+    free(counts);
+    free(at);
+    return found;
+}
+
+/**
+ * Returns the total size of the compressed posting lists in bytes.
+ * @param index
+ * @return Compressed size.
+ */
+size_t invertedIndexBytes(InvertedIndex *index)
+{
+    size_t bytes = 0;
+    for (int i = 0; i < index->size; i++)
+    {
+        bytes += index->lists[i].length;
+    }
+    return bytes;
+}
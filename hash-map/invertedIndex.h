@@ -0,0 +1,62 @@
+#ifndef INVERTED_INDEX_H
+#define INVERTED_INDEX_H
+
+#include "hashMap.h"
+#include "tokenizer.h"
+#include <stddef.h>
+
+typedef struct Posting Posting;
+typedef struct PostingList PostingList;
+typedef struct InvertedIndex InvertedIndex;
+
+/*
+ * One occurrence of a word: its position in the word sequence of the input
+ * (starting at 0), its line (starting at 1) and its column (starting at 0).
+ */
+struct Posting
+{
+    long long position;
+    long long line;
+    long long column;
+};
+
+/*
+ * The occurrences of one word, in input order, compressed as varint encoded
+ * deltas from the previous occurrence.
+ */
+struct PostingList
+{
+    unsigned char *bytes;
+    size_t length;
+    size_t capacity;
+    // Number of postings in the list.
+    int count;
+    // Last posting added, the base for the next delta.
+    Posting last;
+};
+
+/*
+ * Maps each word to the list of its occurrences. The map stores the index of
+ * the word's posting list in lists.
+ */
+struct InvertedIndex
+{
+    HashMap *words;
+    PostingList *lists;
+    int size;
+    int capacity;
+    // Position of the next word added.
+    long long positions;
+};
+
+InvertedIndex *invertedIndexNew(void);
+void invertedIndexDelete(InvertedIndex *index);
+void invertedIndexAdd(InvertedIndex *index, const char *word, long long line,
+                      long long column);
+long long invertedIndexBuild(InvertedIndex *index, Tokenizer *tokenizer);
+int invertedIndexLookup(InvertedIndex *index, const char *word, Posting **postings);
+int invertedIndexPhrase(InvertedIndex *index, const char **words, int numWords,
+                        Posting **postings);
+size_t invertedIndexBytes(InvertedIndex *index);
+
+#endif
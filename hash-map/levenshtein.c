@@ -0,0 +1,267 @@
+#include "levenshtein.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#define MIN3(a, b, c) ((a) < (b) ? ((a) < (c) ? (a) : (c)) : ((b) < (c) ? (b) : (c)))
+
+/**
+ * Calculates Levenshtein distance with the dynamic programming recurrence, one
+ * column at a time. Kept as the reference for the bit-parallel version.
+ * Source: https://en.wikibooks.org/wiki/Algorithm_Implementation/Strings/Levenshtein_distance#C
+ */
+int levenshteinDistanceDp(const char *s1, const char *s2)
+{
+    unsigned int s1len, s2len, x, y, lastdiag, olddiag;
+    s1len = strlen(s1);
+    s2len = strlen(s2);
+    unsigned int column[s1len + 1];
+    for (y = 0; y <= s1len; y++)
+        column[y] = y;
+    for (x = 1; x <= s2len; x++)
+    {
+        column[0] = x;
+        for (y = 1, lastdiag = x - 1; y <= s1len; y++)
+        {
+            olddiag = column[y];
+            column[y] = MIN3(column[y] + 1, column[y - 1] + 1, lastdiag + (s1[y - 1] == s2[x - 1] ? 0 : 1));
+            lastdiag = olddiag;
+        }
+    }
+    return (column[s1len]);
+}
+
+/**
+ * Distance of a pattern of at most 64 characters to a text. Bit i of Pv and
+ * Mv is set if cell i of the current column is one more or one less than the
+ * cell above it, and the whole column advances with a few word operations per
+ * text character (Myers 1999, in Hyyrö's formulation for edit distance).
+ * @param pattern
+ * @param m Length of the pattern, 1 to 64.
+ * @param text
+ * @param n Length of the text.
+ * @return The distance.
+ */
+static int distanceWord(const unsigned char *pattern, int m, const unsigned char *text, int n)
+{
+    // Only the entries of the characters used are cleared and filled.
+    uint64_t peq[256];
+    for (int j = 0; j < n; j++)
+    {
+        peq[text[j]] = 0;
+    }
+    for (int i = 0; i < m; i++)
+    {
+        peq[pattern[i]] = 0;
+    }
+    for (int i = 0; i < m; i++)
+    {
+        peq[pattern[i]] |= (uint64_t)1 << i;
+    }
+
+    uint64_t last = (uint64_t)1 << (m - 1);
+    uint64_t pv = ~(uint64_t)0;
+    uint64_t mv = 0;
+    int score = m;
+    for (int j = 0; j < n; j++)
+    {
+        uint64_t eq = peq[text[j]];
+        uint64_t xv = eq | mv;
+        uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+        uint64_t ph = mv | ~(xh | pv);
+        uint64_t mh = pv & xh;
+        score += (ph & last) != 0;
+        score -= (mh & last) != 0;
+        // The first row grows by one per column.
+        ph = (ph << 1) | 1;
+        mh <<= 1;
+        pv = mh | ~(xv | ph);
+        mv = ph & xv;
+    }
+    return score;
+}
+
+/**
+ * Distance of a pattern of any length to a text, with the pattern split into
+ * blocks of 64 rows. Each block passes the horizontal difference of its last
+ * row down to the next, as the carry of the single word version.
+ * @param pattern
+ * @param m Length of the pattern, more than 64.
+ * @param text
+ * @param n Length of the text.
+ * @return The distance.
+ */
+static int distanceBlocks(const unsigned char *pattern, int m, const unsigned char *text, int n)
+{
+    int blocks = (m + 63) / 64;
+    uint64_t *peq = calloc((size_t)256 * blocks, sizeof(uint64_t));
+    uint64_t *pv = malloc(sizeof(uint64_t) * blocks);
+    uint64_t *mv = malloc(sizeof(uint64_t) * blocks);
+    for (int i = 0; i < m; i++)
+    {
+        peq[pattern[i] * blocks + i / 64] |= (uint64_t)1 << (i % 64);
+    }
+    for (int b = 0; b < blocks; b++)
+    {
+        pv[b] = ~(uint64_t)0;
+        mv[b] = 0;
+    }
+
+    uint64_t last = (uint64_t)1 << ((m - 1) % 64);
+    int score = m;
+    for (int j = 0; j < n; j++)
+    {
+        const uint64_t *eqs = peq + text[j] * blocks;
+        int carry = 1;
+        for (int b = 0; b < blocks; b++)
+        {
+            uint64_t eq = eqs[b];
+            uint64_t xv = eq | mv[b];
+            if (carry < 0)
+            {
+                eq |= 1;
+            }
+            uint64_t xh = (((eq & pv[b]) + pv[b]) ^ pv[b]) | eq;
+            uint64_t ph = mv[b] | ~(xh | pv[b]);
+            uint64_t mh = pv[b] & xh;
+            uint64_t high = b == blocks - 1 ? last : (uint64_t)1 << 63;
+            int out = (ph & high) ? 1 : (mh & high) ? -1 : 0;
+            ph <<= 1;
+            mh <<= 1;
+            if (carry < 0)
+            {
+                mh |= 1;
+            }
+            else if (carry > 0)
+            {
+                ph |= 1;
+            }
+            pv[b] = mh | ~(xv | ph);
+            mv[b] = ph & xv;
+            carry = out;
+        }
+        score += carry;
+    }
+    free(peq);
+    free(pv);
+    free(mv);
+    return score;
+}
+
+/**
+ * Distance of two strings of known lengths with bit-parallel columns.
+ * @param a
+ * @param m Length of a, at most n.
+ * @param b
+ * @param n Length of b.
+ * @return The distance.
+ */
+static int distanceOrdered(const unsigned char *a, int m, const unsigned char *b, int n)
+{
+    if (m == 0)
+    {
+        return n;
+    }
+    return m <= 64 ? distanceWord(a, m, b, n) : distanceBlocks(a, m, b, n);
+}
+
+/**
+ * Calculates Levenshtein distance with bit-parallel columns. The shorter word
+ * is the pattern, so that words of up to 64 characters take one machine word
+ * per column, and longer ones take one per 64 characters.
+ * @param s1
+ * @param s2
+ * @return The distance.
+ */
+int levenshteinDistance(const char *s1, const char *s2)
+{
+    int n1 = (int)strlen(s1);
+    int n2 = (int)strlen(s2);
+    return n1 <= n2 ? distanceOrdered((const unsigned char *)s1, n1, (const unsigned char *)s2, n2)
+                    : distanceOrdered((const unsigned char *)s2, n2, (const unsigned char *)s1, n1);
+}
+
+/**
+ * Calculates Levenshtein distance if it is at most k. Only the cells within k
+ * of the diagonal can be at most k (Ukkonen), so each row is computed on that
+ * band only, and the computation stops as soon as every cell of a row, plus
+ * the length difference left from it to the end, is more than k. A band
+ * covering most of the table is computed with the bit-parallel version.
+ * @param s1
+ * @param s2
+ * @param k Largest distance of interest, at least 0.
+ * @return The distance, or k + 1 if it is more than k.
+ */
+int levenshteinBounded(const char *s1, const char *s2, int k)
+{
+    return levenshteinBoundedLength(s1, (int)strlen(s1), s2, (int)strlen(s2), k);
+}
+
+/**
+ * Same as levenshteinBounded for strings of known lengths, which need not be
+ * terminated, such as words packed one after the other.
+ * @param s1
+ * @param n1 Length of s1.
+ * @param s2
+ * @param n2 Length of s2.
+ * @param k Largest distance of interest, at least 0.
+ * @return The distance, or k + 1 if it is more than k.
+ */
+int levenshteinBoundedLength(const char *s1, int n1, const char *s2, int n2, int k)
+{
+    const char *a = n1 <= n2 ? s1 : s2;
+    const char *b = n1 <= n2 ? s2 : s1;
+    int m = n1 <= n2 ? n1 : n2;
+    int n = n1 <= n2 ? n2 : n1;
+    if (n - m > k)
+    {
+        return k + 1;
+    }
+    if (2 * k + 1 >= m)
+    {
+        // The band is most of the table: a whole column per word is cheaper.
+        int distance = distanceOrdered((const unsigned char *)a, m, (const unsigned char *)b, n);
+        return distance <= k ? distance : k + 1;
+    }
+
+    // Cells more than k are stored as k + 1.
+    int row[n + 1];
+    for (int j = 0; j <= n; j++)
+    {
+        row[j] = j <= k ? j : k + 1;
+    }
+    for (int i = 1; i <= m; i++)
+    {
+        int low = i - k > 1 ? i - k : 1;
+        int high = i + k < n ? i + k : n;
+        int diagonal = row[low - 1];
+        row[low - 1] = low == 1 ? (i <= k ? i : k + 1) : k + 1;
+        int smallest = low == 1 ? row[0] + abs(n - (m - i)) : k + 1;
+        for (int j = low; j <= high; j++)
+        {
+            int up = row[j];
+            int value = diagonal + (a[i - 1] != b[j - 1]);
+            if (up + 1 < value)
+            {
+                value = up + 1;
+            }
+            if (row[j - 1] + 1 < value)
+            {
+                value = row[j - 1] + 1;
+            }
+            diagonal = up;
+            row[j] = value < k + 1 ? value : k + 1;
+            // The rest of the path must still make up the length difference.
+            int bound = row[j] + abs((n - j) - (m - i));
+            if (bound < smallest)
+            {
+                smallest = bound;
+            }
+        }
+        if (smallest > k)
+        {
+            return k + 1;
+        }
+    }
+    return row[n];
+}
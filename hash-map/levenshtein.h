@@ -0,0 +1,9 @@
+#ifndef LEVENSHTEIN_H
+#define LEVENSHTEIN_H
+
+int levenshteinDistance(const char *s1, const char *s2);
+int levenshteinDistanceDp(const char *s1, const char *s2);
+int levenshteinBounded(const char *s1, const char *s2, int k);
+int levenshteinBoundedLength(const char *s1, int n1, const char *s2, int n2, int k);
+
+#endif
@@ -1,107 +1,892 @@
 #include "hashMap.h"
+#include "tokenizer.h"
+#include "concordance.h"
+#include "stream.h"
+#include "wordSort.h"
+#include "writer.h"
+#include "invertedIndex.h"
+#include "countMinSketch.h"
+#include "ngram.h"
+#include "checkpoint.h"
+#include "profile.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
-#include <time.h>
 #include <assert.h>
 #include <ctype.h>
+#include <math.h>
+
+typedef struct Options Options;
+
+enum SortOrder
+{
+    SORT_NONE,
+    SORT_ALPHA,
+    SORT_COUNT
+};
+
+enum ReportFormat
+{
+    REPORT_NONE,
+    REPORT_TABLE,
+    REPORT_JSON
+};
+
+/*
+ * Command line options of the concordance.
+ */
+struct Options
+{
+    const char *fileName;
+    // Number of counting threads, or 0 to count sequentially from the file.
+    int threads;
+    // Order of the printed concordance, SORT_NONE for bucket order.
+    enum SortOrder sort;
+    // 1 to build a positional index instead of counting.
+    int index;
+    // Words or phrases to look up in the index, pointing into argv.
+    const char **queries;
+    int numQueries;
+    // 1 to count approximately with a Count-Min Sketch.
+    int approx;
+    // Error bound and failure probability of the sketch.
+    double epsilon;
+    double delta;
+    // Words estimated at least this often are counted exactly, 0 for none.
+    int exactAbove;
+    // 1 to also count exactly and report the sketch's error.
+    int check;
+    // Words per n-gram to count instead of single words, or 0.
+    int ngram;
+    // Checkpoint to resume from and save to, or NULL.
+    const char *checkpoint;
+    // Blocks read ahead by a reader thread, or 0 to read on the counting thread.
+    int readAhead;
+    // Format of the phase timing report printed at exit, if any.
+    enum ReportFormat profileFormat;
+    // Phase timers of this run.
+    Profile *profile;
+    // 1 to count all inputs as a stream with incremental reports.
+    int stream;
+    StreamOptions streamOptions;
+    // File name arguments, pointing into argv.
+    const char **inputs;
+    int numInputs;
+};
 
 /**
- * Allocates a string for the next word in the file and returns it. This string
- * is null terminated. Returns NULL after reaching the end of the file.
- * @param file
- * @return Allocated string or NULL.
+ * Prints the command line usage.
+ * @param program
  */
-char *nextWord(FILE *file)
+static void printUsage(const char *program)
 {
-    int maxLength = 16;
-    int length = 0;
-    char *word = malloc(sizeof(char) * maxLength);
+    fprintf(stderr, "Usage: %s [-j threads] [--sort=count|alpha] [--read-ahead=BLOCKS]\n"
+                    "           [filename]\n",
+            program);
 
-    while (1)
+    fprintf(stderr, "       %s --index [--query=WORDS]... [filename]\n", program);
+    fprintf(stderr, "       %s --approx [--epsilon=E] [--sketch-delta=D] [--exact-above=COUNT]\n"
+                    "           [--check] [filename]\n",
+            program);
+    fprintf(stderr, "       %s --ngram=N [filename]...\n", program);
+    fprintf(stderr, "       %s --checkpoint=PATH [--sort=count|alpha] [filename]...\n", program);
+    fprintf(stderr, "       %s --stream [--top=N] [--every=WORDS] [--interval=SECONDS]\n"
+                    "           [--delta] [--counters=M] [file|pattern|-]...\n",
+            program);
+    fprintf(stderr, "       %s --topk=K [--counters=M] [file|pattern|-]...\n", program);
+    fprintf(stderr, "Any mode also takes --profile[=table|json] to report phase timings\n"
+                    "and hardware counters on standard error at exit.\n");
+}
+
+/**
+ * Parses the command line into options.
+ * @param argc
+ * @param argv
+ * @param options
+ * @return 1 if the arguments are valid, 0 otherwise.
+ */
+static int parseArguments(int argc, const char **argv, Options *options)
+{
+    options->fileName = "input1.txt";
+    options->threads = 0;
+    options->sort = SORT_NONE;
+    options->index = 0;
+    options->approx = 0;
+    options->epsilon = 0.001;
+    options->delta = 0.01;
+    options->exactAbove = 0;
+    options->check = 0;
+    options->ngram = 0;
+    options->checkpoint = NULL;
+    options->readAhead = BLOCK_READER_DEPTH;
+    options->profileFormat = REPORT_NONE;
+    options->profile = NULL;
+    options->queries = malloc(sizeof(const char *) * argc);
+    options->numQueries = 0;
+    options->stream = 0;
+    options->streamOptions.top = 10;
+    options->streamOptions.everyWords = 0;
+    options->streamOptions.everySeconds = 0;
+    options->streamOptions.delta = 0;
+    options->streamOptions.counters = 0;
+    options->inputs = malloc(sizeof(const char *) * argc);
+    options->numInputs = 0;
+    for (int i = 1; i < argc; i++)
     {
-        char c = fgetc(file);
-        if ((c >= '0' && c <= '9') ||
-            (c >= 'A' && c <= 'Z') ||
-            (c >= 'a' && c <= 'z') ||
-            c == '\'')
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+        {
+            options->threads = atoi(argv[++i]);
+            if (options->threads < 1 || options->threads > CONCORDANCE_MAX_THREADS)
+            {
+                fprintf(stderr, "Thread count must be between 1 and %d\n",
+                        CONCORDANCE_MAX_THREADS);
+                return 0;
+            }
+        }
+        else if (strcmp(argv[i], "--sort=alpha") == 0)
+        {
+            options->sort = SORT_ALPHA;
+        }
+        else if (strcmp(argv[i], "--sort=count") == 0)
+        {
+            options->sort = SORT_COUNT;
+        }
+        else if (strcmp(argv[i], "--index") == 0)
+        {
+            options->index = 1;
+        }
+        else if (strncmp(argv[i], "--query=", 8) == 0)
+        {
+            options->queries[options->numQueries++] = argv[i] + 8;
+        }
+        else if (strcmp(argv[i], "--approx") == 0)
+        {
+            options->approx = 1;
+        }
+        else if (strncmp(argv[i], "--epsilon=", 10) == 0)
+        {
+            options->epsilon = atof(argv[i] + 10);
+            if (options->epsilon <= 0 || options->epsilon >= 1 ||
+                exp(1.0) / options->epsilon > COUNT_MIN_SKETCH_MAX_WIDTH)
+            {
+                return 0;
+            }
+        }
+        else if (strncmp(argv[i], "--sketch-delta=", 15) == 0)
+        {
+            options->delta = atof(argv[i] + 15);
+            if (options->delta <= 0 || options->delta >= 1)
+            {
+                return 0;
+            }
+        }
+        else if (strncmp(argv[i], "--exact-above=", 14) == 0)
+        {
+            options->exactAbove = atoi(argv[i] + 14);
+        }
+        else if (strcmp(argv[i], "--check") == 0)
+        {
+            options->check = 1;
+        }
+        else if (strncmp(argv[i], "--ngram=", 8) == 0)
+        {
+            options->ngram = atoi(argv[i] + 8);
+            if (options->ngram < 1 || options->ngram > NGRAM_MAX)
+            {
+                fprintf(stderr, "N-gram length must be between 1 and %d\n", NGRAM_MAX);
+                return 0;
+            }
+        }
+        else if (strncmp(argv[i], "--checkpoint=", 13) == 0)
+        {
+            options->checkpoint = argv[i] + 13;
+        }
+        else if (strncmp(argv[i], "--read-ahead=", 13) == 0)
+        {
+            options->readAhead = atoi(argv[i] + 13);
+            if (options->readAhead == 1 || options->readAhead < 0)
+            {
+                fprintf(stderr, "Read-ahead needs at least 2 blocks, or 0 for none\n");
+                return 0;
+            }
+        }
+        else if (strcmp(argv[i], "--profile") == 0 || strcmp(argv[i], "--profile=table") == 0)
         {
-            if (length + 1 >= maxLength)
+            options->profileFormat = REPORT_TABLE;
+        }
+        else if (strcmp(argv[i], "--profile=json") == 0)
+        {
+            options->profileFormat = REPORT_JSON;
+        }
+        else if (strcmp(argv[i], "--stream") == 0)
+        {
+            options->stream = 1;
+        }
+        else if (strncmp(argv[i], "--top=", 6) == 0)
+        {
+            options->streamOptions.top = atoi(argv[i] + 6);
+            if (options->streamOptions.top < 1)
             {
-                maxLength *= 2;
-                word = realloc(word, maxLength);
+                return 0;
             }
-            // .............
-            word[length] = c;
-            length++;
         }
-        else if (length > 0 || c == EOF)
+        else if (strncmp(argv[i], "--every=", 8) == 0)
+        {
+            options->streamOptions.everyWords = atoll(argv[i] + 8);
+        }
+        else if (strncmp(argv[i], "--interval=", 11) == 0)
         {
-            break;
+            options->streamOptions.everySeconds = atof(argv[i] + 11);
+        }
+        else if (strncmp(argv[i], "--topk=", 7) == 0)
+        {
+            // Top-K only: a stream over a Space-Saving summary, reported once.
+            options->stream = 1;
+            options->streamOptions.top = atoi(argv[i] + 7);
+            if (options->streamOptions.top < 1)
+            {
+                return 0;
+            }
+            if (options->streamOptions.counters == 0)
+            {
+                options->streamOptions.counters = -1;
+            }
+        }
+        else if (strncmp(argv[i], "--counters=", 11) == 0)
+        {
+            options->streamOptions.counters = atoi(argv[i] + 11);
+            if (options->streamOptions.counters < 1)
+            {
+                return 0;
+            }
+        }
+        else if (strcmp(argv[i], "--delta") == 0)
+        {
+            options->streamOptions.delta = 1;
+        }
+        else if (argv[i][0] == '-' && argv[i][1] != '\0')
+        {
+            return 0;
+        }
+        else
+        {
+            options->inputs[options->numInputs++] = argv[i];
         }
     }
-    if (length == 0)
+    if (options->numInputs > 0)
     {
-        free(word);
-        return NULL;
+        options->fileName = options->inputs[0];
     }
-    word[length] = '\0';
-    return word;
+    if (options->streamOptions.counters < 0)
+    {
+        // Default to ten counters per reported word for tighter bounds.
+        options->streamOptions.counters = 10 * options->streamOptions.top;
+    }
+    else if (options->streamOptions.counters > 0 &&
+             options->streamOptions.counters < options->streamOptions.top)
+    {
+        options->streamOptions.counters = options->streamOptions.top;
+    }
+    return 1;
 }
 
 /**
- * Prints the concordance of the given file and performance information. Uses
- * the file input1.txt by default or a file name specified as a command line
- * argument.
- * @param argc
- * @param argv
- * @return
+ * Creates a tokenizer for the file, reading it on a separate thread when
+ * readAhead is set so that disk reads overlap with counting.
+ * @param fp
+ * @param readAhead Number of blocks read ahead, or 0.
+ * @return The allocated tokenizer.
  */
-int main(int argc, const char **argv)
+static Tokenizer *openTokenizer(FILE *fp, int readAhead)
 {
-    const char *fileName = "input1.txt";
-    if (argc > 1)
+    Tokenizer *tokenizer = tokenizerNew(fp);
+    if (readAhead > 0)
     {
-        fileName = argv[1];
+        tokenizerPipeline(tokenizer, readAhead);
     }
-    printf("Opening file: %s\n", fileName);
+    return tokenizer;
+}
 
-    clock_t timer = clock();
+/**
+ * Frees a tokenizer made by openTokenizer and closes its file, reporting a
+ * failed read.
+ * @param tokenizer
+ * @param fp
+ * @param fileName Name of the file, for the error message.
+ * @return 0 if the whole file was read, 1 after a read error.
+ */
+static int closeTokenizer(Tokenizer *tokenizer, FILE *fp, const char *fileName)
+{
+    int error = tokenizer->error;
+    tokenizerDelete(tokenizer);
+    fclose(fp);
+    if (error != 0)
+    {
+        fprintf(stderr, "Could not read file: %s: %s\n", fileName, strerror(error));
+        return 1;
+    }
+    return 0;
+}
 
+/**
+ * Counts the words of the file sequentially.
+ * @param fileName
+ * @param readAhead Number of blocks read ahead by a reader thread, or 0.
+ * @return The concordance map, or NULL if the file could not be opened or
+ *         read.
+ */
+static HashMap *countSequential(const char *fileName, int readAhead)
+{
+    // Words are views into the tokenizer's buffer, so nothing is freed here.
+    FILE *fp = fopen(fileName, "r");
+    if (fp == NULL)
+    {
+        return NULL;
+    }
     HashMap *map = hashMapNew(10);
+    Tokenizer *tokenizer = openTokenizer(fp, readAhead);
+    concordanceCount(map, tokenizer);
+    if (closeTokenizer(tokenizer, fp, fileName) != 0)
+    {
+        hashMapDelete(map);
+        return NULL;
+    }
+    return map;
+}
 
-    // --- Concordance code begins here ---
-    // Be sure to free the word after you are done with it here.
-    FILE *fp;
-    fp = fopen(fileName, "r");
-    char *word = nextWord(fp);
-    int *value;
+/**
+ * Counts the words of the file with several threads.
+ * @param fileName
+ * @param threads
+ * @param stats Filled with timing information for the scaling report.
+ * @return The concordance map, or NULL if the file could not be mapped.
+ */
+static HashMap *countParallel(const char *fileName, int threads,
+                              ConcordanceStats *stats)
+{
+    size_t length;
+    char *data = tokenizerMapFile(fileName, &length);
+    if (data == NULL)
+    {
+        return NULL;
+    }
+    HashMap *map = concordanceCountParallel(data, length, threads, stats);
+    tokenizerUnmapFile(data, length);
+    return map;
+}
 
-    while (word != NULL)
+/**
+ * Prints the concordance sorted alphabetically or by count, one word and its
+ * count per line, through a buffered writer.
+ * @param map
+ * @param sort
+ * @param threads Threads to sort with.
+ * @param profile Timers of the sort and write phases.
+ */
+static void printSorted(HashMap *map, enum SortOrder sort, int threads, Profile *profile)
+{
+    profileBegin(profile, "sort");
+    int size;
+    WordCount *words = wordCountsFromMap(map, &size);
+    if (sort == SORT_COUNT)
+    {
+        wordSortCount(words, size, threads);
+    }
+    else
     {
-        value = hashMapGet(map, word);
+        wordSortAlpha(words, size, threads);
+    }
+    profileEnd(profile);
+
+    profileBegin(profile, "write");
+    Writer writer;
+    fflush(stdout);
+    writerInit(&writer, stdout, WRITER_BUFFER_SIZE);
+    wordCountsWrite(&writer, words, size);
+    writerCleanUp(&writer);
+    profileEnd(profile);
+    free(words);
+}
+
+/**
+ * Looks up a word or phrase in the index and prints where it occurs.
+ * @param index
+ * @param query Words of the phrase, split like the indexed text.
+ */
+static void printQuery(InvertedIndex *index, const char *query)
+{
+    size_t length = strlen(query);
+    char *text = malloc(length + 1);
+    memcpy(text, query, length + 1);
+    const char **words = malloc(sizeof(const char *) * (length / 2 + 1));
+    int numWords = 0;
+    Tokenizer tokenizer;
+    tokenizerInitBuffer(&tokenizer, text, length);
+    char *word;
+    int wordLength;
+    while (tokenizerNext(&tokenizer, &word, &wordLength))
+    {
+        words[numWords++] = word;
+    }
+    tokenizerCleanUp(&tokenizer);
+
+    Posting *postings = NULL;
+    int found = numWords > 0 ? invertedIndexPhrase(index, words, numWords, &postings) : 0;
+    printf("\nQuery \"%s\": %d %s\n", query, found, found == 1 ? "match" : "matches");
+    for (int i = 0; i < found; i++)
+    {
+        printf("  line %lld, column %lld\n", postings[i].line, postings[i].column);
+    }
+    free(postings);
+    free(words);
+    free(text);
+}
+
+/**
+ * Builds a positional index of the file, prints its size and answers the
+ * queries from it.
+ * @param options
+ * @return 0 on success, 1 if the file could not be opened or read.
+ */
+static int runIndex(Options *options)
+{
+    FILE *fp = fopen(options->fileName, "r");
+    if (fp == NULL)
+    {
+        fprintf(stderr, "Could not open file: %s\n", options->fileName);
+        return 1;
+    }
+    profileBegin(options->profile, "index");
+    InvertedIndex *index = invertedIndexNew();
+    Tokenizer *tokenizer = openTokenizer(fp, options->readAhead);
+    long long words = invertedIndexBuild(index, tokenizer);
+    profileEnd(options->profile);
+    if (closeTokenizer(tokenizer, fp, options->fileName) != 0)
+    {
+        invertedIndexDelete(index);
+        return 1;
+    }
+
+    size_t bytes = invertedIndexBytes(index);
+    printf("Indexed %lld words, %d distinct, in %f seconds\n", words, index->size,
+           profileWall(options->profile, "index"));
+    printf("Posting lists: %zu bytes (%.2f bytes per posting, %zu uncompressed)\n",
+           bytes, words > 0 ? (double)bytes / words : 0, (size_t)words * sizeof(Posting));
+
+    profileBegin(options->profile, "query");
+    for (int i = 0; i < options->numQueries; i++)
+    {
+        printQuery(index, options->queries[i]);
+    }
+    profileEnd(options->profile);
+    invertedIndexDelete(index);
+    return 0;
+}
+
+/**
+ * Compares the sketch's estimates (or, for promoted words, the exact count
+ * plus the estimate at promotion) against the true counts and prints the
+ * error statistics.
+ * @param sketch
+ * @param exact Counts of promoted words since their promotion, or NULL.
+ * @param before Estimates of promoted words when they were promoted.
+ * @param truth True counts of all words.
+ * @param epsilon
+ */
+static void printSketchError(CountMinSketch *sketch, HashMap *exact, HashMap *before,
+                             HashMap *truth, double epsilon)
+{
+    double bound = epsilon * sketch->total;
+    long long errorSum = 0;
+    long long maxError = 0;
+    int exactWords = 0;
+    int withinBound = 0;
+    int words = 0;
+    for (int i = 0; i < hashMapCapacity(truth); i++)
+    {
+        for (HashLink *link = truth->table[i]; link != NULL; link = link->next)
+        {
+            int *value = exact != NULL ? hashMapGet(exact, link->key) : NULL;
+            long long estimate = value != NULL ? *value + *hashMapGet(before, link->key)
+                                               : countMinSketchEstimate(sketch, link->key);
+            long long error = estimate - link->value;
+            errorSum += error;
+            maxError = error > maxError ? error : maxError;
+            exactWords += error == 0;
+            withinBound += error <= bound;
+            words++;
+        }
+    }
+    printf("Error against exact counts over %d distinct words:\n", words);
+    printf("  Exact estimates: %d (%.2f%%)\n", exactWords,
+           words > 0 ? 100.0 * exactWords / words : 100);
+    printf("  Mean error: %f\n", words > 0 ? (double)errorSum / words : 0);
+    printf("  Max error: %lld\n", maxError);
+    printf("  Within epsilon * total (%.1f): %.2f%%\n", bound,
+           words > 0 ? 100.0 * withinBound / words : 100);
+}
+
+/**
+ * Prints the promoted words by their exact count since promotion, each with
+ * that count and the sketch's estimate when it was promoted, which bounds its
+ * earlier occurrences from above.
+ * @param exact
+ * @param before
+ * @param threads
+ * @param profile
+ */
+static void printPromoted(HashMap *exact, HashMap *before, int threads, Profile *profile)
+{
+    profileBegin(profile, "sort");
+    int size;
+    WordCount *words = wordCountsFromMap(exact, &size);
+    wordSortCount(words, size, threads);
+    profileEnd(profile);
+
+    profileBegin(profile, "write");
+    printf("Word, exact count since promotion, estimate at promotion (at most):\n");
+    Writer writer;
+    fflush(stdout);
+    writerInit(&writer, stdout, WRITER_BUFFER_SIZE);
+    for (int i = 0; i < size; i++)
+    {
+        writerString(&writer, words[i].word, strlen(words[i].word));
+        writerChar(&writer, '\t');
+        writerInt(&writer, words[i].count);
+        writerChar(&writer, '\t');
+        writerInt(&writer, *hashMapGet(before, words[i].word));
+        writerChar(&writer, '\n');
+    }
+    writerCleanUp(&writer);
+    profileEnd(profile);
+    free(words);
+}
+
+/**
+ * Counts the file approximately with a Count-Min Sketch of fixed size. With a
+ * threshold, words whose estimate reaches it are promoted: counted exactly
+ * from then on, and printed with both parts of their count. With checking, exact counts are kept as well to report the
+ * sketch's error.
+ * @param options
+ * @return 0 on success, 1 if the file could not be opened or read.
+ */
+static int runApprox(Options *options)
+{
+    FILE *fp = fopen(options->fileName, "r");
+    if (fp == NULL)
+    {
+        fprintf(stderr, "Could not open file: %s\n", options->fileName);
+        return 1;
+    }
+    CountMinSketch *sketch = countMinSketchNew(options->epsilon, options->delta);
+    if (sketch == NULL)
+    {
+        fprintf(stderr, "Could not allocate sketch\n");
+        fclose(fp);
+        return 1;
+    }
+    profileBegin(options->profile, "count");
+    HashMap *exact = options->exactAbove > 0 ? hashMapNew(10) : NULL;
+    // Estimate of each promoted word when it was promoted.
+    HashMap *before = options->exactAbove > 0 ? hashMapNew(10) : NULL;
+    HashMap *truth = options->check ? hashMapNew(10) : NULL;
+    Tokenizer *tokenizer = openTokenizer(fp, options->readAhead);
+    char *word;
+    int length;
+    while (tokenizerNext(tokenizer, &word, &length))
+    {
+        if (truth != NULL)
+        {
+            concordanceAdd(truth, word);
+        }
+        int *value = exact != NULL ? hashMapGet(exact, word) : NULL;
         if (value != NULL)
         {
-            hashMapPut(map, word, *value + 1);
+            (*value)++;
         }
         else
         {
-            hashMapPut(map, word, 1);
+            unsigned int estimate = countMinSketchAdd(sketch, word);
+            if (exact != NULL && estimate >= (unsigned int)options->exactAbove)
+            {
+                // The occurrences so far, this one included, are only known
+                // up to the estimate; the next ones are counted exactly.
+                hashMapPut(exact, word, 0);
+                hashMapPut(before, word, (int)estimate);
+            }
         }
-        free(word);
-        word = nextWord(fp);
     }
-    fclose(fp);
-    hashMapPrint(map);
+    profileEnd(options->profile);
+    if (closeTokenizer(tokenizer, fp, options->fileName) != 0)
+    {
+        if (exact != NULL)
+        {
+            hashMapDelete(exact);
+            hashMapDelete(before);
+        }
+        if (truth != NULL)
+        {
+            hashMapDelete(truth);
+        }
+        countMinSketchDelete(sketch);
+        return 1;
+    }
+
+    if (exact != NULL)
+    {
+        printPromoted(exact, before, options->threads, options->profile);
+    }
+    printf("\nRan in %f seconds\n", profileWall(options->profile, "count"));
+    printf("Sketch: %d x %d counters, %zu bytes, %llu words counted\n",
+           sketch->depth, sketch->width, countMinSketchBytes(sketch), sketch->total);
+    if (exact != NULL)
+    {
+        printf("Words promoted (estimate >= %d): %d\n", options->exactAbove,
+               hashMapSize(exact));
+    }
+    if (truth != NULL)
+    {
+        profileBegin(options->profile, "check");
+        printSketchError(sketch, exact, before, truth, options->epsilon);
+        profileEnd(options->profile);
+        hashMapDelete(truth);
+    }
+    if (exact != NULL)
+    {
+        hashMapDelete(exact);
+        hashMapDelete(before);
+    }
+    countMinSketchDelete(sketch);
+    return 0;
+}
+
+/**
+ * Counts the n-grams of the files and prints them by count. N-grams do not
+ * span files.
+ * @param options
+ * @return 0 on success, 1 if a file could not be opened or read.
+ */
+static int runNgram(Options *options)
+{
+    const char **inputs = options->numInputs > 0 ? options->inputs : &options->fileName;
+    int numInputs = options->numInputs > 0 ? options->numInputs : 1;
+    profileBegin(options->profile, "count");
+    NgramCounter *counter = ngramCounterNew(options->ngram);
+    for (int i = 0; i < numInputs; i++)
+    {
+        FILE *fp = fopen(inputs[i], "r");
+        if (fp == NULL)
+        {
+            fprintf(stderr, "Could not open file: %s\n", inputs[i]);
+            ngramCounterDelete(counter);
+            profileEnd(options->profile);
+            return 1;
+        }
+        Tokenizer *tokenizer = openTokenizer(fp, options->readAhead);
+        char *word;
+        int length;
+        while (tokenizerNext(tokenizer, &word, &length))
+        {
+            ngramCounterAdd(counter, word);
+        }
+        if (closeTokenizer(tokenizer, fp, inputs[i]) != 0)
+        {
+            ngramCounterDelete(counter);
+            profileEnd(options->profile);
+            return 1;
+        }
+        ngramCounterBreak(counter);
+    }
+    profileEnd(options->profile);
+
+    profileBegin(options->profile, "write");
+    Writer writer;
+    fflush(stdout);
+    writerInit(&writer, stdout, WRITER_BUFFER_SIZE);
+    ngramCounterWrite(counter, &writer);
+    writerCleanUp(&writer);
+    profileEnd(options->profile);
+
+    printf("\nRan in %f seconds\n", profileWall(options->profile, "count") +
+                                         profileWall(options->profile, "write"));
+    printf("Number of %d-grams: %lld\n", options->ngram, counter->total);
+    printf("Distinct %d-grams: %d\n", options->ngram, counter->size);
+    printf("Distinct words: %d\n", counter->numWords);
+    printf("Memory: %zu bytes\n", ngramCounterBytes(counter));
+    ngramCounterDelete(counter);
+    return 0;
+}
+
+/**
+ * Resumes the concordance from the checkpoint, counts only the bytes appended
+ * to each file since it was saved and saves it again.
+ * @param options
+ * @return 0 on success, 1 on failure.
+ */
+static int runCheckpoint(Options *options)
+{
+    const char **inputs = options->numInputs > 0 ? options->inputs : &options->fileName;
+    int numInputs = options->numInputs > 0 ? options->numInputs : 1;
+
+    profileBegin(options->profile, "load");
+    Checkpoint *checkpoint = checkpointLoad(options->checkpoint);
+    profileEnd(options->profile);
+    if (checkpoint == NULL)
+    {
+        fprintf(stderr, "Invalid checkpoint: %s\n", options->checkpoint);
+        return 1;
+    }
+    printf("Loaded checkpoint %s: %d words, %d files in %f seconds\n",
+           options->checkpoint, hashMapSize(checkpoint->map), checkpoint->numFiles,
+           profileWall(options->profile, "load"));
+
+    int status = 0;
+    profileBegin(options->profile, "count");
+    for (int i = 0; i < numInputs; i++)
+    {
+        long long words = checkpointCountFile(checkpoint, inputs[i]);
+        if (words < 0)
+        {
+            fprintf(stderr, "Could not resume file (missing, unreadable, truncated or rewritten): %s\n", inputs[i]);
+            status = 1;
+            continue;
+        }
+        printf("Counted %lld new words from %s\n", words, inputs[i]);
+    }
+    profileEnd(options->profile);
+
+    profileBegin(options->profile, "save");
+    if (!checkpointSave(checkpoint, options->checkpoint))
+    {
+        fprintf(stderr, "Could not save checkpoint: %s\n", options->checkpoint);
+        status = 1;
+    }
+    profileEnd(options->profile);
+
+    if (options->sort != SORT_NONE)
+    {
+        printSorted(checkpoint->map, options->sort, options->threads, options->profile);
+    }
+    printf("\nCounted in %f seconds\n", profileWall(options->profile, "count"));
+    printf("Saved checkpoint in %f seconds\n", profileWall(options->profile, "save"));
+    printf("Number of links: %d\n", hashMapSize(checkpoint->map));
+    checkpointDelete(checkpoint);
+    return status;
+}
+
+/**
+ * Counts the words of the file, sequentially or with several threads, and
+ * prints the concordance and the hash map statistics.
+ * @param options
+ * @return 0 on success, 1 if the file could not be opened or read.
+ */
+static int runConcordance(Options *options)
+{
+    printf("Opening file: %s\n", options->fileName);
+
+    // --- Concordance code begins here ---
+    profileBegin(options->profile, "count");
+    ConcordanceStats stats;
+    HashMap *map = options->threads > 0
+                       ? countParallel(options->fileName, options->threads, &stats)
+                       : countSequential(options->fileName, options->readAhead);
+    profileEnd(options->profile);
+    if (map == NULL)
+    {
+        fprintf(stderr, "Could not count file: %s\n", options->fileName);
+        return 1;
+    }
+    profileBegin(options->profile, "print");
+    if (options->sort != SORT_NONE)
+    {
+        printSorted(map, options->sort, options->threads, options->profile);
+    }
+    else
+    {
+        hashMapPrint(map);
+    }
+    profileEnd(options->profile);
     // --- Concordance code ends here ---
 
-    timer = clock() - timer;
-    printf("\nRan in %f seconds\n", (float)timer / (float)CLOCKS_PER_SEC);
+    printf("\nRan in %f seconds\n", profileWall(options->profile, "count") +
+                                         profileWall(options->profile, "print"));
     printf("Empty buckets: %d\n", hashMapEmptyBuckets(map));
     printf("Number of links: %d\n", hashMapSize(map));
     printf("Number of buckets: %d\n", hashMapCapacity(map));
     printf("Table load: %f\n", hashMapTableLoad(map));
+    if (options->threads > 0)
+    {
+        concordancePrintStats(&stats);
+    }
 
     hashMapDelete(map);
     return 0;
-}
\ No newline at end of file
+}
+
+/**
+ * Prints the concordance of the given file and performance information. Uses
+ * the file input1.txt by default or a file name specified as a command line
+ * argument. With -j N the file is counted by N threads. With --stream, any
+ * number of files, patterns or standard input are counted as one stream with
+ * periodic reports of the most frequent words, which --topk tracks in fixed
+ * memory. With --index, a positional
+ * index is built and queried instead, and with --approx the words are counted
+ * approximately in fixed memory. --ngram=N counts sequences of N words, and
+ * --checkpoint resumes counting from the previous run's checkpoint. With
+ * --profile, the time spent in each phase is reported at exit.
+ * @param argc
+ * @param argv
+ * @return
+ */
+int main(int argc, const char **argv)
+{
+    Options options;
+    if (!parseArguments(argc, argv, &options))
+    {
+        printUsage(argv[0]);
+        free(options.inputs);
+        free(options.queries);
+        return 1;
+    }
+    Profile profile;
+    profileInit(&profile, options.profileFormat != REPORT_NONE);
+    options.profile = &profile;
+    profileBegin(&profile, "total");
+
+    int status;
+    if (options.index || options.approx || options.ngram > 0 || options.checkpoint != NULL)
+    {
+        status = options.index    ? runIndex(&options)
+                 : options.approx ? runApprox(&options)
+                 : options.ngram  ? runNgram(&options)
+                                  : runCheckpoint(&options);
+    }
+    else if (options.stream)
+    {
+        // Streams read standard input unless inputs are given.
+        const char *standardInput = "-";
+        status = options.numInputs > 0
+                     ? streamRun(options.inputs, options.numInputs, &options.streamOptions)
+                     : streamRun(&standardInput, 1, &options.streamOptions);
+    }
+    else
+    {
+        status = runConcordance(&options);
+    }
+
+    profileEnd(&profile);
+    fflush(stdout);
+    if (options.profileFormat == REPORT_TABLE)
+    {
+        fprintf(stderr, "\n");
+        profilePrint(&profile, stderr);
+    }
+    else if (options.profileFormat == REPORT_JSON)
+    {
+        profilePrintJson(&profile, stderr);
+    }
+    profileCleanUp(&profile);
+    free(options.inputs);
+    free(options.queries);
+    return status;
+}
@@ -0,0 +1,289 @@
+#include "ngram.h"
+#include "fnv.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#define ROLLING_BASE 0x100000001b3ULL
+
+/**
+ * Creates an empty n-gram counter.
+ * @param n Words per n-gram, from 1 to NGRAM_MAX.
+ * @return The allocated counter.
+ */
+NgramCounter *ngramCounterNew(int n)
+{
+    assert(n >= 1 && n <= NGRAM_MAX);
+    NgramCounter *counter = malloc(sizeof(NgramCounter));
+    counter->n = n;
+    counter->ids = hashMapNew(1024);
+    counter->stringsCapacity = 4096;
+    counter->strings = malloc(counter->stringsCapacity);
+    counter->stringsLength = 0;
+    counter->wordCapacity = 1024;
+    counter->offsets = malloc(sizeof(size_t) * counter->wordCapacity);
+    counter->wordHashes = malloc(sizeof(unsigned long long) * counter->wordCapacity);
+    counter->numWords = 0;
+    counter->capacity = 1024;
+    counter->size = 0;
+    counter->hashes = malloc(sizeof(unsigned long long) * counter->capacity);
+    counter->counts = calloc(counter->capacity, sizeof(int));
+    counter->tuples = malloc(sizeof(int) * counter->capacity * n);
+    counter->filled = 0;
+    counter->rolling = 0;
+    counter->outgoingPower = 1;
+    for (int i = 1; i < n; i++)
+    {
+        counter->outgoingPower *= ROLLING_BASE;
+    }
+    counter->total = 0;
+    return counter;
+}
+
+/**
+ * Frees the counter, its interned words and its table.
+ * @param counter
+ */
+void ngramCounterDelete(NgramCounter *counter)
+{
+    hashMapDelete(counter->ids);
+    free(counter->strings);
+    free(counter->offsets);
+    free(counter->wordHashes);
+    free(counter->hashes);
+    free(counter->counts);
+    free(counter->tuples);
+    free(counter);
+}
+
+/**
+ * Hashes a word with FNV-1a and a final mix, so nearby ids and similar words
+ * still get unrelated hashes.
+ * @param word
+ * @return Hash value.
+ */
+static unsigned long long hashWord(const char *word)
+{
+    unsigned long long h = fnvHashString64(word);
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+/**
+ * Returns the id of the word, interning it on first sight.
+ * @param counter
+ * @param word
+ * @return Word id.
+ */
+static int internWord(NgramCounter *counter, const char *word)
+{
+    int *id = hashMapGet(counter->ids, word);
+    if (id != NULL)
+    {
+        return *id;
+    }
+
+    size_t length = strlen(word) + 1;
+    while (counter->stringsLength + length > counter->stringsCapacity)
+    {
+        counter->stringsCapacity *= 2;
+        counter->strings = realloc(counter->strings, counter->stringsCapacity);
+    }
+    if (counter->numWords == counter->wordCapacity)
+    {
+        counter->wordCapacity *= 2;
+        counter->offsets = realloc(counter->offsets, sizeof(size_t) * counter->wordCapacity);
+        counter->wordHashes = realloc(counter->wordHashes,
+                                      sizeof(unsigned long long) * counter->wordCapacity);
+    }
+    int newId = counter->numWords++;
+    memcpy(counter->strings + counter->stringsLength, word, length);
+    counter->offsets[newId] = counter->stringsLength;
+    counter->stringsLength += length;
+    counter->wordHashes[newId] = hashWord(word);
+    hashMapPut(counter->ids, word, newId);
+    return newId;
+}
+
+/**
+ * Doubles the table, moving each n-gram to its slot by its stored hash.
+ * @param counter
+ */
+static void resizeNgrams(NgramCounter *counter)
+{
+    int n = counter->n;
+    int oldCapacity = counter->capacity;
+    unsigned long long *oldHashes = counter->hashes;
+    int *oldCounts = counter->counts;
+    int *oldTuples = counter->tuples;
+
+    counter->capacity *= 2;
+    counter->hashes = malloc(sizeof(unsigned long long) * counter->capacity);
+    counter->counts = calloc(counter->capacity, sizeof(int));
+    counter->tuples = malloc(sizeof(int) * counter->capacity * n);
+    size_t mask = counter->capacity - 1;
+    for (int i = 0; i < oldCapacity; i++)
+    {
+        if (oldCounts[i] == 0)
+        {
+            continue;
+        }
+        size_t slot = oldHashes[i] & mask;
+        while (counter->counts[slot] != 0)
+        {
+            slot = (slot + 1) & mask;
+        }
+        counter->hashes[slot] = oldHashes[i];
+        counter->counts[slot] = oldCounts[i];
+        memcpy(counter->tuples + slot * n, oldTuples + (size_t)i * n, sizeof(int) * n);
+    }
+    free(oldHashes);
+    free(oldCounts);
+    free(oldTuples);
+}
+
+/**
+ * Counts the n-gram in the window, probing linearly from its hash and
+ * comparing ids only when the full hashes match.
+ * @param counter
+ */
+static void countWindow(NgramCounter *counter)
+{
+    int n = counter->n;
+    // Window order: oldest word first, starting at the slot after the newest.
+    int tuple[NGRAM_MAX];
+    int start = counter->filled % n;
+    for (int i = 0; i < n; i++)
+    {
+        tuple[i] = counter->window[(start + i) % n];
+    }
+
+    size_t mask = counter->capacity - 1;
+    size_t slot = counter->rolling & mask;
+    while (counter->counts[slot] != 0)
+    {
+        if (counter->hashes[slot] == counter->rolling &&
+            memcmp(counter->tuples + slot * n, tuple, sizeof(int) * n) == 0)
+        {
+            counter->counts[slot]++;
+            return;
+        }
+        slot = (slot + 1) & mask;
+    }
+    counter->hashes[slot] = counter->rolling;
+    counter->counts[slot] = 1;
+    memcpy(counter->tuples + slot * n, tuple, sizeof(int) * n);
+    counter->size++;
+    // Keep the load under 3/4 so probe sequences stay short.
+    if (4 * counter->size > 3 * counter->capacity)
+    {
+        resizeNgrams(counter);
+    }
+}
+
+/**
+ * Adds the next word of the input, counting the n-gram it completes. The
+ * rolling hash drops the oldest word's term and shifts in the new word's hash.
+ * @param counter
+ * @param word
+ */
+void ngramCounterAdd(NgramCounter *counter, const char *word)
+{
+    int n = counter->n;
+    int id = internWord(counter, word);
+    int slot = counter->filled % n;
+    if (counter->filled >= n)
+    {
+        counter->rolling -= counter->wordHashes[counter->window[slot]] * counter->outgoingPower;
+    }
+    counter->rolling = counter->rolling * ROLLING_BASE + counter->wordHashes[id];
+    counter->window[slot] = id;
+    counter->filled++;
+    if (counter->filled >= n)
+    {
+        countWindow(counter);
+        counter->total++;
+        // Keep filled bounded while preserving its position modulo n.
+        if (counter->filled >= 2 * n)
+        {
+            counter->filled -= n;
+        }
+    }
+}
+
+/**
+ * Empties the window so no n-gram spans the break, for example between files.
+ * @param counter
+ */
+void ngramCounterBreak(NgramCounter *counter)
+{
+    counter->filled = 0;
+    counter->rolling = 0;
+}
+
+/**
+ * Returns the memory used by the interned words and the n-gram table in bytes,
+ * not counting the word map.
+ * @param counter
+ * @return Memory in bytes.
+ */
+size_t ngramCounterBytes(NgramCounter *counter)
+{
+    return counter->stringsCapacity +
+           (sizeof(size_t) + sizeof(unsigned long long)) * counter->wordCapacity +
+           (sizeof(unsigned long long) + sizeof(int) * (1 + counter->n)) * counter->capacity;
+}
+
+static const int *sortCounts;
+
+static int compareSlots(const void *a, const void *b)
+{
+    int x = *(const int *)a;
+    int y = *(const int *)b;
+    if (sortCounts[x] != sortCounts[y])
+    {
+        return sortCounts[x] < sortCounts[y] ? 1 : -1;
+    }
+    return x - y;
+}
+
+/**
+ * Writes one "word word ...<TAB>count" line per n-gram, most frequent first.
+ * @param counter
+ * @param writer
+ */
+void ngramCounterWrite(NgramCounter *counter, Writer *writer)
+{
+    int *slots = malloc(sizeof(int) * (counter->size + 1));
+    int size = 0;
+    for (int i = 0; i < counter->capacity; i++)
+    {
+        if (counter->counts[i] != 0)
+        {
+            slots[size++] = i;
+        }
+    }
+    sortCounts = counter->counts;
+    qsort(slots, size, sizeof(int), compareSlots);
+
+    for (int i = 0; i < size; i++)
+    {
+        const int *tuple = counter->tuples + (size_t)slots[i] * counter->n;
+        for (int j = 0; j < counter->n; j++)
+        {
+            const char *word = counter->strings + counter->offsets[tuple[j]];
+            if (j > 0)
+            {
+                writerChar(writer, ' ');
+            }
+            writerString(writer, word, strlen(word));
+        }
+        writerChar(writer, '\t');
+        writerInt(writer, counter->counts[slots[i]]);
+        writerChar(writer, '\n');
+    }
+    free(slots);
+}
@@ -0,0 +1,54 @@
+#ifndef NGRAM_H
+#define NGRAM_H
+
+#include "hashMap.h"
+#include "writer.h"
+
+#define NGRAM_MAX 8
+
+typedef struct NgramCounter NgramCounter;
+
+/*
+ * Counts sequences of n consecutive words. Each distinct word is interned once
+ * and given an id and a 64-bit hash; n-grams are stored as tuples of ids in an
+ * open addressing table, keyed by a polynomial rolling hash of the word hashes
+ * that is updated in constant time as the window slides. No string is built
+ * per n-gram.
+ */
+struct NgramCounter
+{
+    int n;
+    // Word to id.
+    HashMap *ids;
+    // Interned words, id i starting at strings + offsets[i].
+    char *strings;
+    size_t stringsLength;
+    size_t stringsCapacity;
+    size_t *offsets;
+    unsigned long long *wordHashes;
+    int numWords;
+    int wordCapacity;
+    // N-gram table. A slot is empty when its count is 0. Slot i's ids are
+    // tuples[i * n] to tuples[i * n + n - 1].
+    unsigned long long *hashes;
+    int *counts;
+    int *tuples;
+    int size;
+    int capacity;
+    // The last n word ids and their rolling hash.
+    int window[NGRAM_MAX];
+    int filled;
+    unsigned long long rolling;
+    // Multiplier of the word leaving the window, BASE^(n - 1).
+    unsigned long long outgoingPower;
+    long long total;
+};
+
+NgramCounter *ngramCounterNew(int n);
+void ngramCounterDelete(NgramCounter *counter);
+void ngramCounterAdd(NgramCounter *counter, const char *word);
+void ngramCounterBreak(NgramCounter *counter);
+size_t ngramCounterBytes(NgramCounter *counter);
+void ngramCounterWrite(NgramCounter *counter, Writer *writer);
+
+#endif
@@ -0,0 +1,307 @@
+#define _GNU_SOURCE
+#include "profile.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+static const char *counterNames[PROFILE_COUNTERS] = {
+    "cycles", "instructions", "cache-misses", "branch-misses"};
+
+/**
+ * Returns the time of the given clock in seconds.
+ * @param clock
+ */
+static double clockSeconds(clockid_t clock)
+{
+    struct timespec now;
+    clock_gettime(clock, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/**
+ * Returns the monotonic wall clock time in seconds.
+ */
+double wallSeconds(void)
+{
+    return clockSeconds(CLOCK_MONOTONIC);
+}
+
+/**
+ * Opens a hardware counter for this process and the threads it creates
+ * afterwards, user space only.
+ * @param config One of the PERF_COUNT_HW_ values.
+ * @return The counter's descriptor, or -1 if it is not available.
+ */
+static int openCounter(unsigned long long config)
+{
+#ifdef __linux__
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.inherit = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+    (void)config;
+    return -1;
+#endif
+}
+
+/**
+ * Reads a counter, scaled up for the time it was not scheduled on the PMU
+ * when more counters are open than the CPU has.
+ * @param fd
+ * @return The count, or 0 if the counter is not available.
+ */
+static long long readCounter(int fd)
+{
+    uint64_t values[3];
+    if (fd < 0 || read(fd, values, sizeof(values)) != sizeof(values))
+    {
+        return 0;
+    }
+    if (values[2] == 0)
+    {
+        return 0;
+    }
+    if (values[2] < values[1])
+    {
+        return (long long)((double)values[0] * values[1] / values[2]);
+    }
+    return (long long)values[0];
+}
+
+/**
+ * Initializes an empty profile.
+ * @param profile
+ * @param counters 1 to open the hardware counters, 0 to time only.
+ */
+void profileInit(Profile *profile, int counters)
+{
+    assert(profile != NULL);
+    profile->numPhases = 0;
+    profile->depth = 0;
+    profile->counters = counters;
+#ifdef __linux__
+    const unsigned long long configs[PROFILE_COUNTERS] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+#else
+    const unsigned long long configs[PROFILE_COUNTERS] = {0, 0, 0, 0};
+#endif
+    for (int i = 0; i < PROFILE_COUNTERS; i++)
+    {
+        profile->counterFds[i] = counters ? openCounter(configs[i]) : -1;
+    }
+}
+
+/**
+ * Closes the hardware counters.
+ * @param profile
+ */
+void profileCleanUp(Profile *profile)
+{
+    assert(profile != NULL);
+    for (int i = 0; i < PROFILE_COUNTERS; i++)
+    {
+        if (profile->counterFds[i] >= 0)
+        {
+            close(profile->counterFds[i]);
+            profile->counterFds[i] = -1;
+        }
+    }
+}
+
+/**
+ * Enters the phase of the given name inside the current phase. Entering a
+ * phase again under the same parent adds to its totals.
+ * @param profile
+ * @param name Must stay valid until the profile is printed.
+ */
+void profileBegin(Profile *profile, const char *name)
+{
+    assert(profile != NULL);
+    assert(name != NULL);
+    assert(profile->depth < PROFILE_MAX_DEPTH);
+    int parent = profile->depth > 0 ? profile->stack[profile->depth - 1] : -1;
+    int index = 0;
+    while (index < profile->numPhases &&
+           (profile->phases[index].parent != parent ||
+            strcmp(profile->phases[index].name, name) != 0))
+    {
+        index++;
+    }
+    if (index == profile->numPhases)
+    {
+        assert(profile->numPhases < PROFILE_MAX_PHASES);
+        ProfilePhase *phase = &profile->phases[profile->numPhases++];
+        memset(phase, 0, sizeof(ProfilePhase));
+        phase->name = name;
+        phase->parent = parent;
+        phase->depth = profile->depth;
+    }
+    profile->stack[profile->depth++] = index;
+
+    ProfilePhase *phase = &profile->phases[index];
+    phase->calls++;
+    for (int i = 0; i < PROFILE_COUNTERS; i++)
+    {
+        phase->startCounters[i] = readCounter(profile->counterFds[i]);
+    }
+    phase->startCpu = clockSeconds(CLOCK_PROCESS_CPUTIME_ID);
+    phase->startWall = wallSeconds();
+}
+
+/**
+ * Leaves the innermost phase, adding the time and counts since it was
+ * entered to its totals.
+ * @param profile
+ */
+void profileEnd(Profile *profile)
+{
+    assert(profile != NULL);
+    assert(profile->depth > 0);
+    double wall = wallSeconds();
+    double cpu = clockSeconds(CLOCK_PROCESS_CPUTIME_ID);
+    ProfilePhase *phase = &profile->phases[profile->stack[--profile->depth]];
+    phase->wall += wall - phase->startWall;
+    phase->cpu += cpu - phase->startCpu;
+    for (int i = 0; i < PROFILE_COUNTERS; i++)
+    {
+        phase->counters[i] += readCounter(profile->counterFds[i]) - phase->startCounters[i];
+    }
+}
+
+/**
+ * Returns the total wall time of the first phase of the given name.
+ * @param profile
+ * @param name
+ * @return Seconds, or 0 if no such phase was entered.
+ */
+double profileWall(Profile *profile, const char *name)
+{
+    assert(profile != NULL);
+    for (int i = 0; i < profile->numPhases; i++)
+    {
+        if (strcmp(profile->phases[i].name, name) == 0)
+        {
+            return profile->phases[i].wall;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Prints the phases in the order they were first entered, nested phases
+ * indented under their parent, as a table.
+ * @param profile
+ * @param file
+ */
+void profilePrint(Profile *profile, FILE *file)
+{
+    assert(profile != NULL);
+    int counters = 0;
+    for (int i = 0; i < PROFILE_COUNTERS; i++)
+    {
+        counters |= profile->counterFds[i] >= 0;
+    }
+
+    fprintf(file, "%-28s %8s %10s %10s", "phase", "calls", "wall (s)", "cpu (s)");
+    if (counters)
+    {
+        for (int i = 0; i < PROFILE_COUNTERS; i++)
+        {
+            fprintf(file, " %14s", counterNames[i]);
+        }
+        fprintf(file, " %6s", "IPC");
+    }
+    fprintf(file, "\n");
+
+    for (int i = 0; i < profile->numPhases; i++)
+    {
+        ProfilePhase *phase = &profile->phases[i];
+        fprintf(file, "%*s%-*s %8d %10.4f %10.4f", 2 * phase->depth, "",
+                28 - 2 * phase->depth, phase->name, phase->calls, phase->wall,
+                phase->cpu);
+        if (counters)
+        {
+            for (int j = 0; j < PROFILE_COUNTERS; j++)
+            {
+                if (profile->counterFds[j] >= 0)
+                {
+                    fprintf(file, " %14lld", phase->counters[j]);
+                }
+                else
+                {
+                    fprintf(file, " %14s", "-");
+                }
+            }
+            if (phase->counters[0] > 0)
+            {
+                fprintf(file, " %6.2f", (double)phase->counters[1] / phase->counters[0]);
+            }
+            else
+            {
+                fprintf(file, " %6s", "-");
+            }
+        }
+        fprintf(file, "\n");
+    }
+    if (profile->counters && !counters)
+    {
+        fprintf(file, "Hardware counters are not available (perf_event_open failed)\n");
+    }
+}
+
+/**
+ * Prints the phases as a JSON array of objects. Each phase names its parent,
+ * and counters that are not available are null.
+ * @param profile
+ * @param file
+ */
+void profilePrintJson(Profile *profile, FILE *file)
+{
+    assert(profile != NULL);
+    fprintf(file, "[");
+    for (int i = 0; i < profile->numPhases; i++)
+    {
+        ProfilePhase *phase = &profile->phases[i];
+        fprintf(file, "%s\n  {\"phase\": \"%s\", ", i > 0 ? "," : "", phase->name);
+        if (phase->parent >= 0)
+        {
+            fprintf(file, "\"parent\": \"%s\", ", profile->phases[phase->parent].name);
+        }
+        else
+        {
+            fprintf(file, "\"parent\": null, ");
+        }
+        fprintf(file, "\"calls\": %d, \"wall\": %.6f, \"cpu\": %.6f", phase->calls,
+                phase->wall, phase->cpu);
+        for (int j = 0; j < PROFILE_COUNTERS; j++)
+        {
+            if (profile->counterFds[j] >= 0)
+            {
+                fprintf(file, ", \"%s\": %lld", counterNames[j], phase->counters[j]);
+            }
+            else
+            {
+                fprintf(file, ", \"%s\": null", counterNames[j]);
+            }
+        }
+        fprintf(file, "}");
+    }
+    fprintf(file, "\n]\n");
+}
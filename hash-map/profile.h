@@ -0,0 +1,60 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdio.h>
+
+#define PROFILE_MAX_PHASES 64
+#define PROFILE_MAX_DEPTH 16
+#define PROFILE_COUNTERS 4
+
+typedef struct Profile Profile;
+typedef struct ProfilePhase ProfilePhase;
+
+/*
+ * Totals of one named phase, accumulated over every time it was entered
+ * under the same parent phase.
+ */
+struct ProfilePhase
+{
+    const char *name;
+    // Index of the enclosing phase, or -1 for a top-level phase.
+    int parent;
+    int depth;
+    int calls;
+    double wall;
+    double cpu;
+    long long counters[PROFILE_COUNTERS];
+    // Readings taken when the phase was last entered.
+    double startWall;
+    double startCpu;
+    long long startCounters[PROFILE_COUNTERS];
+};
+
+/*
+ * Nestable phase timers measuring wall clock and process CPU time, plus
+ * cycles, instructions, cache misses and branch misses when hardware
+ * counters are available through perf_event_open.
+ */
+struct Profile
+{
+    ProfilePhase phases[PROFILE_MAX_PHASES];
+    int numPhases;
+    // Indices of the phases currently entered, innermost last.
+    int stack[PROFILE_MAX_DEPTH];
+    int depth;
+    // 1 if hardware counters were asked for.
+    int counters;
+    // perf_event_open descriptors, -1 for counters that are not available.
+    int counterFds[PROFILE_COUNTERS];
+};
+
+double wallSeconds(void);
+void profileInit(Profile *profile, int counters);
+void profileCleanUp(Profile *profile);
+void profileBegin(Profile *profile, const char *name);
+void profileEnd(Profile *profile);
+double profileWall(Profile *profile, const char *name);
+void profilePrint(Profile *profile, FILE *file);
+void profilePrintJson(Profile *profile, FILE *file);
+
+#endif
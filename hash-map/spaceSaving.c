@@ -0,0 +1,180 @@
+#include "spaceSaving.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+/**
+ * Creates an empty summary with the given number of counters.
+ * @param capacity Number of counters, the only memory the summary grows to.
+ * @return The allocated summary.
+ */
+SpaceSaving *spaceSavingNew(int capacity)
+{
+    assert(capacity > 0);
+    SpaceSaving *summary = malloc(sizeof(SpaceSaving));
+    summary->counters = malloc(sizeof(SpaceSavingCounter) * capacity);
+    summary->heap = malloc(sizeof(int) * capacity);
+    summary->heapIndex = malloc(sizeof(int) * capacity);
+    summary->words = hashMapNew(capacity / MAX_TABLE_LOAD + 1);
+    summary->size = 0;
+    summary->capacity = capacity;
+    summary->total = 0;
+    return summary;
+}
+
+/**
+ * Frees the summary and the monitored words.
+ * @param summary
+ */
+void spaceSavingDelete(SpaceSaving *summary)
+{
+    for (int i = 0; i < summary->size; i++)
+    {
+        free(summary->counters[i].word);
+    }
+    free(summary->counters);
+    free(summary->heap);
+    free(summary->heapIndex);
+    hashMapDelete(summary->words);
+    free(summary);
+}
+
+/**
+ * Moves the counter at the given heap position up while its parent has a
+ * larger count.
+ * @param summary
+ * @param at
+ */
+static void siftUp(SpaceSaving *summary, int at)
+{
+    int *heap = summary->heap;
+    int counter = heap[at];
+    long long count = summary->counters[counter].count;
+    while (at > 0)
+    {
+        int parent = (at - 1) / 2;
+        if (summary->counters[heap[parent]].count <= count)
+        {
+            break;
+        }
+        heap[at] = heap[parent];
+        summary->heapIndex[heap[at]] = at;
+        at = parent;
+    }
+    heap[at] = counter;
+    summary->heapIndex[counter] = at;
+}
+
+/**
+ * Moves the counter at the given heap position down until both children have
+ * larger or equal counts.
+ * @param summary
+ * @param at
+ */
+static void siftDown(SpaceSaving *summary, int at)
+{
+    int *heap = summary->heap;
+    int counter = heap[at];
+    long long count = summary->counters[counter].count;
+    while (1)
+    {
+        int child = 2 * at + 1;
+        if (child >= summary->size)
+        {
+            break;
+        }
+        if (child + 1 < summary->size &&
+            summary->counters[heap[child + 1]].count < summary->counters[heap[child]].count)
+        {
+            child++;
+        }
+        if (summary->counters[heap[child]].count >= count)
+        {
+            break;
+        }
+        heap[at] = heap[child];
+        summary->heapIndex[heap[at]] = at;
+        at = child;
+    }
+    heap[at] = counter;
+    summary->heapIndex[counter] = at;
+}
+
+/**
+ * Counts one occurrence of a word in O(log capacity) time. Counts only grow,
+ * so a monitored counter only ever moves down the heap.
+ * @param summary
+ * @param word
+ */
+void spaceSavingAdd(SpaceSaving *summary, const char *word)
+{
+    summary->total++;
+    int *index = hashMapGet(summary->words, word);
+    if (index != NULL)
+    {
+        summary->counters[*index].count++;
+        siftDown(summary, summary->heapIndex[*index]);
+        return;
+    }
+
+    int counter;
+    if (summary->size < summary->capacity)
+    {
+        // New counter, appended as a heap leaf.
+        counter = summary->size++;
+        summary->heap[counter] = counter;
+        summary->heapIndex[counter] = counter;
+        summary->counters[counter].count = 1;
+        summary->counters[counter].error = 0;
+        summary->counters[counter].word = malloc(strlen(word) + 1);
+        strcpy(summary->counters[counter].word, word);
+        hashMapPut(summary->words, word, counter);
+        siftUp(summary, counter);
+        return;
+    }
+    else
+    {
+        // Take over the counter with the smallest count.
+        counter = summary->heap[0];
+        SpaceSavingCounter *evicted = &summary->counters[counter];
+        hashMapRemove(summary->words, evicted->word);
+        free(evicted->word);
+        evicted->error = evicted->count;
+        evicted->count++;
+    }
+    summary->counters[counter].word = malloc(strlen(word) + 1);
+    strcpy(summary->counters[counter].word, word);
+    hashMapPut(summary->words, word, counter);
+    siftDown(summary, summary->heapIndex[counter]);
+}
+
+static int compareCounters(const void *a, const void *b)
+{
+    const SpaceSavingCounter *x = a;
+    const SpaceSavingCounter *y = b;
+    if (x->count != y->count)
+    {
+        return x->count < y->count ? 1 : -1;
+    }
+    return strcmp(x->word, y->word);
+}
+
+/**
+ * Copies the k monitored words with the largest counts, largest first. The
+ * words point into the summary and stay valid until its next update.
+ * @param summary
+ * @param top Array with room for k counters.
+ * @param k
+ * @return Number of counters copied, at most k.
+ */
+int spaceSavingTop(SpaceSaving *summary, SpaceSavingCounter *top, int k)
+{
+    SpaceSavingCounter *sorted = malloc(sizeof(SpaceSavingCounter) * (summary->size + 1));
+    memcpy(sorted, summary->counters, sizeof(SpaceSavingCounter) * summary->size);
+    qsort(sorted, summary->size, sizeof(SpaceSavingCounter), compareCounters);
+    int n = k < summary->size ? k : summary->size;
+    memcpy(top, sorted, sizeof(SpaceSavingCounter) * n);
+    free(sorted);
+    return n;
+}
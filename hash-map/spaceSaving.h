@@ -0,0 +1,45 @@
+#ifndef SPACE_SAVING_H
+#define SPACE_SAVING_H
+
+#include "hashMap.h"
+
+typedef struct SpaceSavingCounter SpaceSavingCounter;
+typedef struct SpaceSaving SpaceSaving;
+
+/*
+ * A monitored word. Its true count is between count - error and count.
+ */
+struct SpaceSavingCounter
+{
+    char *word;
+    long long count;
+    long long error;
+};
+
+/*
+ * Space-Saving summary of the most frequent words of a stream in a fixed
+ * number of counters. When a new word arrives and all counters are taken, it
+ * replaces the word with the smallest count and inherits that count as its
+ * error. Every word occurring more than total / capacity times is guaranteed
+ * to be monitored.
+ */
+struct SpaceSaving
+{
+    SpaceSavingCounter *counters;
+    // Min-heap of counter indices ordered by count.
+    int *heap;
+    // Position of each counter in the heap.
+    int *heapIndex;
+    // Maps each monitored word to its counter index.
+    HashMap *words;
+    int size;
+    int capacity;
+    long long total;
+};
+
+SpaceSaving *spaceSavingNew(int capacity);
+void spaceSavingDelete(SpaceSaving *summary);
+void spaceSavingAdd(SpaceSaving *summary, const char *word);
+int spaceSavingTop(SpaceSaving *summary, SpaceSavingCounter *top, int k);
+
+#endif
@@ -0,0 +1,218 @@
+#include "spellBatch.h"
+#include "hashMap.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+typedef struct Misspelling Misspelling;
+typedef struct SpellBatch SpellBatch;
+
+/*
+ * A distinct misspelled word, where it first appears and how often.
+ */
+struct Misspelling
+{
+    char *word;
+    long long occurrences;
+    long long line;
+    long long column;
+};
+
+/*
+ * Words copied out of the tokenizer, whose buffer they would not outlive, to
+ * be looked up together.
+ */
+struct SpellBatch
+{
+    // Words one after the other, each terminated, and where each starts.
+    char *letters;
+    size_t length;
+    size_t capacity;
+    size_t offsets[SPELL_BATCH_WORDS];
+    long long lines[SPELL_BATCH_WORDS];
+    long long columns[SPELL_BATCH_WORDS];
+    const char *words[SPELL_BATCH_WORDS];
+    int found[SPELL_BATCH_WORDS];
+    int numWords;
+    // Distinct misspellings in order of appearance, and their numbers by word.
+    Misspelling *misspellings;
+    int numMisspellings;
+    int misspellingsCapacity;
+    HashMap *seen;
+};
+
+/**
+ * Looks up the words of the batch, and records those not in the dictionary.
+ * @param batch
+ * @param dictionary
+ * @param stats
+ */
+static void checkBatch(SpellBatch *batch, Dictionary *dictionary, SpellBatchStats *stats)
+{
+    for (int i = 0; i < batch->numWords; i++)
+    {
+        batch->words[i] = batch->letters + batch->offsets[i];
+    }
+    dictionaryFindBatch(dictionary, batch->words, batch->numWords, batch->found);
+    for (int i = 0; i < batch->numWords; i++)
+    {
+        if (batch->found[i] >= 0)
+        {
+            continue;
+        }
+        stats->misspelled++;
+        int *number = hashMapGet(batch->seen, batch->words[i]);
+        if (number != NULL)
+        {
+            batch->misspellings[*number].occurrences++;
+            continue;
+        }
+        if (batch->numMisspellings == batch->misspellingsCapacity)
+        {
+            batch->misspellingsCapacity *= 2;
+            batch->misspellings = realloc(batch->misspellings,
+                                          sizeof(Misspelling) * batch->misspellingsCapacity);
+        }
+        Misspelling *misspelling = &batch->misspellings[batch->numMisspellings];
+        size_t length = strlen(batch->words[i]);
+        misspelling->word = malloc(length + 1);
+        memcpy(misspelling->word, batch->words[i], length + 1);
+        misspelling->occurrences = 1;
+        misspelling->line = batch->lines[i];
+        misspelling->column = batch->columns[i];
+        hashMapPut(batch->seen, misspelling->word, batch->numMisspellings++);
+    }
+    stats->words += batch->numWords;
+    batch->numWords = 0;
+    batch->length = 0;
+}
+
+/**
+ * Checks every word of the input against the dictionary, then writes one line
+ * per distinct misspelled word, in order of first appearance: the word, its
+ * occurrences, the line and column (from 1) where it first appears, and its
+ * suggestions separated by commas, all separated by tabs. Words are looked up
+ * SPELL_BATCH_WORDS at a time, and suggestions are only searched once per
+ * distinct word, and not at all for words so much longer than every
+ * dictionary word that any suggestion would be more than maxDistance edits
+ * away; those have an empty list. Apostrophes around a word are left out, and
+ * words holding digits are skipped.
+ * @param dictionary
+ * @param tokenizer Tokenizer of the input, which must not have started yet.
+ * @param suggest Suggestion engine.
+ * @param engine Passed to suggest.
+ * @param count Number of suggestions per word, at most
+ *              SPELL_BATCH_MAX_SUGGESTIONS.
+ * @param maxDistance Largest distance of any suggestion, for a word longer
+ *                    than the dictionary words.
+ * @param writer
+ * @param stats Filled with the counts.
+ */
+void spellBatchCheck(Dictionary *dictionary, Tokenizer *tokenizer, SpellBatchSuggest suggest,
+                     void *engine, int count, int maxDistance, Writer *writer,
+                     SpellBatchStats *stats)
+{
+    assert(dictionary != NULL);
+    assert(tokenizer != NULL);
+    assert(suggest != NULL);
+    assert(count >= 0 && count <= SPELL_BATCH_MAX_SUGGESTIONS);
+    assert(maxDistance >= 0);
+    memset(stats, 0, sizeof(SpellBatchStats));
+    SpellBatch *batch = malloc(sizeof(SpellBatch));
+    batch->capacity = 16 * SPELL_BATCH_WORDS;
+    batch->letters = malloc(batch->capacity);
+    batch->length = 0;
+    batch->numWords = 0;
+    batch->misspellingsCapacity = 64;
+    batch->misspellings = malloc(sizeof(Misspelling) * batch->misspellingsCapacity);
+    batch->numMisspellings = 0;
+    batch->seen = hashMapNew(1024);
+
+    tokenizerTrackLines(tokenizer);
+    char *word;
+    int length;
+    while (tokenizerNext(tokenizer, &word, &length))
+    {
+        int start = 0;
+        while (start < length && word[start] == '\'')
+        {
+            start++;
+        }
+        while (length > start && word[length - 1] == '\'')
+        {
+            length--;
+        }
+        if (start == length)
+        {
+            continue;
+        }
+        int digits = 0;
+        for (int i = start; i < length && !digits; i++)
+        {
+            digits = word[i] >= '0' && word[i] <= '9';
+        }
+        if (digits)
+        {
+            stats->skipped++;
+            continue;
+        }
+        if (batch->length + (length - start) + 1 > batch->capacity)
+        {
+            batch->capacity = 2 * (batch->length + (length - start) + 1);
+            batch->letters = realloc(batch->letters, batch->capacity);
+        }
+        batch->offsets[batch->numWords] = batch->length;
+        batch->lines[batch->numWords] = tokenizer->wordLine;
+        batch->columns[batch->numWords] = tokenizer->wordColumn + start + 1;
+        batch->numWords++;
+        memcpy(batch->letters + batch->length, word + start, length - start);
+        batch->length += length - start;
+        batch->letters[batch->length++] = '\0';
+        if (batch->numWords == SPELL_BATCH_WORDS)
+        {
+            checkBatch(batch, dictionary, stats);
+        }
+    }
+    checkBatch(batch, dictionary, stats);
+
+    Suggestion best[SPELL_BATCH_MAX_SUGGESTIONS];
+    for (int i = 0; i < batch->numMisspellings; i++)
+    {
+        Misspelling *misspelling = &batch->misspellings[i];
+        size_t length = strlen(misspelling->word);
+        int found = 0;
+        if (length > (size_t)dictionary->maxLength + maxDistance)
+        {
+            stats->tooLong++;
+        }
+        else
+        {
+            found = suggest(engine, misspelling->word, best, count);
+        }
+        writerString(writer, misspelling->word, length);
+        writerChar(writer, '\t');
+        writerInt(writer, misspelling->occurrences);
+        writerChar(writer, '\t');
+        writerInt(writer, misspelling->line);
+        writerChar(writer, ':');
+        writerInt(writer, misspelling->column);
+        writerChar(writer, '\t');
+        for (int j = 0; j < found; j++)
+        {
+            const char *suggestion = dictionary->words[best[j].word];
+            if (j > 0)
+            {
+                writerChar(writer, ',');
+            }
+            writerString(writer, suggestion, strlen(suggestion));
+        }
+        writerChar(writer, '\n');
+        free(misspelling->word);
+    }
+    stats->distinct = batch->numMisspellings;
+
+    hashMapDelete(batch->seen);
+    free(batch->misspellings);
+    free(batch->letters);
+    free(batch);
+}
@@ -0,0 +1,39 @@
+#ifndef SPELL_BATCH_H
+#define SPELL_BATCH_H
+
+#include "dictionary.h"
+#include "tokenizer.h"
+#include "writer.h"
+#include "suggest.h"
+
+#define SPELL_BATCH_WORDS 4096
+#define SPELL_BATCH_MAX_SUGGESTIONS 16
+
+typedef struct SpellBatchStats SpellBatchStats;
+
+/*
+ * Finds the closest dictionary words to a misspelled word, as one of the
+ * suggestion engines does.
+ */
+typedef int (*SpellBatchSuggest)(void *engine, const char *word, Suggestion *best, int count);
+
+/*
+ * Counts of a batch check.
+ */
+struct SpellBatchStats
+{
+    // Words checked, those not in the dictionary, and the distinct ones.
+    long long words;
+    long long misspelled;
+    int distinct;
+    // Tokens skipped for holding digits.
+    long long skipped;
+    // Distinct misspelled words too long for suggestions.
+    int tooLong;
+};
+
+void spellBatchCheck(Dictionary *dictionary, Tokenizer *tokenizer, SpellBatchSuggest suggest,
+                     void *engine, int count, int maxDistance, Writer *writer,
+                     SpellBatchStats *stats);
+
+#endif
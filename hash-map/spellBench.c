@@ -0,0 +1,583 @@
+#define _POSIX_C_SOURCE 200809L
+#include "dictionary.h"
+#include "levenshtein.h"
+#include "suggest.h"
+#include "suggestPool.h"
+#include "bkTree.h"
+#include "deletionIndex.h"
+#include "wordBatch.h"
+#include "wordBuckets.h"
+#include "dawg.h"
+#include "profile.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#define SPELL_BENCH_MAX_LENGTH 64
+#define SPELL_BENCH_SUGGESTIONS 5
+
+typedef struct SpellBenchResult SpellBenchResult;
+
+/*
+ * Measurements of one suggestion engine over all the queries.
+ */
+struct SpellBenchResult
+{
+    double buildSeconds;
+    double querySeconds;
+    // Size of the index.
+    size_t bytes;
+    // Edit distances computed and words found within the distance.
+    long long distances;
+    long long found;
+};
+
+/**
+ * Returns the next 64 random bits (SplitMix64).
+ * @param state
+ */
+static uint64_t nextRandom(uint64_t *state)
+{
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+/**
+ * Returns a random integer in [0, n).
+ * @param state
+ * @param n
+ */
+static int randomBelow(uint64_t *state, int n)
+{
+    return (int)(((nextRandom(state) >> 32) * (uint64_t)n) >> 32);
+}
+
+/**
+ * Misspells a random dictionary word with one or two random insertions,
+ * deletions, substitutions or transpositions of lower case letters.
+ * @param dictionary
+ * @param state
+ * @param query Filled with the misspelled word.
+ */
+static void misspell(Dictionary *dictionary, uint64_t *state, char *query)
+{
+    int length;
+    do
+    {
+        int word = randomBelow(state, dictionary->numWords);
+        length = dictionary->lengths[word];
+        memcpy(query, dictionary->words[word], length + 1);
+    } while (length + 2 >= SPELL_BENCH_MAX_LENGTH);
+
+    int edits = 1 + randomBelow(state, 2);
+    for (int i = 0; i < edits; i++)
+    {
+        int at = randomBelow(state, length + 1);
+        char letter = (char)('a' + randomBelow(state, 26));
+        switch (randomBelow(state, 4))
+        {
+        case 0:
+            memmove(query + at + 1, query + at, length - at + 1);
+            query[at] = letter;
+            length++;
+            break;
+        case 1:
+            if (at < length && length > 1)
+            {
+                memmove(query + at, query + at + 1, length - at);
+                length--;
+            }
+            break;
+        case 2:
+            if (at < length)
+            {
+                query[at] = letter;
+            }
+            break;
+        default:
+            if (at + 1 < length)
+            {
+                char c = query[at];
+                query[at] = query[at + 1];
+                query[at + 1] = c;
+            }
+            break;
+        }
+    }
+}
+
+/**
+ * Finds the words within the distance of each query by computing the distance
+ * to every dictionary word.
+ * @param dictionary
+ * @param queries
+ * @param numQueries
+ * @param maxDistance
+ * @param result Filled with the measurements.
+ */
+static void benchScan(Dictionary *dictionary, char (*queries)[SPELL_BENCH_MAX_LENGTH],
+                      int numQueries, int maxDistance, SpellBenchResult *result)
+{
+    memset(result, 0, sizeof(SpellBenchResult));
+    double start = wallSeconds();
+    for (int q = 0; q < numQueries; q++)
+    {
+        for (int i = 0; i < dictionary->numWords; i++)
+        {
+            result->found += levenshteinDistance(queries[q], dictionary->words[i]) <= maxDistance;
+        }
+        result->distances += dictionary->numWords;
+    }
+    result->querySeconds = wallSeconds() - start;
+}
+
+/**
+ * Finds the words within the distance of each query by computing the distance
+ * to the words of the lengths within the distance of the query's.
+ * @param dictionary
+ * @param queries
+ * @param numQueries
+ * @param maxDistance
+ * @param result Filled with the measurements.
+ */
+static void benchBuckets(Dictionary *dictionary, char (*queries)[SPELL_BENCH_MAX_LENGTH],
+                         int numQueries, int maxDistance, SpellBenchResult *result)
+{
+    memset(result, 0, sizeof(SpellBenchResult));
+    double start = wallSeconds();
+    WordBuckets *buckets =
+        wordBucketsNew((const char *const *)dictionary->words, dictionary->numWords);
+    result->buildSeconds = wallSeconds() - start;
+    start = wallSeconds();
+    for (int q = 0; q < numQueries; q++)
+    {
+        Suggestion *matches;
+        result->found += wordBucketsWithin(buckets, queries[q], maxDistance, &matches,
+                                           &result->distances);
+        free(matches);
+    }
+    result->querySeconds = wallSeconds() - start;
+    result->bytes = wordBucketsBytes(buckets);
+    wordBucketsDelete(buckets);
+}
+
+/**
+ * Finds the words within the distance of each query in a BK-tree.
+ * @param dictionary
+ * @param queries
+ * @param numQueries
+ * @param maxDistance
+ * @param result Filled with the measurements.
+ */
+static void benchBkTree(Dictionary *dictionary, char (*queries)[SPELL_BENCH_MAX_LENGTH],
+                        int numQueries, int maxDistance, SpellBenchResult *result)
+{
+    memset(result, 0, sizeof(SpellBenchResult));
+    double start = wallSeconds();
+    BkTree *tree = bkTreeNew((const char *const *)dictionary->words, dictionary->numWords);
+    result->buildSeconds = wallSeconds() - start;
+    start = wallSeconds();
+    for (int q = 0; q < numQueries; q++)
+    {
+        Suggestion *matches;
+        result->found += bkTreeSearch(tree, queries[q], maxDistance, &matches, &result->distances);
+        free(matches);
+    }
+    result->querySeconds = wallSeconds() - start;
+    result->bytes = sizeof(int) * 3 * (size_t)dictionary->numWords;
+    bkTreeDelete(tree);
+}
+
+/**
+ * Finds the words within the distance of each query by walking a DAWG. The
+ * distances counted are the rows of the edit distance table computed.
+ * @param dictionary
+ * @param queries
+ * @param numQueries
+ * @param maxDistance
+ * @param result Filled with the measurements.
+ */
+static void benchDawg(Dictionary *dictionary, char (*queries)[SPELL_BENCH_MAX_LENGTH],
+                      int numQueries, int maxDistance, SpellBenchResult *result)
+{
+    memset(result, 0, sizeof(SpellBenchResult));
+    double start = wallSeconds();
+    Dawg *dawg = dawgNew((const char *const *)dictionary->words, dictionary->numWords);
+    result->buildSeconds = wallSeconds() - start;
+    start = wallSeconds();
+    for (int q = 0; q < numQueries; q++)
+    {
+        Suggestion *matches;
+        result->found += dawgWithin(dawg, queries[q], maxDistance, &matches, &result->distances);
+        free(matches);
+    }
+    result->querySeconds = wallSeconds() - start;
+    result->bytes = dawgBytes(dawg);
+    dawgDelete(dawg);
+}
+
+/**
+ * Finds the words within the distance of each query in a deletion index.
+ * @param dictionary
+ * @param queries
+ * @param numQueries
+ * @param maxDistance
+ * @param prefixLength Number of leading characters indexed.
+ * @param result Filled with the measurements.
+ */
+static void benchDeletes(Dictionary *dictionary, char (*queries)[SPELL_BENCH_MAX_LENGTH],
+                         int numQueries, int maxDistance, int prefixLength,
+                         SpellBenchResult *result)
+{
+    memset(result, 0, sizeof(SpellBenchResult));
+    double start = wallSeconds();
+    DeletionIndex *index = deletionIndexNew((const char *const *)dictionary->words,
+                                            dictionary->numWords, maxDistance, prefixLength);
+    result->buildSeconds = wallSeconds() - start;
+    start = wallSeconds();
+    for (int q = 0; q < numQueries; q++)
+    {
+        Suggestion *matches;
+        result->found += deletionIndexSearch(index, queries[q], maxDistance, &matches,
+                                             &result->distances);
+        free(matches);
+    }
+    result->querySeconds = wallSeconds() - start;
+    result->bytes = deletionIndexBytes(index);
+    deletionIndexDelete(index);
+}
+
+/**
+ * Times the edit distance kernels on every pair of a query and a dictionary
+ * word, and checks that the bit-parallel kernel and the word batch agree with
+ * the dynamic programming one on all of them, and their bounded versions up
+ * to maxDistance.
+ * @param dictionary
+ * @param queries
+ * @param numQueries
+ * @param maxDistance
+ * @return Number of pairs on which the kernels disagree.
+ */
+static long long benchKernels(Dictionary *dictionary, char (*queries)[SPELL_BENCH_MAX_LENGTH],
+                              int numQueries, int maxDistance)
+{
+    long long pairs = (long long)numQueries * dictionary->numWords;
+    int *expected = malloc(sizeof(int) * dictionary->numWords);
+    int *distances = malloc(sizeof(int) * dictionary->numWords);
+    WordBatch *batch = wordBatchNew((const char *const *)dictionary->words, dictionary->numWords);
+    double dpSeconds = 0;
+    double bitSeconds = 0;
+    double boundedSeconds = 0;
+    double batchSeconds = 0;
+    double batchBoundedSeconds = 0;
+    long long mismatches = 0;
+    long long checksum = 0;
+    for (int q = 0; q < numQueries; q++)
+    {
+        double start = wallSeconds();
+        for (int i = 0; i < dictionary->numWords; i++)
+        {
+            expected[i] = levenshteinDistanceDp(queries[q], dictionary->words[i]);
+        }
+        dpSeconds += wallSeconds() - start;
+        start = wallSeconds();
+        for (int i = 0; i < dictionary->numWords; i++)
+        {
+            int distance = levenshteinDistance(queries[q], dictionary->words[i]);
+            mismatches += distance != expected[i];
+            checksum += distance;
+        }
+        bitSeconds += wallSeconds() - start;
+        start = wallSeconds();
+        for (int i = 0; i < dictionary->numWords; i++)
+        {
+            int distance = levenshteinBounded(queries[q], dictionary->words[i], maxDistance);
+            int capped = expected[i] <= maxDistance ? expected[i] : maxDistance + 1;
+            mismatches += distance != capped;
+        }
+        boundedSeconds += wallSeconds() - start;
+        start = wallSeconds();
+        wordBatchDistances(batch, queries[q], SPELL_BENCH_MAX_LENGTH, distances);
+        batchSeconds += wallSeconds() - start;
+        for (int i = 0; i < dictionary->numWords; i++)
+        {
+            mismatches += distances[i] != expected[i];
+        }
+        start = wallSeconds();
+        wordBatchDistances(batch, queries[q], maxDistance, distances);
+        batchBoundedSeconds += wallSeconds() - start;
+        for (int i = 0; i < dictionary->numWords; i++)
+        {
+            int capped = expected[i] <= maxDistance ? expected[i] : maxDistance + 1;
+            mismatches += distances[i] != capped;
+        }
+    }
+    wordBatchDelete(batch);
+    free(distances);
+    free(expected);
+    printf("%-14s %10s %14s\n", "Kernel", "ns/pair", "Pairs");
+    printf("%-14s %10.1f %14lld\n", "dynamic", dpSeconds / pairs * 1e9, pairs);
+    printf("%-14s %10.1f %14lld\n", "bit-parallel", bitSeconds / pairs * 1e9, pairs);
+    printf("bounded (k=%d) %10.1f %14lld\n", maxDistance, boundedSeconds / pairs * 1e9, pairs);
+    printf("%-14s %10.1f %14lld\n", "batch", batchSeconds / pairs * 1e9, pairs);
+    printf("batch (k=%d)   %10.1f %14lld\n", maxDistance, batchBoundedSeconds / pairs * 1e9,
+           pairs);
+    printf("Sum of distances %lld, %lld mismatches\n\n", checksum, mismatches);
+    return mismatches;
+}
+
+/**
+ * Times finding the closest words to each query by comparing with every word,
+ * on one thread and with pools of 2, 4 and so on up to the given number of
+ * threads, then the same with the words in a batch, and checks that they all
+ * give the same suggestions.
+ * @param dictionary
+ * @param queries
+ * @param numQueries
+ * @param threads
+ * @return Number of queries for which a pool gave other suggestions.
+ */
+static int benchTopWords(Dictionary *dictionary, char (*queries)[SPELL_BENCH_MAX_LENGTH],
+                         int numQueries, int threads)
+{
+    const char *const *words = (const char *const *)dictionary->words;
+    Suggestion(*expected)[SPELL_BENCH_SUGGESTIONS] =
+        malloc(sizeof(Suggestion) * SPELL_BENCH_SUGGESTIONS * numQueries);
+    printf("%-14s %10s\n", "Top 5, threads", "us/query");
+    double start = wallSeconds();
+    for (int q = 0; q < numQueries; q++)
+    {
+        suggestScan(words, dictionary->numWords, queries[q], expected[q], SPELL_BENCH_SUGGESTIONS);
+    }
+    printf("%-14s %10.1f\n", "1 (no pool)", (wallSeconds() - start) / numQueries * 1e6);
+
+    Suggestion best[SPELL_BENCH_SUGGESTIONS];
+    int mismatches = 0;
+    WordBuckets *buckets = wordBucketsNew(words, dictionary->numWords);
+    start = wallSeconds();
+    for (int q = 0; q < numQueries; q++)
+    {
+        int found = wordBucketsSuggest(buckets, queries[q], best, SPELL_BENCH_SUGGESTIONS);
+        mismatches += found != SPELL_BENCH_SUGGESTIONS ||
+                      memcmp(best, expected[q], sizeof(best)) != 0;
+    }
+    printf("%-14s %10.1f\n", "1 (buckets)", (wallSeconds() - start) / numQueries * 1e6);
+    wordBucketsDelete(buckets);
+    Dawg *dawg = dawgNew(words, dictionary->numWords);
+    start = wallSeconds();
+    for (int q = 0; q < numQueries; q++)
+    {
+        int found = dawgSuggest(dawg, queries[q], best, SPELL_BENCH_SUGGESTIONS);
+        mismatches += found != SPELL_BENCH_SUGGESTIONS ||
+                      memcmp(best, expected[q], sizeof(best)) != 0;
+    }
+    printf("%-14s %10.1f\n", "1 (dawg)", (wallSeconds() - start) / numQueries * 1e6);
+    dawgDelete(dawg);
+
+    WordBatch *batch = wordBatchNew(words, dictionary->numWords);
+    start = wallSeconds();
+    for (int q = 0; q < numQueries; q++)
+    {
+        int found = wordBatchSuggest(batch, queries[q], best, SPELL_BENCH_SUGGESTIONS);
+        mismatches += found != SPELL_BENCH_SUGGESTIONS ||
+                      memcmp(best, expected[q], sizeof(best)) != 0;
+    }
+    printf("%-14s %10.1f\n", "1 (batch)", (wallSeconds() - start) / numQueries * 1e6);
+
+    // Pools over the words, then over the batch.
+    for (int batched = 0; batched < 2; batched++)
+    {
+        for (int size = 1;; size *= 2)
+        {
+            size = size < threads ? size : threads;
+            SuggestPool *pool = batched ? suggestPoolNewBatch(batch, size)
+                                        : suggestPoolNew(words, dictionary->numWords, size);
+            start = wallSeconds();
+            for (int q = 0; q < numQueries; q++)
+            {
+                int found = suggestPoolSearch(pool, queries[q], best, SPELL_BENCH_SUGGESTIONS);
+                mismatches += found != SPELL_BENCH_SUGGESTIONS ||
+                              memcmp(best, expected[q], sizeof(best)) != 0;
+            }
+            char label[32];
+            snprintf(label, sizeof(label), batched ? "%d (batch pool)" : "%d", size);
+            printf("%-14s %10.1f\n", label, (wallSeconds() - start) / numQueries * 1e6);
+            suggestPoolDelete(pool);
+            if (size == threads)
+            {
+                break;
+            }
+        }
+    }
+    wordBatchDelete(batch);
+    printf("\n");
+    free(expected);
+    return mismatches;
+}
+
+/**
+ * Prints one row of the results table.
+ * @param engine
+ * @param result
+ * @param numQueries
+ * @param numWords
+ */
+static void printResult(const char *engine, SpellBenchResult *result, int numQueries,
+                        int numWords)
+{
+    printf("%-10s %10.3f %12.1f %14.1f %16.0f %12.2f%% %10lld\n", engine, result->buildSeconds,
+           result->bytes / 1048576.0, result->querySeconds / numQueries * 1e6,
+           (double)result->distances / numQueries,
+           100.0 * result->distances / numQueries / numWords, result->found);
+}
+
+/**
+ * Prints the command line usage.
+ * @param program
+ */
+static void printUsage(const char *program)
+{
+    fprintf(stderr, "Usage: %s [--queries=N] [--distance=K] [--prefix=P] [--seed=N]\n"
+                    "           [--dictionary=PATH] [--kernels] [-j threads]\n",
+            program);
+}
+
+/**
+ * Misspells random dictionary words and times finding every word within the
+ * given distance of them, by comparing with every word, with the words of the
+ * lengths within that distance, with a BK-tree, with a DAWG and with a
+ * deletion index of the first --prefix letters of each word. Prints the build time, the index
+ * size, the time per query and the share of the dictionary each query
+ * computes the distance to. Every engine must find the same words. With
+ * --kernels, first times the edit distance kernels per pair and checks that
+ * they agree. Also times finding the 5 closest words by comparing with every
+ * word, on up to -j threads (one per CPU by default).
+ * @param argc
+ * @param argv
+ * @return 0 on success, 1 on failure.
+ */
+int main(int argc, const char **argv)
+{
+    int numQueries = 200;
+    int maxDistance = 2;
+    int prefixLength = DELETION_INDEX_PREFIX;
+    uint64_t seed = 1;
+    const char *fileName = "dictionary.txt";
+    int kernels = 0;
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    for (int i = 1; i < argc; i++)
+    {
+        if (strncmp(argv[i], "--queries=", 10) == 0)
+        {
+            numQueries = atoi(argv[i] + 10);
+        }
+        else if (strncmp(argv[i], "--distance=", 11) == 0)
+        {
+            maxDistance = atoi(argv[i] + 11);
+        }
+        else if (strncmp(argv[i], "--prefix=", 9) == 0)
+        {
+            prefixLength = atoi(argv[i] + 9);
+        }
+        else if (strncmp(argv[i], "--seed=", 7) == 0)
+        {
+            seed = strtoull(argv[i] + 7, NULL, 10);
+        }
+        else if (strncmp(argv[i], "--dictionary=", 13) == 0)
+        {
+            fileName = argv[i] + 13;
+        }
+        else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+        {
+            threads = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--kernels") == 0)
+        {
+            kernels = 1;
+        }
+        else
+        {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (numQueries <= 0 || maxDistance < 0 || maxDistance > DELETION_INDEX_MAX_DISTANCE ||
+        prefixLength < 1 || prefixLength > DELETION_INDEX_MAX_PREFIX || threads < 1 ||
+        threads > SUGGEST_POOL_MAX_THREADS)
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    Dictionary *dictionary = dictionaryLoad(fileName, 1);
+    if (dictionary == NULL || dictionary->numWords == 0)
+    {
+        fprintf(stderr, "Could not read dictionary: %s\n", fileName);
+        return 1;
+    }
+    char (*queries)[SPELL_BENCH_MAX_LENGTH] = malloc(SPELL_BENCH_MAX_LENGTH * numQueries);
+    for (int q = 0; q < numQueries; q++)
+    {
+        misspell(dictionary, &seed, queries[q]);
+    }
+
+    printf("%d words, %d queries, distance %d\n", dictionary->numWords, numQueries, maxDistance);
+    int status = 0;
+    if (kernels && benchKernels(dictionary, queries, numQueries, maxDistance) != 0)
+    {
+        fprintf(stderr, "The edit distance kernels disagree\n");
+        status = 1;
+    }
+    if (benchTopWords(dictionary, queries, numQueries, (int)threads) != 0)
+    {
+        fprintf(stderr, "The suggestion pools and batches disagree with the scan\n");
+        status = 1;
+    }
+    printf("%-10s %10s %12s %14s %16s %13s %10s\n", "Engine", "Build (s)", "Index (MB)",
+           "us/query", "Distances/query", "Visited", "Found");
+    SpellBenchResult scan;
+    SpellBenchResult bucketed;
+    SpellBenchResult tree;
+    SpellBenchResult graph;
+    SpellBenchResult deletes;
+    benchScan(dictionary, queries, numQueries, maxDistance, &scan);
+    printResult("scan", &scan, numQueries, dictionary->numWords);
+    benchBuckets(dictionary, queries, numQueries, maxDistance, &bucketed);
+    printResult("buckets", &bucketed, numQueries, dictionary->numWords);
+    benchBkTree(dictionary, queries, numQueries, maxDistance, &tree);
+    printResult("bktree", &tree, numQueries, dictionary->numWords);
+    benchDawg(dictionary, queries, numQueries, maxDistance, &graph);
+    printResult("dawg", &graph, numQueries, dictionary->numWords);
+    benchDeletes(dictionary, queries, numQueries, maxDistance, prefixLength, &deletes);
+    printResult("deletes", &deletes, numQueries, dictionary->numWords);
+
+    if (bucketed.found != scan.found)
+    {
+        fprintf(stderr, "The length buckets found %lld words, the scan %lld\n", bucketed.found,
+                scan.found);
+        status = 1;
+    }
+    if (tree.found != scan.found)
+    {
+        fprintf(stderr, "The BK-tree found %lld words, the scan %lld\n", tree.found, scan.found);
+        status = 1;
+    }
+    if (graph.found != scan.found)
+    {
+        fprintf(stderr, "The DAWG found %lld words, the scan %lld\n", graph.found, scan.found);
+        status = 1;
+    }
+    if (deletes.found != scan.found)
+    {
+        fprintf(stderr, "The deletion index found %lld words, the scan %lld\n", deletes.found,
+                scan.found);
+        status = 1;
+    }
+    free(queries);
+    dictionaryDelete(dictionary);
+    return status;
+}
@@ -1,53 +1,22 @@
-#include "hashMap.h"
+#include "dictionary.h"
+#include "levenshtein.h"
+#include "bkTree.h"
+#include "deletionIndex.h"
+#include "suggest.h"
+#include "suggestPool.h"
+#include "wordBatch.h"
+#include "dawg.h"
+#include "spellBatch.h"
+#include "tokenizer.h"
+#include "writer.h"
+#include "profile.h"
 #include <assert.h>
-#include <time.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
-
-#define MIN3(a, b, c) ((a) < (b) ? ((a) < (c) ? (a) : (c)) : ((b) < (c) ? (b) : (c)))
-
-/**
- * Allocates a string for the next word in the file and returns it. This string
- * is null terminated. Returns NULL after reaching the end of the file.
- * @param file
- * @return Allocated string or NULL.
- */
-char *nextWord(FILE *file)
-{
-    int maxLength = 16;
-    int length = 0;
-    char *word = malloc(sizeof(char) * maxLength);
-    while (1)
-    {
-        char c = fgetc(file);
-        if ((c >= '0' && c <= '9') ||
-            (c >= 'A' && c <= 'Z') ||
-            (c >= 'a' && c <= 'z') ||
-            c == '\'')
-        {
-            if (length + 1 >= maxLength)
-            {
-                maxLength *= 2;
-                word = realloc(word, maxLength);
-            }
-            word[length] = c;
-            length++;
-        }
-        else if (length > 0 || c == EOF)
-        {
-            break;
-        }
-    }
-    if (length == 0)
-    {
-        free(word);
-        return NULL;
-    }
-    word[length] = '\0';
-    return word;
-}
+#include <errno.h>
+#include <unistd.h>
 
 /**
  * Validates user input. Converts string to lowercase.
@@ -71,81 +40,359 @@ char *validateInput(char *input)
     return input;
 }
 
+enum SuggestEngine
+{
+    ENGINE_SCAN,
+    ENGINE_BK_TREE,
+    ENGINE_DELETES,
+    ENGINE_DAWG
+};
+
+typedef struct SuggestEngines SuggestEngines;
+
+/*
+ * The suggestion engine in use and its index; the others are NULL.
+ */
+struct SuggestEngines
+{
+    enum SuggestEngine engine;
+    SuggestPool *pool;
+    BkTree *tree;
+    DeletionIndex *deletes;
+    Dawg *dawg;
+    // Length of the longest dictionary word.
+    int maxLength;
+};
+
 /**
- * Calculates Levenshtein distance.
- * Source: https://en.wikibooks.org/wiki/Algorithm_Implementation/Strings/Levenshtein_distance#C
+ * Finds the closest dictionary words with the BK-tree or the deletion index.
+ * The search distance starts at the difference between the word's length and
+ * the longest dictionary word's, since no word is closer, and doubles until
+ * enough words are found. The deletion index is not searched beyond the
+ * distance it was built for.
+ * @param tree The BK-tree, or NULL to use the deletion index.
+ * @param deletes
+ * @param maxLength Length of the longest dictionary word.
+ * @param word
+ * @param best Filled with the closest words, nearest first.
+ * @param count Number of words wanted.
+ * @return Number of words found.
  */
-int levenshteinDistance(char *s1, char *s2)
+static int suggestWithIndex(BkTree *tree, DeletionIndex *deletes, int maxLength,
+                            const char *word, Suggestion *best, int count)
 {
-    unsigned int s1len, s2len, x, y, lastdiag, olddiag;
-    s1len = strlen(s1);
-    s2len = strlen(s2);
-    unsigned int column[s1len + 1];
-    for (y = 1; y <= s1len; y++)
-        column[y] = y;
-    for (x = 1; x <= s2len; x++)
+    int numWords = tree != NULL ? tree->numWords : deletes->numWords;
+    int wanted = count < numWords ? count : numWords;
+    int length = (int)strlen(word);
+    int maxDistance = length - maxLength > 1 ? length - maxLength : 1;
+    for (;; maxDistance *= 2)
     {
-        column[0] = x;
-        for (y = 1, lastdiag = x - 1; y <= s1len; y++)
+        if (tree == NULL && maxDistance > deletes->maxDistance)
         {
-            olddiag = column[y];
-            column[y] = MIN3(column[y] + 1, column[y - 1] + 1, lastdiag + (s1[y - 1] == s2[x - 1] ? 0 : 1));
-            lastdiag = olddiag;
+            maxDistance = deletes->maxDistance;
         }
+        Suggestion *matches;
+        int found = tree != NULL ? bkTreeSearch(tree, word, maxDistance, &matches, NULL)
+                                 : deletionIndexSearch(deletes, word, maxDistance, &matches, NULL);
+        if (found >= wanted || (tree == NULL && maxDistance >= deletes->maxDistance))
+        {
+            qsort(matches, found, sizeof(Suggestion), suggestionCompare);
+            found = found < wanted ? found : wanted;
+            for (int i = 0; i < found; i++)
+            {
+                best[i] = matches[i];
+            }
+            free(matches);
+            return found;
+        }
+        free(matches);
     }
-    return (column[s1len]);
 }
 
 /**
- * Loads the contents of the file into the hash map.
- * @param file
- * @param map
+ * Finds the closest dictionary words with the engine in use.
+ * @param engines The SuggestEngines.
+ * @param word
+ * @param best Filled with the closest words, nearest first.
+ * @param count Number of words wanted.
+ * @return Number of words found.
  */
-void loadDictionary(FILE *file, HashMap *map)
+static int suggestWords(void *engines, const char *word, Suggestion *best, int count)
 {
-    assert(file != NULL);
-    assert(map != NULL);
-
-    char *word = nextWord(file);
+    SuggestEngines *in = engines;
+    if (in->engine == ENGINE_SCAN)
+    {
+        return suggestPoolSearch(in->pool, word, best, count);
+    }
+    if (in->engine == ENGINE_DAWG)
+    {
+        return dawgSuggest(in->dawg, word, best, count);
+    }
+    return suggestWithIndex(in->tree, in->deletes, in->maxLength, word, best, count);
+}
 
-    while (word != NULL)
+/**
+ * Checks every word of a file, or of standard input for "-", and writes the
+ * distinct misspelled words with their suggestions to standard output, one
+ * per line (see spellBatchCheck). Reports the throughput on standard error.
+ * @param fileName
+ * @param dictionary
+ * @param engines
+ * @param count Number of suggestions per word.
+ * @param maxDistance Largest distance of a suggestion for a word longer than
+ *                    every dictionary word; longer words get none.
+ * @param profile
+ * @return 0 on success, 1 if the file could not be opened or read or the
+ *         output could not be written.
+ */
+static int runBatch(const char *fileName, Dictionary *dictionary, SuggestEngines *engines,
+                    int count, int maxDistance, Profile *profile)
+{
+    FILE *fp = strcmp(fileName, "-") == 0 ? stdin : fopen(fileName, "r");
+    if (fp == NULL)
+    {
+        fprintf(stderr, "Could not open file: %s\n", fileName);
+        return 1;
+    }
+    profileBegin(profile, "check");
+    Tokenizer *tokenizer = tokenizerNew(fp);
+    tokenizerPipeline(tokenizer, BLOCK_READER_DEPTH);
+    Writer writer;
+    writerInit(&writer, stdout, WRITER_BUFFER_SIZE);
+    SpellBatchStats stats;
+    spellBatchCheck(dictionary, tokenizer, suggestWords, engines, count, maxDistance, &writer,
+                    &stats);
+    writerCleanUp(&writer);
+    int error = tokenizer->error;
+    tokenizerDelete(tokenizer);
+    if (fp != stdin)
+    {
+        fclose(fp);
+    }
+    profileEnd(profile);
+    if (error != 0)
     {
-        hashMapPut(map, word, -1);
-        free(word);
-        word = nextWord(file);
+        fprintf(stderr, "Could not read file: %s: %s\n", fileName, strerror(error));
+        return 1;
     }
+    if (fflush(stdout) != 0 || ferror(stdout))
+    {
+        fprintf(stderr, "Could not write output: %s\n", strerror(errno));
+        return 1;
+    }
+    double seconds = profileWall(profile, "check");
+    fprintf(stderr,
+            "%lld words checked in %f seconds (%.0f words/s): %lld misspelled, %d distinct, "
+            "%lld with digits skipped, %d too long for suggestions\n",
+            stats.words, seconds, seconds > 0 ? stats.words / seconds : 0.0, stats.misspelled,
+            stats.distinct, stats.skipped, stats.tooLong);
+    return 0;
+}
+
+/**
+ * Prints the command line usage.
+ * @param program
+ */
+static void printUsage(const char *program)
+{
+    fprintf(stderr, "Usage: %s [-j threads] [--engine=bktree|scan|deletes|dawg] [--index=FILE]\n"
+                    "           [--max-distance=D] [--prefix=P] [--build-index=FILE]\n"
+                    "           [--profile[=table|json]] [--batch FILE|-]\n",
+            program);
 }
 
 /**
- * Prints the concordance of the given file and performance information. Uses
- * the file input1.txt by default or a file name specified as a command line
- * argument.
+ * Checks the words typed in against dictionary.txt and suggests the closest
+ * dictionary words for misspelled ones. The dictionary is loaded by -j threads,
+ * one per CPU by default, and suggestions are searched in a BK-tree built over
+ * it, by comparing with every word on the same threads with --engine=scan,
+ * or in a deletion index with --engine=deletes. The deletion index covers
+ * --max-distance edits of the first --prefix letters of each word; it is built
+ * at load time, or mapped from a file written by --build-index=FILE and given
+ * with --index=FILE. With --engine=dawg, words are both looked up and
+ * suggested from a minimal word graph instead of the hash index. With
+ * --batch FILE, or --batch - for standard input, checks all the words of the
+ * text instead and writes the misspelled ones and their suggestions to
+ * standard output, with the other messages on standard error. With
+ * --profile[=table|json], reports the time spent loading, looking up and
+ * suggesting on standard error at exit.
  * @param argc
  * @param argv
  * @return
  */
 int main(int argc, const char **argv)
 {
-    HashMap *map = hashMapNew(1000);
+    int profileFormat = 0;
+    enum SuggestEngine engine = ENGINE_BK_TREE;
+    const char *indexFile = NULL;
+    const char *buildFile = NULL;
+    const char *batchFile = NULL;
+    int maxDistance = DELETION_INDEX_DISTANCE;
+    int prefixLength = DELETION_INDEX_PREFIX;
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = threads < 1 ? 1 : threads > DICTIONARY_MAX_THREADS ? DICTIONARY_MAX_THREADS : threads;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc &&
+            atoi(argv[i + 1]) >= 1 && atoi(argv[i + 1]) <= DICTIONARY_MAX_THREADS)
+        {
+            threads = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--profile") == 0 || strcmp(argv[i], "--profile=table") == 0)
+        {
+            profileFormat = 1;
+        }
+        else if (strcmp(argv[i], "--profile=json") == 0)
+        {
+            profileFormat = 2;
+        }
+        else if (strcmp(argv[i], "--engine=scan") == 0)
+        {
+            engine = ENGINE_SCAN;
+        }
+        else if (strcmp(argv[i], "--engine=bktree") == 0)
+        {
+            engine = ENGINE_BK_TREE;
+        }
+        else if (strcmp(argv[i], "--engine=deletes") == 0)
+        {
+            engine = ENGINE_DELETES;
+        }
+        else if (strcmp(argv[i], "--engine=dawg") == 0)
+        {
+            engine = ENGINE_DAWG;
+        }
+        else if (strncmp(argv[i], "--index=", 8) == 0)
+        {
+            indexFile = argv[i] + 8;
+            engine = ENGINE_DELETES;
+        }
+        else if (strncmp(argv[i], "--build-index=", 14) == 0)
+        {
+            buildFile = argv[i] + 14;
+        }
+        else if (strncmp(argv[i], "--max-distance=", 15) == 0)
+        {
+            maxDistance = atoi(argv[i] + 15);
+        }
+        else if (strncmp(argv[i], "--prefix=", 9) == 0)
+        {
+            prefixLength = atoi(argv[i] + 9);
+        }
+        else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc)
+        {
+            batchFile = argv[++i];
+        }
+        else
+        {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (maxDistance < 1 || maxDistance > DELETION_INDEX_MAX_DISTANCE || prefixLength < 1 ||
+        prefixLength > DELETION_INDEX_MAX_PREFIX)
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+    Profile profile;
+    profileInit(&profile, profileFormat != 0);
+    profileBegin(&profile, "total");
 
-    FILE *file = fopen("dictionary.txt", "r");
-    clock_t timer = clock();
-    loadDictionary(file, map);
-    timer = clock() - timer;
-    printf("Dictionary loaded in %f seconds\n", (float)timer / (float)CLOCKS_PER_SEC);
-    fclose(file);
+    profileBegin(&profile, "load dictionary");
+    Dictionary *dictionary = dictionaryLoad("dictionary.txt", (int)threads);
+    profileEnd(&profile);
+    if (dictionary == NULL)
+    {
+        fprintf(stderr, "Could not open file: dictionary.txt\n");
+        profileCleanUp(&profile);
+        return 1;
+    }
+    // Standard output only holds results in batch mode.
+    FILE *log = batchFile != NULL ? stderr : stdout;
+    fprintf(log, "Dictionary loaded in %f seconds\n", profileWall(&profile, "load dictionary"));
+    const char *const *words = (const char *const *)dictionary->words;
+    if (buildFile != NULL)
+    {
+        // Offline build: write the index for later runs and stop.
+        DeletionIndex *built = deletionIndexNew(words, dictionary->numWords, maxDistance,
+                                                prefixLength);
+        int saved = deletionIndexSave(built, buildFile);
+        if (saved)
+        {
+            printf("Deletion index of %u entries (%zu bytes) written to %s\n",
+                   built->numEntries, deletionIndexBytes(built), buildFile);
+        }
+        else
+        {
+            fprintf(stderr, "Could not write file: %s\n", buildFile);
+        }
+        deletionIndexDelete(built);
+        dictionaryDelete(dictionary);
+        profileCleanUp(&profile);
+        return saved ? 0 : 1;
+    }
+    BkTree *tree = NULL;
+    DeletionIndex *deletes = NULL;
+    Dawg *dawg = NULL;
+    WordBatch *batch = NULL;
+    SuggestPool *pool = NULL;
+    if (engine == ENGINE_SCAN)
+    {
+        batch = wordBatchNew(words, dictionary->numWords);
+        pool = suggestPoolNewBatch(batch, (int)threads);
+    }
+    else if (engine == ENGINE_BK_TREE)
+    {
+        profileBegin(&profile, "build index");
+        tree = bkTreeNew(words, dictionary->numWords);
+        profileEnd(&profile);
+        fprintf(log, "BK-tree built in %f seconds\n", profileWall(&profile, "build index"));
+    }
+    else if (engine == ENGINE_DELETES)
+    {
+        profileBegin(&profile, "build index");
+        deletes = indexFile != NULL ? deletionIndexLoad(indexFile, words, dictionary->numWords)
+                                    : deletionIndexNew(words, dictionary->numWords, maxDistance,
+                                                       prefixLength);
+        profileEnd(&profile);
+        if (deletes == NULL)
+        {
+            fprintf(stderr, "Could not load a deletion index of dictionary.txt from %s\n",
+                    indexFile);
+            dictionaryDelete(dictionary);
+            profileCleanUp(&profile);
+            return 1;
+        }
+        fprintf(log, "Deletion index %s in %f seconds\n", indexFile != NULL ? "mapped" : "built",
+                profileWall(&profile, "build index"));
+    }
+    else if (engine == ENGINE_DAWG)
+    {
+        profileBegin(&profile, "build index");
+        dawg = dawgNew(words, dictionary->numWords);
+        profileEnd(&profile);
+        fprintf(log, "DAWG of %d nodes (%zu bytes) built in %f seconds\n", dawg->numNodes,
+                dawgBytes(dawg), profileWall(&profile, "build index"));
+    }
+    SuggestEngines engines = {engine, pool, tree, deletes, dawg, dictionary->maxLength};
     int num_suggestions = 5;
-    int first_five = 0;
-    int distance;
-    char suggestions[5][50] = {"", "", "", "", ""};
-    int smallestDistance = 1000;
-    int leastValuableIdx = -1;
     char inputBuffer[256];
     int quit = 0;
+    int status = 0;
+    if (batchFile != NULL)
+    {
+        status = runBatch(batchFile, dictionary, &engines, num_suggestions, maxDistance, &profile);
+        quit = 1;
+    }
     while (!quit)
     {
         printf("\nEnter a word or \"quit\" to quit: ");
-        scanf("%s", inputBuffer);
+        if (scanf("%255s", inputBuffer) != 1)
+        {
+            // End of input quits as well.
+            break;
+        }
 
         // Implement the spell checker code here..
         char *word = validateInput(inputBuffer);
@@ -160,7 +407,10 @@ int main(int argc, const char **argv)
             printf("Invalid input. Enter one word, lowercase and uppercase letters only.\n");
             printf("Or type 'quit' to quit the program.\n");
             printf("Enter a word: ");
-            scanf("%s", inputBuffer);
+            if (scanf("%255s", inputBuffer) != 1)
+            {
+                strcpy(inputBuffer, "quit");
+            }
 
             if (strcmp(inputBuffer, "quit") == 0)
             {
@@ -172,73 +422,22 @@ int main(int argc, const char **argv)
         if (!quit)
         {
             // If word not in dictionary
-            if (hashMapGet(map, word) == NULL)
+            profileBegin(&profile, "lookup");
+            int found = (dawg != NULL ? dawgFind(dawg, word)
+                                      : dictionaryFind(dictionary, word)) >= 0;
+            profileEnd(&profile);
+            if (!found)
             {
                 printf("The inputted word %s is spelled incorrectly.\n", word);
-                // Loop through map
-                for (int i = 0; i < hashMapCapacity(map); i++)
-                {
-                    // Pointer for current bucket
-                    struct HashLink *current = map->table[i];
-                    if (current != NULL)
-                    {
-                        while (current != NULL)
-                        {
-                            distance = levenshteinDistance(word, current->key);
-                            hashMapPut(map, current->key, distance);
-                            current = current->next;
-                        }
-                    }
-                }
-                // Loop through map
-                for (int i = 0; i < hashMapCapacity(map); i++)
-                {
-                    struct HashLink *current = map->table[i];
-                    if (current != NULL)
-                    {
-                        while (current != NULL)
-                        {
-                            // Make first 5 inputs original suggestions
-                            if (first_five < 5)
-                            {
-                                strcpy(suggestions[first_five], current->key);
-                                if (current->value < smallestDistance)
-                                {
-                                    smallestDistance = current->value;
-                                }
-                                // Get least valuable index
-                                if (current->value > levenshteinDistance(word, suggestions[leastValuableIdx]))
-                                {
-                                    leastValuableIdx = first_five;
-                                }
-                                first_five++;
-                            }
-                            else
-                            {
-                                // Replace suggestion if current value in loop is smaller
-                                for (int j = 0; j < num_suggestions; j++)
-                                {
-                                    if (current->value < levenshteinDistance(word, suggestions[j]))
-                                    {
-                                        strcpy(suggestions[j], current->key);
-                                        break;
-                                    }
-                                }
-                                // Update smallest distance as needed
-                                if (current->value < smallestDistance)
-                                {
-                                    smallestDistance = current->value;
-                                }
-                            }
-                            current = current->next;
-                        }
-                    }
-                }
+                profileBegin(&profile, "suggest");
+                Suggestion best[5];
+                int shown = suggestWords(&engines, word, best, num_suggestions);
+                profileEnd(&profile);
                 // Print suggestions
                 printf("Did you mean...?\n");
-                for (int i = 0; i < num_suggestions; i++)
+                for (int i = 0; i < shown; i++)
                 {
-                    printf("%s\n", suggestions[i]);
+                    printf("%s\n", dictionary->words[best[i].word]);
                 }
             }
             else
@@ -249,6 +448,35 @@ int main(int argc, const char **argv)
         }
     }
 
-    hashMapDelete(map);
-    return 0;
+    if (pool != NULL)
+    {
+        suggestPoolDelete(pool);
+        wordBatchDelete(batch);
+    }
+    if (tree != NULL)
+    {
+        bkTreeDelete(tree);
+    }
+    if (deletes != NULL)
+    {
+        deletionIndexDelete(deletes);
+    }
+    if (dawg != NULL)
+    {
+        dawgDelete(dawg);
+    }
+    dictionaryDelete(dictionary);
+    profileEnd(&profile);
+    fflush(stdout);
+    if (profileFormat == 1)
+    {
+        fprintf(stderr, "\n");
+        profilePrint(&profile, stderr);
+    }
+    else if (profileFormat == 2)
+    {
+        profilePrintJson(&profile, stderr);
+    }
+    profileCleanUp(&profile);
+    return status;
 }
\ No newline at end of file
@@ -0,0 +1,247 @@
+#define _POSIX_C_SOURCE 200809L
+#include "stream.h"
+#include "hashMap.h"
+#include "tokenizer.h"
+#include "concordance.h"
+#include "spaceSaving.h"
+#include "profile.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <glob.h>
+
+typedef struct Stream Stream;
+
+/*
+ * State of a streaming concordance. Memory is bounded by the vocabulary: the
+ * counts, the tracked top words and, with deltas, the counts of the words
+ * seen since the last report. With a Space-Saving summary, the counts and the
+ * tracked top words are replaced by a fixed number of counters.
+ */
+struct Stream
+{
+    StreamOptions *options;
+    // Exact counts, or NULL when using the summary.
+    HashMap *map;
+    // Approximate top words, or NULL when counting exactly.
+    SpaceSaving *summary;
+    // Counts since the last report, or NULL without deltas.
+    HashMap *interval;
+    TopWords top;
+    long long words;
+    int reports;
+    // Totals at the last report.
+    long long reportWords;
+    int reportDistinct;
+    double reportTime;
+};
+
+/**
+ * Prints the tracked words, one per line with its count.
+ * @param top
+ */
+static void printTopWords(TopWords *top)
+{
+    for (int i = 0; i < top->size; i++)
+    {
+        printf("%12d  %s\n", top->entries[i].count, top->entries[i].word);
+    }
+}
+
+/**
+ * Prints the k most frequent words of the summary with the range their true
+ * counts are guaranteed to be in.
+ * @param summary
+ * @param k
+ */
+static void printSummaryTop(SpaceSaving *summary, int k)
+{
+    SpaceSavingCounter *top = malloc(sizeof(SpaceSavingCounter) * k);
+    int n = spaceSavingTop(summary, top, k);
+    printf("Top %d (%d counters, true count between low and high):\n", k,
+           summary->capacity);
+    printf("%12s %12s  %s\n", "high", "low", "word");
+    for (int i = 0; i < n; i++)
+    {
+        printf("%12lld %12lld  %s\n", top[i].count, top[i].count - top[i].error,
+               top[i].word);
+    }
+    free(top);
+}
+
+/**
+ * Prints a report of the totals and the top words. Only the tracked top words
+ * and the words seen since the last report are visited, never the whole map.
+ * @param stream
+ * @param final 1 for the report at the end of the input.
+ */
+static void streamReport(Stream *stream, int final)
+{
+    int distinct = 0;
+    stream->reports++;
+    if (stream->summary != NULL)
+    {
+        printf("\n--- %s %d: %lld words (+%lld words) ---\n",
+               final ? "Final report" : "Report", stream->reports, stream->words,
+               stream->words - stream->reportWords);
+        printSummaryTop(stream->summary, stream->options->top);
+    }
+    else
+    {
+        distinct = hashMapSize(stream->map);
+        printf("\n--- %s %d: %lld words, %d distinct (+%lld words, +%d new) ---\n",
+               final ? "Final report" : "Report", stream->reports, stream->words,
+               distinct, stream->words - stream->reportWords,
+               distinct - stream->reportDistinct);
+        printf("Top %d:\n", stream->options->top);
+        printTopWords(&stream->top);
+    }
+
+    if (stream->interval != NULL)
+    {
+        TopWords recent;
+        topWordsInit(&recent, stream->options->top);
+        for (int i = 0; i < hashMapCapacity(stream->interval); i++)
+        {
+            for (HashLink *link = stream->interval->table[i]; link != NULL; link = link->next)
+            {
+                topWordsUpdate(&recent, link->key, link->value);
+            }
+        }
+        printf("Top %d since last report:\n", stream->options->top);
+        printTopWords(&recent);
+        topWordsCleanUp(&recent);
+        hashMapDelete(stream->interval);
+        stream->interval = hashMapNew(10);
+    }
+    fflush(stdout);
+
+    stream->reportWords = stream->words;
+    stream->reportDistinct = distinct;
+    stream->reportTime = wallSeconds();
+}
+
+/**
+ * Counts all words of an open file, reporting whenever a report is due.
+ * @param stream
+ * @param file
+ * @return errno of a failed read, 0 if the whole file was read.
+ */
+static int streamFile(Stream *stream, FILE *file)
+{
+    StreamOptions *options = stream->options;
+    Tokenizer tokenizer;
+    tokenizerInit(&tokenizer, file, TOKENIZER_BLOCK_SIZE);
+    char *word;
+    int length;
+    while (tokenizerNext(&tokenizer, &word, &length))
+    {
+        if (stream->summary != NULL)
+        {
+            spaceSavingAdd(stream->summary, word);
+        }
+        else
+        {
+            topWordsUpdate(&stream->top, word, concordanceAdd(stream->map, word));
+        }
+        if (stream->interval != NULL)
+        {
+            concordanceAdd(stream->interval, word);
+        }
+        stream->words++;
+
+        if ((options->everyWords > 0 &&
+             stream->words - stream->reportWords >= options->everyWords) ||
+            (options->everySeconds > 0 &&
+             wallSeconds() - stream->reportTime >= options->everySeconds))
+        {
+            streamReport(stream, 0);
+        }
+    }
+    int error = tokenizer.error;
+    tokenizerCleanUp(&tokenizer);
+    return error;
+}
+
+/**
+ * Counts the words of all inputs as one stream, printing incremental reports
+ * as configured and a final report at the end. An input of "-" is standard
+ * input; other inputs may be glob patterns. Time based reports are checked as
+ * words arrive, so an idle input delays them until the next word.
+ * @param inputs
+ * @param numInputs
+ * @param options
+ * @return 0 on success, 1 if an input could not be opened or read.
+ */
+int streamRun(const char **inputs, int numInputs, StreamOptions *options)
+{
+    assert(options->top > 0);
+    Stream stream;
+    stream.options = options;
+    stream.map = options->counters > 0 ? NULL : hashMapNew(10);
+    stream.summary = options->counters > 0 ? spaceSavingNew(options->counters) : NULL;
+    stream.interval = options->delta ? hashMapNew(10) : NULL;
+    topWordsInit(&stream.top, options->top);
+    stream.words = 0;
+    stream.reports = 0;
+    stream.reportWords = 0;
+    stream.reportDistinct = 0;
+    stream.reportTime = wallSeconds();
+
+    int status = 0;
+    for (int i = 0; i < numInputs; i++)
+    {
+        if (strcmp(inputs[i], "-") == 0)
+        {
+            int error = streamFile(&stream, stdin);
+            if (error != 0)
+            {
+                fprintf(stderr, "Could not read standard input: %s\n", strerror(error));
+                status = 1;
+            }
+            continue;
+        }
+
+        glob_t paths;
+        if (glob(inputs[i], GLOB_NOCHECK, NULL, &paths) != 0)
+        {
+            continue;
+        }
+        for (size_t j = 0; j < paths.gl_pathc; j++)
+        {
+            FILE *file = fopen(paths.gl_pathv[j], "r");
+            if (file == NULL)
+            {
+                fprintf(stderr, "Could not open file: %s\n", paths.gl_pathv[j]);
+                status = 1;
+                continue;
+            }
+            int error = streamFile(&stream, file);
+            if (error != 0)
+            {
+                fprintf(stderr, "Could not read file: %s: %s\n", paths.gl_pathv[j],
+                        strerror(error));
+                status = 1;
+            }
+            fclose(file);
+        }
+        globfree(&paths);
+    }
+    streamReport(&stream, 1);
+
+    topWordsCleanUp(&stream.top);
+    if (stream.interval != NULL)
+    {
+        hashMapDelete(stream.interval);
+    }
+    if (stream.summary != NULL)
+    {
+        spaceSavingDelete(stream.summary);
+    }
+    else
+    {
+        hashMapDelete(stream.map);
+    }
+    return status;
+}
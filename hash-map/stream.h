@@ -0,0 +1,26 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+typedef struct StreamOptions StreamOptions;
+
+/*
+ * Settings of a streaming concordance run.
+ */
+struct StreamOptions
+{
+    // Number of words listed in each report.
+    int top;
+    // Report after this many words, or 0 to not report by word count.
+    long long everyWords;
+    // Report after this many seconds, or 0 to not report by time.
+    double everySeconds;
+    // 1 to also list the most frequent words since the previous report.
+    int delta;
+    // Counters of a Space-Saving summary used instead of exact counts, so
+    // memory does not depend on the vocabulary, or 0 to count exactly.
+    int counters;
+};
+
+int streamRun(const char **inputs, int numInputs, StreamOptions *options);
+
+#endif
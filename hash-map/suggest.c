@@ -0,0 +1,210 @@
+#include "suggest.h"
+#include "levenshtein.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+/**
+ * Orders suggestions by distance, then by dictionary order, so that the same
+ * query always gives the same suggestions in the same order.
+ * @param a
+ * @param b
+ * @return Negative, zero or positive, as for qsort.
+ */
+int suggestionCompare(const void *a, const void *b)
+{
+    const Suggestion *x = a;
+    const Suggestion *y = b;
+    if (x->distance != y->distance)
+    {
+        return x->distance < y->distance ? -1 : 1;
+    }
+    return (x->word > y->word) - (x->word < y->word);
+}
+
+/**
+ * Initializes an empty heap keeping up to capacity suggestions in items.
+ * @param heap
+ * @param items Room for capacity suggestions.
+ * @param capacity
+ */
+void suggestionHeapInit(SuggestionHeap *heap, Suggestion *items, int capacity)
+{
+    assert(heap != NULL);
+    assert(items != NULL || capacity == 0);
+    heap->items = items;
+    heap->size = 0;
+    heap->capacity = capacity;
+}
+
+/**
+ * Returns the largest distance at which a word would still be kept: one less
+ * than the worst suggestion's distance, or equal to it if the word comes
+ * first in the dictionary. Distances beyond it need not be computed.
+ * @param heap
+ * @param word
+ * @param largest Limit to return while the heap is not full.
+ * @return The limit, negative if no distance would do.
+ */
+int suggestionHeapLimit(SuggestionHeap *heap, int word, int largest)
+{
+    if (heap->size < heap->capacity)
+    {
+        return largest;
+    }
+    if (heap->capacity == 0)
+    {
+        return -1;
+    }
+    return heap->items[0].distance - (word > heap->items[0].word);
+}
+
+/**
+ * Keeps a suggestion if the heap is not full or if it is better than the
+ * worst one kept, which it then replaces.
+ * @param heap
+ * @param word
+ * @param distance
+ * @return 1 if the suggestion was kept, 0 otherwise.
+ */
+int suggestionHeapOffer(SuggestionHeap *heap, int word, int distance)
+{
+    Suggestion offered = {word, distance};
+    Suggestion *items = heap->items;
+    int at;
+    if (heap->size < heap->capacity)
+    {
+        // Sift up from the new leaf.
+        at = heap->size++;
+        while (at > 0 && suggestionCompare(&items[(at - 1) / 2], &offered) < 0)
+        {
+            items[at] = items[(at - 1) / 2];
+            at = (at - 1) / 2;
+        }
+        items[at] = offered;
+        return 1;
+    }
+    if (heap->capacity == 0 || suggestionCompare(&offered, &items[0]) >= 0)
+    {
+        return 0;
+    }
+    // Sift down from the root, which is replaced.
+    at = 0;
+    while (1)
+    {
+        int child = 2 * at + 1;
+        if (child >= heap->size)
+        {
+            break;
+        }
+        if (child + 1 < heap->size && suggestionCompare(&items[child + 1], &items[child]) > 0)
+        {
+            child++;
+        }
+        if (suggestionCompare(&items[child], &offered) <= 0)
+        {
+            break;
+        }
+        items[at] = items[child];
+        at = child;
+    }
+    items[at] = offered;
+    return 1;
+}
+
+/**
+ * Sorts the suggestions kept nearest first. The heap is then no longer valid.
+ * @param heap
+ * @return Number of suggestions.
+ */
+int suggestionHeapSort(SuggestionHeap *heap)
+{
+    qsort(heap->items, heap->size, sizeof(Suggestion), suggestionCompare);
+    return heap->size;
+}
+
+/**
+ * Lowers a limit shared by threads filling heaps of the same capacity to the
+ * distance of this heap's worst suggestion, if the heap is full: no word
+ * farther than that can be among the best overall. Another thread may have
+ * lowered it further already.
+ * @param heap
+ * @param sharedLimit
+ */
+void suggestionHeapShare(SuggestionHeap *heap, int *sharedLimit)
+{
+    if (heap->size < heap->capacity || heap->capacity == 0)
+    {
+        return;
+    }
+    int worst = heap->items[0].distance;
+    int shared = __atomic_load_n(sharedLimit, __ATOMIC_RELAXED);
+    while (worst < shared &&
+           !__atomic_compare_exchange_n(sharedLimit, &shared, worst, 0, __ATOMIC_RELAXED,
+                                        __ATOMIC_RELAXED))
+    {
+        // shared was reloaded by the failed exchange.
+    }
+}
+
+/**
+ * Offers the words of a range of the dictionary to a heap, comparing with each
+ * of them once. Each distance is only computed up to the limit at which the
+ * word could still be kept, which tightens as closer words are found. When
+ * several threads scan ranges into heaps of the same capacity, they also
+ * prune with a limit they share (see suggestionHeapShare).
+ * @param words
+ * @param first First word of the range.
+ * @param last End of the range.
+ * @param word
+ * @param heap
+ * @param sharedLimit Limit shared with other threads, or NULL.
+ */
+void suggestScanRange(const char *const *words, int first, int last, const char *word,
+                      SuggestionHeap *heap, int *sharedLimit)
+{
+    int length = (int)strlen(word);
+    for (int i = first; i < last; i++)
+    {
+        // No distance is more than the longer length.
+        int limit = suggestionHeapLimit(heap, i, length + (int)strlen(words[i]));
+        if (sharedLimit != NULL)
+        {
+            int shared = __atomic_load_n(sharedLimit, __ATOMIC_RELAXED);
+            limit = shared < limit ? shared : limit;
+        }
+        if (limit < 0)
+        {
+            continue;
+        }
+        int distance = levenshteinBounded(word, words[i], limit);
+        if (distance <= limit && suggestionHeapOffer(heap, i, distance) && sharedLimit != NULL)
+        {
+            suggestionHeapShare(heap, sharedLimit);
+        }
+    }
+}
+
+/**
+ * Finds the closest words to a word by comparing with each of them once. Only
+ * the words and the caller's array are touched, so several queries can run at
+ * once.
+ * @param words
+ * @param numWords
+ * @param word
+ * @param best Filled with the closest words, nearest first, ties in
+ *             dictionary order.
+ * @param count Number of words wanted.
+ * @return Number of words found, less than count only if there are fewer
+ *         words.
+ */
+int suggestScan(const char *const *words, int numWords, const char *word, Suggestion *best,
+                int count)
+{
+    assert(words != NULL || numWords == 0);
+    assert(word != NULL);
+    SuggestionHeap heap;
+    suggestionHeapInit(&heap, best, count);
+    suggestScanRange(words, 0, numWords, word, &heap, NULL);
+    return suggestionHeapSort(&heap);
+}
@@ -0,0 +1,40 @@
+#ifndef SUGGEST_H
+#define SUGGEST_H
+
+typedef struct Suggestion Suggestion;
+typedef struct SuggestionHeap SuggestionHeap;
+
+/*
+ * A dictionary word proposed for a misspelled word, identified by its number
+ * in the dictionary.
+ */
+struct Suggestion
+{
+    int word;
+    int distance;
+};
+
+/*
+ * The best suggestions seen so far, at most capacity of them, in a max-heap
+ * whose root is the worst one kept: the farthest, and the latest in the
+ * dictionary among equally far ones. The items belong to the caller.
+ */
+struct SuggestionHeap
+{
+    Suggestion *items;
+    int size;
+    int capacity;
+};
+
+int suggestionCompare(const void *a, const void *b);
+void suggestionHeapInit(SuggestionHeap *heap, Suggestion *items, int capacity);
+int suggestionHeapLimit(SuggestionHeap *heap, int word, int largest);
+int suggestionHeapOffer(SuggestionHeap *heap, int word, int distance);
+int suggestionHeapSort(SuggestionHeap *heap);
+void suggestionHeapShare(SuggestionHeap *heap, int *sharedLimit);
+void suggestScanRange(const char *const *words, int first, int last, const char *word,
+                      SuggestionHeap *heap, int *sharedLimit);
+int suggestScan(const char *const *words, int numWords, const char *word, Suggestion *best,
+                int count);
+
+#endif
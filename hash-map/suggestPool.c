@@ -0,0 +1,169 @@
+#include "suggestPool.h"
+#include <stdlib.h>
+#include <limits.h>
+#include <assert.h>
+
+static void *scanQueries(void *arg)
+{
+    SuggestWorker *worker = arg;
+    SuggestPool *pool = worker->pool;
+    unsigned long seen = 0;
+    pthread_mutex_lock(&pool->lock);
+    while (1)
+    {
+        while (!pool->stop && pool->query == seen)
+        {
+            pthread_cond_wait(&pool->start, &pool->lock);
+        }
+        if (pool->stop)
+        {
+            break;
+        }
+        seen = pool->query;
+        const char *word = pool->word;
+        int count = pool->count;
+        pthread_mutex_unlock(&pool->lock);
+
+        SuggestionHeap heap;
+        suggestionHeapInit(&heap, worker->best, count);
+        if (pool->batch != NULL)
+        {
+            wordBatchScan(pool->batch, word, (int)(worker - pool->workers), pool->numWorkers,
+                          &heap, &pool->limit);
+        }
+        else
+        {
+            suggestScanRange(pool->words, worker->first, worker->last, word, &heap,
+                             &pool->limit);
+        }
+        worker->found = heap.size;
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->running == 0)
+        {
+            pthread_cond_signal(&pool->done);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+/**
+ * Starts a pool of threads over the words, each scanning an equal range of
+ * them. The words must stay valid for the life of the pool.
+ * @param words
+ * @param numWords
+ * @param threads Number of threads, at most SUGGEST_POOL_MAX_THREADS.
+ * @return The pool.
+ */
+SuggestPool *suggestPoolNew(const char *const *words, int numWords, int threads)
+{
+    assert(words != NULL || numWords == 0);
+    assert(threads > 0 && threads <= SUGGEST_POOL_MAX_THREADS);
+    SuggestPool *pool = malloc(sizeof(SuggestPool));
+    pool->words = words;
+    pool->numWords = numWords;
+    pool->batch = NULL;
+    pool->numWorkers = threads;
+    pool->workers = malloc(sizeof(SuggestWorker) * threads);
+    pool->word = NULL;
+    pool->count = 0;
+    pool->query = 0;
+    pool->running = 0;
+    pool->stop = 0;
+    pool->limit = INT_MAX;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    for (int i = 0; i < threads; i++)
+    {
+        SuggestWorker *worker = &pool->workers[i];
+        worker->pool = pool;
+        worker->first = (int)((long long)numWords * i / threads);
+        worker->last = (int)((long long)numWords * (i + 1) / threads);
+        worker->found = 0;
+        pthread_create(&worker->thread, NULL, scanQueries, worker);
+    }
+    return pool;
+}
+
+/**
+ * Starts a pool of threads over a word batch, each comparing with an equal
+ * share of its blocks. The batch must stay valid for the life of the pool.
+ * @param batch
+ * @param threads Number of threads, at most SUGGEST_POOL_MAX_THREADS.
+ * @return The pool.
+ */
+SuggestPool *suggestPoolNewBatch(WordBatch *batch, int threads)
+{
+    assert(batch != NULL);
+    SuggestPool *pool = suggestPoolNew(batch->words, batch->numWords, threads);
+    pthread_mutex_lock(&pool->lock);
+    pool->batch = batch;
+    pthread_mutex_unlock(&pool->lock);
+    return pool;
+}
+
+/**
+ * Stops the threads and frees the pool. Does not free the words.
+ * @param pool
+ */
+void suggestPoolDelete(SuggestPool *pool)
+{
+    assert(pool != NULL);
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 0; i < pool->numWorkers; i++)
+    {
+        pthread_join(pool->workers[i].thread, NULL);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->start);
+    pthread_cond_destroy(&pool->done);
+    free(pool->workers);
+    free(pool);
+}
+
+/**
+ * Finds the closest words to a word with all the threads of the pool, and
+ * merges their best suggestions. Gives the same suggestions as suggestScan.
+ * Queries are run one at a time.
+ * @param pool
+ * @param word
+ * @param best Filled with the closest words, nearest first, ties in
+ *             dictionary order.
+ * @param count Number of words wanted, at most SUGGEST_POOL_MAX_COUNT.
+ * @return Number of words found.
+ */
+int suggestPoolSearch(SuggestPool *pool, const char *word, Suggestion *best, int count)
+{
+    assert(pool != NULL);
+    assert(word != NULL);
+    assert(count >= 0 && count <= SUGGEST_POOL_MAX_COUNT);
+    pthread_mutex_lock(&pool->lock);
+    pool->word = word;
+    pool->count = count;
+    pool->limit = INT_MAX;
+    pool->running = pool->numWorkers;
+    pool->query++;
+    pthread_cond_broadcast(&pool->start);
+    while (pool->running > 0)
+    {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    SuggestionHeap heap;
+    suggestionHeapInit(&heap, best, count);
+    for (int i = 0; i < pool->numWorkers; i++)
+    {
+        for (int j = 0; j < pool->workers[i].found; j++)
+        {
+            suggestionHeapOffer(&heap, pool->workers[i].best[j].word,
+                                pool->workers[i].best[j].distance);
+        }
+    }
+    return suggestionHeapSort(&heap);
+}
@@ -0,0 +1,63 @@
+#ifndef SUGGEST_POOL_H
+#define SUGGEST_POOL_H
+
+#include "suggest.h"
+#include "wordBatch.h"
+#include <pthread.h>
+
+#define SUGGEST_POOL_MAX_THREADS 64
+#define SUGGEST_POOL_MAX_COUNT 64
+
+typedef struct SuggestPool SuggestPool;
+typedef struct SuggestWorker SuggestWorker;
+
+/*
+ * A worker of the pool and the range of words it scans.
+ */
+struct SuggestWorker
+{
+    SuggestPool *pool;
+    int first;
+    int last;
+    // Best suggestions of the range for the current query.
+    Suggestion best[SUGGEST_POOL_MAX_COUNT];
+    int found;
+    pthread_t thread;
+};
+
+/*
+ * Threads that each scan a fixed range of the words for every query. The
+ * threads are started once and wait for queries, so a query only costs two
+ * wake-ups beyond the scan itself. Each keeps its own best suggestions, and
+ * they prune with a limit they share, then the caller merges their results.
+ * A pool over a word batch has each thread take every numWorkers-th block of
+ * the batch instead of a range of words.
+ */
+struct SuggestPool
+{
+    const char *const *words;
+    int numWords;
+    // Batch to scan, or NULL to scan the words one at a time.
+    WordBatch *batch;
+    SuggestWorker *workers;
+    int numWorkers;
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    // Current query, its number, and the workers still scanning it.
+    const char *word;
+    int count;
+    unsigned long query;
+    int running;
+    // 1 when the workers must exit.
+    int stop;
+    // Largest distance a suggestion can still have, lowered by the workers.
+    int limit;
+};
+
+SuggestPool *suggestPoolNew(const char *const *words, int numWords, int threads);
+SuggestPool *suggestPoolNewBatch(WordBatch *batch, int threads);
+void suggestPoolDelete(SuggestPool *pool);
+int suggestPoolSearch(SuggestPool *pool, const char *word, Suggestion *best, int count);
+
+#endif
@@ -1,9 +1,35 @@
+#define _POSIX_C_SOURCE 200809L
 #include "CuTest.h"
 #include "hashMap.h"
+#include "tokenizer.h"
+#include "blockReader.h"
+#include "concordance.h"
+#include "wordSort.h"
+#include "invertedIndex.h"
+#include "countMinSketch.h"
+#include "spaceSaving.h"
+#include "ngram.h"
+#include "checkpoint.h"
+#include "profile.h"
+#include "corpus.h"
+#include "dictionary.h"
+#include "levenshtein.h"
+#include "bkTree.h"
+#include "deletionIndex.h"
+#include "suggestPool.h"
+#include "wordBatch.h"
+#include "wordBuckets.h"
+#include "dawg.h"
+#include "spellBatch.h"
+#include "writer.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <assert.h>
 #include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 // --- Test Helpers ---
 
@@ -330,6 +356,1441 @@ void testValueUpdate(CuTest *test)
     hashMapDelete(map);
 }
 
+// --- Tokenizer tests ---
+
+/**
+ * Tests that words straddling block boundaries, including words longer than a
+ * whole block, are returned intact when reading a file in tiny blocks.
+ * @param test
+ */
+void testTokenizerBlocks(CuTest *test)
+{
+    printf("\n--- Testing tokenizer block boundaries ---\n");
+    const char *text = "  It's a lengthy-ish sentence,\nwith 42 words;; ";
+    const char *expected[] = {"It's", "a", "lengthy", "ish", "sentence",
+                              "with", "42", "words"};
+    FILE *file = tmpfile();
+    fputs(text, file);
+    rewind(file);
+
+    Tokenizer tokenizer;
+    tokenizerInit(&tokenizer, file, 3);
+    tokenizerKeepCase(&tokenizer);
+    char *word;
+    int length;
+    int count = 0;
+    while (tokenizerNext(&tokenizer, &word, &length))
+    {
+        CuAssertTrue(test, count < 8);
+        CuAssertStrEquals(test, expected[count], word);
+        CuAssertIntEquals(test, (int)strlen(expected[count]), length);
+        count++;
+    }
+    CuAssertIntEquals(test, 8, count);
+    CuAssertIntEquals(test, 0, tokenizerNext(&tokenizer, &word, &length));
+    tokenizerCleanUp(&tokenizer);
+    fclose(file);
+
+    // A word running into the end of the file across a refill.
+    file = tmpfile();
+    fputs("hello wor", file);
+    rewind(file);
+    tokenizerInit(&tokenizer, file, 4);
+    CuAssertIntEquals(test, 1, tokenizerNext(&tokenizer, &word, &length));
+    CuAssertStrEquals(test, "hello", word);
+    CuAssertIntEquals(test, 1, tokenizerNext(&tokenizer, &word, &length));
+    CuAssertStrEquals(test, "wor", word);
+    CuAssertIntEquals(test, 3, length);
+    CuAssertIntEquals(test, 0, tokenizerNext(&tokenizer, &word, &length));
+    tokenizerCleanUp(&tokenizer);
+    fclose(file);
+}
+
+/**
+ * Tests tokenizing a memory range that ends in the middle of a word.
+ * @param test
+ */
+void testTokenizerBuffer(CuTest *test)
+{
+    printf("\n--- Testing tokenizer over a buffer ---\n");
+    char data[] = "..one two";
+    Tokenizer tokenizer;
+    tokenizerInitBuffer(&tokenizer, data, strlen(data) - 1);
+    char *word;
+    int length;
+    CuAssertIntEquals(test, 1, tokenizerNext(&tokenizer, &word, &length));
+    CuAssertStrEquals(test, "one", word);
+    CuAssertIntEquals(test, 1, tokenizerNext(&tokenizer, &word, &length));
+    CuAssertStrEquals(test, "tw", word);
+    CuAssertIntEquals(test, 0, tokenizerNext(&tokenizer, &word, &length));
+    tokenizerCleanUp(&tokenizer);
+}
+
+/**
+ * Tests the vectorized character classification against a byte-at-a-time
+ * reference on random bytes, including bytes above 0x7f.
+ * @param test
+ */
+void testTokenizerRandom(CuTest *test)
+{
+    printf("\n--- Testing tokenizer on random bytes ---\n");
+    const int size = 100000;
+    const char alphabet[] = "aZ09' \n.,-\x80\xff";
+    char *data = malloc(size + 1);
+    char *copy = malloc(size + 1);
+    srand(261);
+    for (int i = 0; i < size; i++)
+    {
+        data[i] = alphabet[rand() % (sizeof(alphabet) - 1)];
+    }
+    memcpy(copy, data, size);
+
+    Tokenizer tokenizer;
+    tokenizerInitBuffer(&tokenizer, data, size);
+    char *word;
+    int length;
+    int i = 0;
+    while (tokenizerNext(&tokenizer, &word, &length))
+    {
+        // Find the same word in the untouched copy one byte at a time.
+        while (!isalnum((unsigned char)copy[i]) && copy[i] != '\'')
+        {
+            i++;
+        }
+        CuAssertIntEquals(test, i, (int)(word - data));
+        int end = i;
+        while (end < size && (isalnum((unsigned char)copy[end]) || copy[end] == '\''))
+        {
+            end++;
+        }
+        CuAssertIntEquals(test, end - i, length);
+        i = end;
+    }
+    tokenizerCleanUp(&tokenizer);
+    free(data);
+    free(copy);
+}
+
+/**
+ * Tests that case folding lowers every letter of every word, in full blocks
+ * and in the partial block at the end, and leaves all other bytes alone.
+ * @param test
+ */
+void testTokenizerFoldCase(CuTest *test)
+{
+    printf("\n--- Testing tokenizer case folding ---\n");
+    const int size = 10000 + 37;
+    const char alphabet[] = "aZzA@[`{09' \n\x80\xc1";
+    char *data = malloc(size + 1);
+    char *copy = malloc(size + 1);
+    srand(38);
+    for (int i = 0; i < size; i++)
+    {
+        data[i] = alphabet[rand() % (sizeof(alphabet) - 1)];
+    }
+    memcpy(copy, data, size);
+
+    Tokenizer tokenizer;
+    tokenizerInitBuffer(&tokenizer, data, size);
+    char *word;
+    int length;
+    int words = 0;
+    while (tokenizerNext(&tokenizer, &word, &length))
+    {
+        for (int i = 0; i < length; i++)
+        {
+            CuAssertIntEquals(test, tolower((unsigned char)copy[word - data + i]),
+                              (unsigned char)word[i]);
+        }
+        words++;
+    }
+    tokenizerCleanUp(&tokenizer);
+    CuAssertTrue(test, words > 0);
+    for (int i = 0; i < size; i++)
+    {
+        // Words are null terminated in place, so separators may now be '\0'.
+        unsigned char c = (unsigned char)copy[i];
+        if (isupper(c))
+        {
+            CuAssertIntEquals(test, tolower(c), (unsigned char)data[i]);
+        }
+        else if (data[i] != '\0')
+        {
+            CuAssertIntEquals(test, c, (unsigned char)data[i]);
+        }
+    }
+
+    // The concordance counts words regardless of case.
+    char text[] = "The the THE tHe then";
+    HashMap *map = hashMapNew(10);
+    tokenizerInitBuffer(&tokenizer, text, strlen(text));
+    concordanceCount(map, &tokenizer);
+    tokenizerCleanUp(&tokenizer);
+    CuAssertIntEquals(test, 4, *hashMapGet(map, "the"));
+    CuAssertIntEquals(test, 2, hashMapSize(map));
+    hashMapDelete(map);
+    free(data);
+    free(copy);
+}
+
+/**
+ * Tests that a block reader returns the file from its current offset in order
+ * whatever the read sizes, and that a pipelined tokenizer finds the same words
+ * as one reading the file itself.
+ * @param test
+ */
+void testBlockReader(CuTest *test)
+{
+    printf("\n--- Testing block reader ---\n");
+    const int size = 3000000;
+    const char alphabet[] = "abc' \n.";
+    char *data = malloc(size);
+    char *read = malloc(size);
+    srand(36);
+    for (int i = 0; i < size; i++)
+    {
+        data[i] = alphabet[rand() % (sizeof(alphabet) - 1)];
+    }
+    FILE *file = tmpfile();
+    fwrite(data, 1, size, file);
+    fflush(file);
+
+    // Small blocks and odd read sizes so reads straddle blocks.
+    lseek(fileno(file), 5, SEEK_SET);
+    BlockReader *reader = blockReaderNew(fileno(file), 4096, 2);
+    size_t total = 0;
+    size_t got;
+    while ((got = blockReaderRead(reader, read + total, total % 2 ? 1000 : 7777)) > 0)
+    {
+        total += got;
+    }
+    CuAssertIntEquals(test, size - 5, (int)total);
+    CuAssertTrue(test, memcmp(read, data + 5, total) == 0);
+    blockReaderDelete(reader);
+
+    // Stopping before the end of the file.
+    lseek(fileno(file), 0, SEEK_SET);
+    reader = blockReaderNew(fileno(file), 4096, 3);
+    CuAssertIntEquals(test, 10, (int)blockReaderRead(reader, read, 10));
+    blockReaderDelete(reader);
+
+    long long words[2] = {0, 0};
+    long long letters[2] = {0, 0};
+    for (int pipelined = 0; pipelined < 2; pipelined++)
+    {
+        lseek(fileno(file), 0, SEEK_SET);
+        Tokenizer tokenizer;
+        tokenizerInit(&tokenizer, file, 1000);
+        if (pipelined)
+        {
+            CuAssertIntEquals(test, 1, tokenizerPipeline(&tokenizer, 2));
+        }
+        char *word;
+        int length;
+        while (tokenizerNext(&tokenizer, &word, &length))
+        {
+            words[pipelined]++;
+            letters[pipelined] += length;
+        }
+        tokenizerCleanUp(&tokenizer);
+    }
+    CuAssertTrue(test, words[0] > 0);
+    CuAssertTrue(test, words[0] == words[1]);
+    CuAssertTrue(test, letters[0] == letters[1]);
+    fclose(file);
+    free(data);
+    free(read);
+
+    // A failed read ends the input and is reported, with or without a reader
+    // thread. Reading a directory fails with EISDIR.
+    for (int pipelined = 0; pipelined < 2; pipelined++)
+    {
+        file = fopen("/tmp", "r");
+        CuAssertPtrNotNull(test, file);
+        Tokenizer tokenizer;
+        tokenizerInit(&tokenizer, file, 1000);
+        if (pipelined)
+        {
+            CuAssertIntEquals(test, 1, tokenizerPipeline(&tokenizer, 2));
+        }
+        char *word;
+        int length;
+        CuAssertIntEquals(test, 0, tokenizerNext(&tokenizer, &word, &length));
+        CuAssertIntEquals(test, EISDIR, tokenizer.error);
+        tokenizerCleanUp(&tokenizer);
+        fclose(file);
+    }
+}
+
+// --- Concordance tests ---
+
+/**
+ * Checks that counting a text with 1, 2, 4 and so on up to maxThreads threads
+ * gives the same counts as counting it sequentially.
+ * @param test
+ * @param text
+ * @param maxThreads
+ * @return Resizes of the local maps with two threads.
+ */
+static int checkConcordanceParallel(CuTest *test, const char *text, int maxThreads)
+{
+    size_t length = strlen(text);
+    char *data = malloc(length + 1);
+
+    memcpy(data, text, length + 1);
+    Tokenizer tokenizer;
+    tokenizerInitBuffer(&tokenizer, data, length);
+    HashMap *expected = hashMapNew(3);
+    concordanceCount(expected, &tokenizer);
+    tokenizerCleanUp(&tokenizer);
+
+    int resizes = 0;
+    for (int threads = 1; threads <= maxThreads; threads *= 2)
+    {
+        memcpy(data, text, length + 1);
+        ConcordanceStats stats;
+        HashMap *map = concordanceCountParallel(data, length, threads, &stats);
+        if (threads == 2)
+        {
+            resizes = stats.resizes;
+        }
+        CuAssertIntEquals(test, hashMapSize(expected), hashMapSize(map));
+        for (int i = 0; i < hashMapCapacity(expected); i++)
+        {
+            for (HashLink *link = expected->table[i]; link != NULL; link = link->next)
+            {
+                int *value = hashMapGet(map, link->key);
+                CuAssertPtrNotNull(test, value);
+                CuAssertIntEquals(test, link->value, *value);
+            }
+        }
+        hashMapDelete(map);
+    }
+    hashMapDelete(expected);
+    free(data);
+    return resizes;
+}
+
+/**
+ * Tests that counting with several threads gives the same counts as counting
+ * sequentially, for thread counts that split words and leave chunks empty,
+ * and for local maps that grew to different capacities before the merge.
+ * @param test
+ */
+void testConcordanceParallel(CuTest *test)
+{
+    printf("\n--- Testing parallel concordance ---\n");
+    checkConcordanceParallel(test, "the cat and the hat sat on the mat, and the cat ate", 16);
+
+    // 20000 distinct words, long enough to hash past the initial capacity,
+    // then as many repeats of one word: with two threads, only the first
+    // local map outgrows its initial capacity.
+    char *text = malloc(20000 * 13 + 20000 * 4 + 1);
+    char *end = text;
+    for (int i = 0; i < 20000; i++)
+    {
+        memcpy(end, "zzzzzzzz", 8);
+        end += 8;
+        for (int n = i, k = 0; k < 4; n /= 26, k++)
+        {
+            *end++ = 'a' + n % 26;
+        }
+        *end++ = ' ';
+    }
+    for (int i = 0; i < 20000; i++)
+    {
+        memcpy(end, "the ", 4);
+        end += 4;
+    }
+    *end = '\0';
+    CuAssertIntEquals(test, 1, checkConcordanceParallel(test, text, 8));
+    free(text);
+}
+
+/**
+ * Tests that the tracked top words always match the most frequent words of a
+ * growing concordance.
+ * @param test
+ */
+void testTopWords(CuTest *test)
+{
+    printf("\n--- Testing top words ---\n");
+    const char *words[] = {"a", "b", "c", "b", "d", "c", "c", "e", "d", "d",
+                           "d", "b", "b", "b", "a"};
+    HashMap *map = hashMapNew(4);
+    TopWords top;
+    topWordsInit(&top, 2);
+    for (int i = 0; i < 15; i++)
+    {
+        topWordsUpdate(&top, words[i], concordanceAdd(map, words[i]));
+    }
+    CuAssertIntEquals(test, 2, top.size);
+    CuAssertStrEquals(test, "b", top.entries[0].word);
+    CuAssertIntEquals(test, 5, top.entries[0].count);
+    CuAssertStrEquals(test, "d", top.entries[1].word);
+    CuAssertIntEquals(test, 4, top.entries[1].count);
+    topWordsCleanUp(&top);
+    hashMapDelete(map);
+}
+
+// --- Sorting tests ---
+
+/**
+ * Tests alphabetical and count sorting on enough random words to use the
+ * parallel path.
+ * @param test
+ */
+void testWordSort(CuTest *test)
+{
+    printf("\n--- Testing word sorting ---\n");
+    HashMap *map = hashMapNew(1000);
+    char word[8];
+    srand(30);
+    for (int i = 0; i < 120000; i++)
+    {
+        int length = 1 + rand() % 6;
+        for (int j = 0; j < length; j++)
+        {
+            word[j] = "abcdeXYZ'09"[rand() % 11];
+        }
+        word[length] = '\0';
+        concordanceAdd(map, word);
+    }
+
+    int size;
+    WordCount *words = wordCountsFromMap(map, &size);
+    CuAssertIntEquals(test, hashMapSize(map), size);
+
+    wordSortAlpha(words, size, 4);
+    for (int i = 1; i < size; i++)
+    {
+        CuAssertTrue(test, strcmp(words[i - 1].word, words[i].word) < 0);
+    }
+
+    wordSortCount(words, size, 4);
+    for (int i = 1; i < size; i++)
+    {
+        CuAssertTrue(test, words[i - 1].count > words[i].count ||
+                               (words[i - 1].count == words[i].count &&
+                                strcmp(words[i - 1].word, words[i].word) < 0));
+    }
+    free(words);
+    hashMapDelete(map);
+}
+
+// --- Inverted index tests ---
+
+/**
+ * Tests word and phrase lookups, with lines and columns tracked across tiny
+ * tokenizer blocks.
+ * @param test
+ */
+void testInvertedIndex(CuTest *test)
+{
+    printf("\n--- Testing inverted index ---\n");
+    FILE *file = tmpfile();
+    fputs("to be or\nnot to be\n\n  that is to be", file);
+    rewind(file);
+    Tokenizer tokenizer;
+    tokenizerInit(&tokenizer, file, 4);
+    InvertedIndex *index = invertedIndexNew();
+    CuAssertIntEquals(test, 10, (int)invertedIndexBuild(index, &tokenizer));
+    tokenizerCleanUp(&tokenizer);
+    fclose(file);
+
+    Posting *postings;
+    CuAssertIntEquals(test, 3, invertedIndexLookup(index, "be", &postings));
+    CuAssertIntEquals(test, 1, (int)postings[0].line);
+    CuAssertIntEquals(test, 3, (int)postings[0].column);
+    CuAssertIntEquals(test, 2, (int)postings[1].line);
+    CuAssertIntEquals(test, 7, (int)postings[1].column);
+    CuAssertIntEquals(test, 4, (int)postings[2].line);
+    CuAssertIntEquals(test, 13, (int)postings[2].column);
+    CuAssertIntEquals(test, 9, (int)postings[2].position);
+    free(postings);
+
+    const char *phrase[] = {"to", "be"};
+    CuAssertIntEquals(test, 3, invertedIndexPhrase(index, phrase, 2, &postings));
+    CuAssertIntEquals(test, 2, (int)postings[1].line);
+    CuAssertIntEquals(test, 4, (int)postings[1].column);
+    free(postings);
+
+    const char *missing[] = {"be", "to", "be"};
+    CuAssertIntEquals(test, 0, invertedIndexPhrase(index, missing, 3, &postings));
+    CuAssertPtrEquals(test, NULL, postings);
+    CuAssertIntEquals(test, 0, invertedIndexLookup(index, "question", &postings));
+    invertedIndexDelete(index);
+}
+
+// --- Count-Min Sketch tests ---
+
+/**
+ * Tests that estimates never fall below the true counts and stay within the
+ * error bound, using a sketch much smaller than the number of keys.
+ * @param test
+ */
+void testCountMinSketch(CuTest *test)
+{
+    printf("\n--- Testing Count-Min Sketch ---\n");
+    CountMinSketch *sketch = countMinSketchNew(0.01, 0.01);
+    HashMap *truth = hashMapNew(100);
+    char key[16];
+    srand(32);
+    for (int i = 0; i < 20000; i++)
+    {
+        // Skewed keys: small numbers are much more frequent.
+        sprintf(key, "k%d", rand() % (1 + rand() % 2000));
+        countMinSketchAdd(sketch, key);
+        concordanceAdd(truth, key);
+    }
+    CuAssertIntEquals(test, 20000, (int)sketch->total);
+
+    int withinBound = 0;
+    for (int i = 0; i < hashMapCapacity(truth); i++)
+    {
+        for (HashLink *link = truth->table[i]; link != NULL; link = link->next)
+        {
+            unsigned int estimate = countMinSketchEstimate(sketch, link->key);
+            CuAssertTrue(test, estimate >= (unsigned int)link->value);
+            withinBound += estimate - link->value <= 0.01 * 20000;
+        }
+    }
+    CuAssertTrue(test, withinBound >= 0.99 * hashMapSize(truth));
+    CuAssertTrue(test, countMinSketchEstimate(sketch, "absent") <= 0.01 * 20000);
+    hashMapDelete(truth);
+    countMinSketchDelete(sketch);
+}
+
+// --- Space-Saving tests ---
+
+/**
+ * Tests the Space-Saving guarantees on a skewed stream: every counter brackets
+ * its word's true count, and every word occurring more than total / capacity
+ * times is monitored.
+ * @param test
+ */
+void testSpaceSaving(CuTest *test)
+{
+    printf("\n--- Testing Space-Saving ---\n");
+    const int capacity = 50;
+    const int total = 20000;
+    SpaceSaving *summary = spaceSavingNew(capacity);
+    HashMap *truth = hashMapNew(100);
+    char key[16];
+    srand(33);
+    for (int i = 0; i < total; i++)
+    {
+        // Half skewed heavy hitters, half a long uniform tail.
+        sprintf(key, "k%d", rand() % 2 ? rand() % (1 + rand() % 10) : rand() % 10000);
+        spaceSavingAdd(summary, key);
+        concordanceAdd(truth, key);
+    }
+    CuAssertIntEquals(test, capacity, summary->size);
+
+    for (int i = 0; i < summary->size; i++)
+    {
+        SpaceSavingCounter *counter = &summary->counters[i];
+        int *count = hashMapGet(truth, counter->word);
+        int trueCount = count != NULL ? *count : 0;
+        CuAssertTrue(test, counter->count - counter->error <= trueCount);
+        CuAssertTrue(test, trueCount <= counter->count);
+    }
+    for (int i = 0; i < hashMapCapacity(truth); i++)
+    {
+        for (HashLink *link = truth->table[i]; link != NULL; link = link->next)
+        {
+            if (link->value > total / capacity)
+            {
+                CuAssertPtrNotNull(test, hashMapGet(summary->words, link->key));
+            }
+        }
+    }
+
+    SpaceSavingCounter top[3];
+    CuAssertIntEquals(test, 3, spaceSavingTop(summary, top, 3));
+    CuAssertStrEquals(test, "k0", top[0].word);
+    CuAssertTrue(test, top[0].count >= top[1].count && top[1].count >= top[2].count);
+    hashMapDelete(truth);
+    spaceSavingDelete(summary);
+}
+
+// --- N-gram tests ---
+
+/**
+ * Tests trigram counts against counting the joined words in a hash map, on a
+ * small vocabulary so n-grams repeat and the table resizes.
+ * @param test
+ */
+void testNgramCounter(CuTest *test)
+{
+    printf("\n--- Testing n-gram counter ---\n");
+    const char *vocabulary[] = {"a", "b", "c", "dd", "e"};
+    const int numWords = 5000;
+    const char *words[5000];
+    srand(34);
+    for (int i = 0; i < numWords; i++)
+    {
+        words[i] = vocabulary[rand() % 5];
+    }
+
+    NgramCounter *counter = ngramCounterNew(3);
+    HashMap *expected = hashMapNew(100);
+    char joined[16];
+    for (int i = 0; i < numWords; i++)
+    {
+        ngramCounterAdd(counter, words[i]);
+        if (i >= 2)
+        {
+            sprintf(joined, "%s %s %s", words[i - 2], words[i - 1], words[i]);
+            concordanceAdd(expected, joined);
+        }
+    }
+    CuAssertIntEquals(test, numWords - 2, (int)counter->total);
+    CuAssertIntEquals(test, hashMapSize(expected), counter->size);
+
+    for (int slot = 0; slot < counter->capacity; slot++)
+    {
+        if (counter->counts[slot] == 0)
+        {
+            continue;
+        }
+        const int *tuple = counter->tuples + slot * 3;
+        sprintf(joined, "%s %s %s", counter->strings + counter->offsets[tuple[0]],
+                counter->strings + counter->offsets[tuple[1]],
+                counter->strings + counter->offsets[tuple[2]]);
+        int *count = hashMapGet(expected, joined);
+        CuAssertPtrNotNull(test, count);
+        CuAssertIntEquals(test, *count, counter->counts[slot]);
+    }
+    hashMapDelete(expected);
+    ngramCounterDelete(counter);
+}
+
+// --- Checkpoint tests ---
+
+/**
+ * Writes text to the file, appending to it or replacing what it holds.
+ * @param fileName
+ * @param text
+ * @param mode "a" to append or "w" to replace.
+ */
+static void writeTestFile(const char *fileName, const char *text, const char *mode)
+{
+    FILE *file = fopen(fileName, mode);
+    fputs(text, file);
+    fclose(file);
+}
+
+/**
+ * Tests that a checkpoint survives a save and load, that resuming after an
+ * append counts a word split across the append point once, that truncated or
+ * rewritten inputs and a truncated checkpoint are rejected, that a failed
+ * save leaves the previous checkpoint in place, and that a capitalized tail
+ * is taken back out on resume.
+ * @param test
+ */
+void testCheckpoint(CuTest *test)
+{
+    printf("\n--- Testing checkpoint ---\n");
+    char input[] = "/tmp/testCheckpointInputXXXXXX";
+    int fd = mkstemp(input);
+    CuAssertTrue(test, fd >= 0);
+    close(fd);
+    char path[] = "/tmp/testCheckpointXXXXXX";
+    fd = mkstemp(path);
+    CuAssertTrue(test, fd >= 0);
+    close(fd);
+    remove(path);
+
+    writeTestFile(input, "the cat sat on the ma", "w");
+    Checkpoint *checkpoint = checkpointLoad(path);
+    CuAssertPtrNotNull(test, checkpoint);
+    CuAssertIntEquals(test, 0, checkpoint->numFiles);
+    CuAssertIntEquals(test, 6, (int)checkpointCountFile(checkpoint, input));
+    CuAssertIntEquals(test, 5, hashMapSize(checkpoint->map));
+    CuAssertStrEquals(test, "ma", checkpoint->files[0].tail);
+    CuAssertIntEquals(test, 19, (int)checkpoint->files[0].offset);
+    CuAssertIntEquals(test, 1, checkpointSave(checkpoint, path));
+
+    Checkpoint *loaded = checkpointLoad(path);
+    CuAssertPtrNotNull(test, loaded);
+    CuAssertIntEquals(test, 1, loaded->numFiles);
+    CuAssertStrEquals(test, input, loaded->files[0].name);
+    CuAssertIntEquals(test, 19, (int)loaded->files[0].offset);
+    CuAssertStrEquals(test, "ma", loaded->files[0].tail);
+    CuAssertIntEquals(test, hashMapSize(checkpoint->map), hashMapSize(loaded->map));
+    for (int i = 0; i < hashMapCapacity(checkpoint->map); i++)
+    {
+        for (HashLink *link = checkpoint->map->table[i]; link != NULL; link = link->next)
+        {
+            int *count = hashMapGet(loaded->map, link->key);
+            CuAssertPtrNotNull(test, count);
+            CuAssertIntEquals(test, link->value, *count);
+        }
+    }
+    checkpointDelete(checkpoint);
+
+    // The tail continues across the append point and is counted once in full.
+    writeTestFile(input, "t and the hat", "a");
+    CuAssertIntEquals(test, 4, (int)checkpointCountFile(loaded, input));
+    CuAssertTrue(test, hashMapGet(loaded->map, "ma") == NULL);
+    CuAssertIntEquals(test, 1, *hashMapGet(loaded->map, "mat"));
+    CuAssertIntEquals(test, 3, *hashMapGet(loaded->map, "the"));
+    CuAssertStrEquals(test, "hat", loaded->files[0].tail);
+    CuAssertIntEquals(test, 1, checkpointSave(loaded, path));
+
+    // A save that cannot write its temporary file keeps the old checkpoint.
+    size_t pathLength = strlen(path);
+    char temporary[sizeof(path) + 4];
+    memcpy(temporary, path, pathLength);
+    strcpy(temporary + pathLength, ".tmp");
+    CuAssertIntEquals(test, 0, mkdir(temporary, 0700));
+    hashMapPut(loaded->map, "unsaved", 1);
+    CuAssertIntEquals(test, 0, checkpointSave(loaded, path));
+    rmdir(temporary);
+    checkpointDelete(loaded);
+    loaded = checkpointLoad(path);
+    CuAssertPtrNotNull(test, loaded);
+    CuAssertTrue(test, hashMapGet(loaded->map, "unsaved") == NULL);
+    CuAssertIntEquals(test, 3, *hashMapGet(loaded->map, "the"));
+
+    // Rewritten to the same length with another tail, then cut short.
+    writeTestFile(input, "the cat sat on the mat and the cat", "w");
+    CuAssertIntEquals(test, -1, (int)checkpointCountFile(loaded, input));
+    writeTestFile(input, "the cat", "w");
+    CuAssertIntEquals(test, -1, (int)checkpointCountFile(loaded, input));
+
+    // A read error fails the file instead of ending it early.
+    CuAssertIntEquals(test, -1, (int)checkpointCountFile(loaded, "/tmp"));
+    CuAssertIntEquals(test, 3, *hashMapGet(loaded->map, "the"));
+    checkpointDelete(loaded);
+
+    // A capitalized tail is saved folded, as it was counted.
+    writeTestFile(input, "hello World", "w");
+    loaded = checkpointNew();
+    CuAssertIntEquals(test, 2, (int)checkpointCountFile(loaded, input));
+    CuAssertStrEquals(test, "world", loaded->files[0].tail);
+    writeTestFile(input, " again", "a");
+    CuAssertIntEquals(test, 2, (int)checkpointCountFile(loaded, input));
+    CuAssertIntEquals(test, 3, hashMapSize(loaded->map));
+    CuAssertIntEquals(test, 1, *hashMapGet(loaded->map, "world"));
+    CuAssertIntEquals(test, 1, *hashMapGet(loaded->map, "again"));
+    checkpointDelete(loaded);
+
+    // A checkpoint cut short is not loaded.
+    FILE *file = fopen(path, "rb");
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fclose(file);
+    CuAssertIntEquals(test, 0, truncate(path, size - 1));
+    CuAssertTrue(test, checkpointLoad(path) == NULL);
+    remove(path);
+    remove(input);
+}
+
+// --- Profile tests ---
+
+/**
+ * Tests that phases nest under the phase they are entered in, that entering a
+ * phase again adds to its totals, and that same-named phases under different
+ * parents are kept apart.
+ * @param test
+ */
+void testProfile(CuTest *test)
+{
+    printf("\n--- Testing profile ---\n");
+    Profile profile;
+    profileInit(&profile, 0);
+    profileBegin(&profile, "total");
+    for (int i = 0; i < 3; i++)
+    {
+        profileBegin(&profile, "count");
+        volatile long long sum = 0;
+        for (int j = 0; j < 100000; j++)
+        {
+            sum += j;
+        }
+        profileEnd(&profile);
+    }
+    profileBegin(&profile, "print");
+    profileBegin(&profile, "count");
+    profileEnd(&profile);
+    profileEnd(&profile);
+    profileEnd(&profile);
+
+    CuAssertIntEquals(test, 4, profile.numPhases);
+    CuAssertIntEquals(test, 0, profile.depth);
+    CuAssertStrEquals(test, "count", profile.phases[1].name);
+    CuAssertIntEquals(test, 3, profile.phases[1].calls);
+    CuAssertIntEquals(test, 0, profile.phases[1].parent);
+    CuAssertIntEquals(test, 1, profile.phases[1].depth);
+    CuAssertIntEquals(test, 2, profile.phases[3].parent);
+    CuAssertIntEquals(test, 2, profile.phases[3].depth);
+    CuAssertTrue(test, profile.phases[1].wall > 0);
+    CuAssertTrue(test, profile.phases[0].wall >= profile.phases[1].wall);
+    CuAssertTrue(test, profileWall(&profile, "count") == profile.phases[1].wall);
+    CuAssertTrue(test, profileWall(&profile, "absent") == 0);
+    profileCleanUp(&profile);
+}
+
+// --- Corpus generator tests ---
+
+/**
+ * Writes the corpus of the given size into a string.
+ * @param corpus
+ * @param bytes
+ * @return The text, to be freed by the caller.
+ */
+char *corpusText(Corpus *corpus, unsigned long long bytes)
+{
+    FILE *file = tmpfile();
+    Writer writer;
+    writerInit(&writer, file, 64);
+    corpusWrite(corpus, &writer, bytes);
+    writerCleanUp(&writer);
+    long length = ftell(file);
+    char *text = malloc(length + 1);
+    rewind(file);
+    text[fread(text, 1, length, file)] = '\0';
+    fclose(file);
+    return text;
+}
+
+/**
+ * Tests that the generator is deterministic, uses only the requested number
+ * of dictionary words, and makes the top ranked word the most frequent.
+ * @param test
+ */
+void testCorpus(CuTest *test)
+{
+    printf("\n--- Testing corpus generator ---\n");
+    char dictionary[] = "/tmp/testDictionaryXXXXXX";
+    int fd = mkstemp(dictionary);
+    CuAssertTrue(test, fd >= 0);
+    FILE *file = fdopen(fd, "w");
+    for (int i = 0; i < 200; i++)
+    {
+        fprintf(file, "w%c%c\n", 'a' + i / 26, 'a' + i % 26);
+    }
+    fclose(file);
+
+    Corpus *first = corpusNew(dictionary, 50, 1.0, 39);
+    Corpus *second = corpusNew(dictionary, 50, 1.0, 39);
+    CuAssertPtrNotNull(test, first);
+    CuAssertIntEquals(test, 50, first->numWords);
+    char *text = corpusText(first, 100000);
+    char *again = corpusText(second, 100000);
+    CuAssertTrue(test, strlen(text) >= 100000);
+    CuAssertStrEquals(test, text, again);
+
+    HashMap *map = hashMapNew(10);
+    Tokenizer tokenizer;
+    tokenizerInitBuffer(&tokenizer, text, strlen(text));
+    concordanceCount(map, &tokenizer);
+    tokenizerCleanUp(&tokenizer);
+    CuAssertTrue(test, hashMapSize(map) <= 50);
+    int top = *hashMapGet(map, first->words[0]);
+    for (int i = 1; i < first->numWords; i++)
+    {
+        int *count = hashMapGet(map, first->words[i]);
+        CuAssertTrue(test, count == NULL || *count < top);
+    }
+    hashMapDelete(map);
+
+    free(text);
+    free(again);
+    corpusDelete(first);
+    corpusDelete(second);
+    remove(dictionary);
+    CuAssertPtrEquals(test, NULL, corpusNew(dictionary, 0, 1.0, 1));
+}
+
+// --- Dictionary tests ---
+
+/**
+ * Tests that loading a dictionary with any number of threads keeps each word
+ * once, in file order, and finds exactly the words of the file.
+ * @param test
+ */
+void testDictionary(CuTest *test)
+{
+    printf("\n--- Testing dictionary ---\n");
+    char fileName[] = "/tmp/testDictionaryXXXXXX";
+    int fd = mkstemp(fileName);
+    CuAssertTrue(test, fd >= 0);
+    FILE *file = fdopen(fd, "w");
+    for (int i = 0; i < 1000; i++)
+    {
+        fprintf(file, "%c%d\n", 'a' + i % 26, i);
+    }
+    // Repeats, in a different case as well, and a last line without newline.
+    fprintf(file, "a0\nB1\nzz");
+    fclose(file);
+
+    for (int threads = 1; threads <= 7; threads += 3)
+    {
+        Dictionary *dictionary = dictionaryLoad(fileName, threads);
+        CuAssertPtrNotNull(test, dictionary);
+        CuAssertIntEquals(test, 1001, dictionary->numWords);
+        char word[16];
+        for (int i = 0; i < 1000; i++)
+        {
+            sprintf(word, "%c%d", 'a' + i % 26, i);
+            CuAssertStrEquals(test, word, dictionary->words[i]);
+            CuAssertIntEquals(test, i, dictionaryFind(dictionary, word));
+        }
+        CuAssertIntEquals(test, 1000, dictionaryFind(dictionary, "zz"));
+        CuAssertIntEquals(test, -1, dictionaryFind(dictionary, "a1"));
+        CuAssertIntEquals(test, -1, dictionaryFind(dictionary, "z"));
+        CuAssertIntEquals(test, -1, dictionaryFind(dictionary, ""));
+        // More words than one batch, found and not.
+        const char *batch[40];
+        int found[40];
+        char storage[40][16];
+        for (int i = 0; i < 40; i++)
+        {
+            sprintf(storage[i], "%c%d", 'a' + (i * 7) % 26, i * 7 + i % 2);
+            batch[i] = storage[i];
+        }
+        dictionaryFindBatch(dictionary, batch, 40, found);
+        for (int i = 0; i < 40; i++)
+        {
+            CuAssertIntEquals(test, dictionaryFind(dictionary, batch[i]), found[i]);
+        }
+        dictionaryDelete(dictionary);
+    }
+    remove(fileName);
+    CuAssertPtrEquals(test, NULL, dictionaryLoad(fileName, 1));
+}
+
+void testLevenshtein(CuTest *test)
+{
+    printf("\n--- Testing Levenshtein distance ---\n");
+    CuAssertIntEquals(test, 3, levenshteinDistance("kitten", "sitting"));
+    CuAssertIntEquals(test, 3, levenshteinDistance("sitting", "kitten"));
+    CuAssertIntEquals(test, 0, levenshteinDistance("same", "same"));
+    CuAssertIntEquals(test, 5, levenshteinDistance("", "abcde"));
+
+    // Random words over a few letters, so that they share many characters,
+    // across the one and several machine word versions.
+    srand(7);
+    char a[300];
+    char b[300];
+    for (int round = 0; round < 400; round++)
+    {
+        int lengthA = rand() % (round < 200 ? 70 : 300);
+        int lengthB = rand() % (round < 200 ? 70 : 300);
+        int letters = 2 + rand() % 4;
+        for (int i = 0; i < lengthA; i++)
+        {
+            a[i] = (char)('a' + rand() % letters);
+        }
+        for (int i = 0; i < lengthB; i++)
+        {
+            b[i] = (char)('a' + rand() % letters);
+        }
+        a[lengthA] = '\0';
+        b[lengthB] = '\0';
+        int distance = levenshteinDistanceDp(a, b);
+        CuAssertIntEquals(test, distance, levenshteinDistance(a, b));
+        // Bounded, at, below and above the distance.
+        for (int k = 0; k <= distance + 2; k += 1 + distance / 8)
+        {
+            CuAssertIntEquals(test, distance <= k ? distance : k + 1, levenshteinBounded(a, b, k));
+        }
+    }
+    CuAssertIntEquals(test, 3, levenshteinBounded("kitten", "sitting", 3));
+    CuAssertIntEquals(test, 3, levenshteinBounded("kitten", "sitting", 2));
+    CuAssertIntEquals(test, 2, levenshteinBounded("a", "abcdef", 1));
+    CuAssertIntEquals(test, 0, levenshteinBounded("", "", 0));
+    memset(a, 'x', 130);
+    a[130] = '\0';
+    CuAssertIntEquals(test, 130, levenshteinDistance(a, ""));
+    CuAssertIntEquals(test, 129, levenshteinDistance(a, "x"));
+    CuAssertIntEquals(test, 0, levenshteinDistance(a, a));
+}
+
+void testSuggest(CuTest *test)
+{
+    printf("\n--- Testing suggestions ---\n");
+    // The heap keeps the best, breaking ties by dictionary order whatever
+    // the order the suggestions come in.
+    Suggestion items[3];
+    SuggestionHeap heap;
+    suggestionHeapInit(&heap, items, 3);
+    CuAssertIntEquals(test, 9, suggestionHeapLimit(&heap, 0, 9));
+    int offers[][2] = {{7, 2}, {3, 2}, {9, 1}, {5, 2}, {1, 2}, {8, 3}, {4, 1}};
+    for (int i = 0; i < 7; i++)
+    {
+        suggestionHeapOffer(&heap, offers[i][0], offers[i][1]);
+    }
+    CuAssertIntEquals(test, 0, suggestionHeapOffer(&heap, 2, 2));
+    CuAssertIntEquals(test, 1, suggestionHeapLimit(&heap, 2, 9));
+    CuAssertIntEquals(test, 2, suggestionHeapLimit(&heap, 0, 9));
+    CuAssertIntEquals(test, 3, suggestionHeapSort(&heap));
+    CuAssertIntEquals(test, 4, items[0].word);
+    CuAssertIntEquals(test, 9, items[1].word);
+    CuAssertIntEquals(test, 1, items[2].word);
+    CuAssertIntEquals(test, 2, items[2].distance);
+
+    // The scan finds what sorting every word by distance does.
+    const char *words[] = {"book", "books", "cake", "boo", "boon", "cook", "cape", "cart",
+                           "brook", "back", "bake", "look", "hook", "shook", "took"};
+    int numWords = sizeof(words) / sizeof(words[0]);
+    const char *queries[] = {"bok", "cak", "xyzzy", "book", ""};
+    Suggestion all[15];
+    Suggestion best[20];
+    for (int q = 0; q < 5; q++)
+    {
+        for (int i = 0; i < numWords; i++)
+        {
+            all[i].word = i;
+            all[i].distance = levenshteinDistance(queries[q], words[i]);
+        }
+        qsort(all, numWords, sizeof(Suggestion), suggestionCompare);
+        for (int count = 0; count <= 20; count += 4)
+        {
+            int found = suggestScan(words, numWords, queries[q], best, count);
+            CuAssertIntEquals(test, count < numWords ? count : numWords, found);
+            for (int i = 0; i < found; i++)
+            {
+                CuAssertIntEquals(test, all[i].word, best[i].word);
+                CuAssertIntEquals(test, all[i].distance, best[i].distance);
+            }
+        }
+    }
+    CuAssertIntEquals(test, 0, suggestScan(NULL, 0, "word", best, 5));
+}
+
+void testSuggestPool(CuTest *test)
+{
+    printf("\n--- Testing suggestion pool ---\n");
+    // Many words at the same distances, so that ties cross the ranges.
+    char storage[600][8];
+    const char *words[600];
+    srand(11);
+    for (int i = 0; i < 600; i++)
+    {
+        int length = 2 + rand() % 5;
+        for (int j = 0; j < length; j++)
+        {
+            storage[i][j] = (char)('a' + rand() % 3);
+        }
+        storage[i][length] = '\0';
+        words[i] = storage[i];
+    }
+    const char *queries[] = {"abc", "cccccc", "b", "", "abcabcabc"};
+    Suggestion expected[SUGGEST_POOL_MAX_COUNT];
+    Suggestion best[SUGGEST_POOL_MAX_COUNT];
+    for (int threads = 1; threads <= 7; threads += 3)
+    {
+        SuggestPool *pool = suggestPoolNew(words, 600, threads);
+        for (int q = 0; q < 5; q++)
+        {
+            for (int count = 1; count <= SUGGEST_POOL_MAX_COUNT; count *= 4)
+            {
+                int found = suggestScan(words, 600, queries[q], expected, count);
+                CuAssertIntEquals(test, found, suggestPoolSearch(pool, queries[q], best, count));
+                CuAssertTrue(test, memcmp(expected, best, sizeof(Suggestion) * found) == 0);
+            }
+        }
+        suggestPoolDelete(pool);
+    }
+
+    // More threads than words.
+    SuggestPool *pool = suggestPoolNew(words, 2, 5);
+    CuAssertIntEquals(test, 2, suggestPoolSearch(pool, "abc", best, 5));
+    suggestPoolDelete(pool);
+}
+
+void testWordBatch(CuTest *test)
+{
+    printf("\n--- Testing word batch ---\n");
+    // Lengths with partial blocks, and words longer than the queries.
+    char storage[500][40];
+    const char *words[500];
+    srand(13);
+    for (int i = 0; i < 500; i++)
+    {
+        int length = rand() % 39;
+        for (int j = 0; j < length; j++)
+        {
+            storage[i][j] = (char)('a' + rand() % 3);
+        }
+        storage[i][length] = '\0';
+        words[i] = storage[i];
+    }
+    const char *queries[] = {"abc", "cccccc", "b", "", "abcabcabcabcabcabcabcabcabcabcabcabcabcabcab"};
+    int distances[500];
+    Suggestion expected[SUGGEST_POOL_MAX_COUNT];
+    Suggestion best[SUGGEST_POOL_MAX_COUNT];
+    WordBatch *batch = wordBatchNew(words, 500);
+    // A word too long for the 16-bit lanes of the AVX2 kernel.
+    char *longWord = malloc(40001);
+    memset(longWord, 'a', 40000);
+    longWord[40000] = '\0';
+    int found = suggestScan(words, 500, longWord, expected, 5);
+    CuAssertIntEquals(test, found, wordBatchSuggest(batch, longWord, best, 5));
+    CuAssertTrue(test, memcmp(expected, best, sizeof(Suggestion) * found) == 0);
+    CuAssertTrue(test, best[0].distance >= 40000 - 38);
+    free(longWord);
+
+    for (int scalar = 0; scalar < 2; scalar++)
+    {
+        if (scalar)
+        {
+            wordBatchUseScalar(batch);
+        }
+        for (int q = 0; q < 5; q++)
+        {
+            wordBatchDistances(batch, queries[q], 100, distances);
+            for (int i = 0; i < 500; i++)
+            {
+                CuAssertIntEquals(test, levenshteinDistance(queries[q], words[i]), distances[i]);
+            }
+            wordBatchDistances(batch, queries[q], 2, distances);
+            for (int i = 0; i < 500; i++)
+            {
+                CuAssertIntEquals(test, levenshteinBounded(queries[q], words[i], 2), distances[i]);
+            }
+            for (int count = 1; count <= SUGGEST_POOL_MAX_COUNT; count *= 4)
+            {
+                int found = suggestScan(words, 500, queries[q], expected, count);
+                CuAssertIntEquals(test, found, wordBatchSuggest(batch, queries[q], best, count));
+                CuAssertTrue(test, memcmp(expected, best, sizeof(Suggestion) * found) == 0);
+            }
+        }
+    }
+
+    // Blocks shared between threads.
+    SuggestPool *pool = suggestPoolNewBatch(batch, 3);
+    for (int q = 0; q < 5; q++)
+    {
+        int found = suggestScan(words, 500, queries[q], expected, 5);
+        CuAssertIntEquals(test, found, suggestPoolSearch(pool, queries[q], best, 5));
+        CuAssertTrue(test, memcmp(expected, best, sizeof(Suggestion) * found) == 0);
+    }
+    suggestPoolDelete(pool);
+    wordBatchDelete(batch);
+}
+
+void testWordBuckets(CuTest *test)
+{
+    printf("\n--- Testing word buckets ---\n");
+    const char *words[] = {"cat", "", "cart", "at", "dog", "cast", "c", "scatter", "cot", "a"};
+    WordBuckets *buckets = wordBucketsNew(words, 10);
+    CuAssertIntEquals(test, 7, buckets->maxLength);
+    // Packed without terminators, in dictionary order within a length.
+    CuAssertIntEquals(test, 0, memcmp(buckets->letters + buckets->offset[3], "catdogcot", 9));
+    CuAssertIntEquals(test, 0, memcmp(buckets->letters + buckets->offset[4], "cartcast", 8));
+    CuAssertIntEquals(test, 4, buckets->ids[buckets->first[3] + 1]);
+
+    // Only the lengths within the distance are compared with.
+    Suggestion *matches;
+    long long visited = 0;
+    int found = wordBucketsWithin(buckets, "cat", 1, &matches, &visited);
+    CuAssertIntEquals(test, 6, visited);
+    CuAssertIntEquals(test, 5, found);
+    for (int i = 0; i < found; i++)
+    {
+        CuAssertIntEquals(test, levenshteinDistance("cat", words[matches[i].word]),
+                          matches[i].distance);
+    }
+    free(matches);
+    CuAssertIntEquals(test, 0, wordBucketsWithin(buckets, "catastrophe", 2, &matches, NULL));
+    free(matches);
+
+    Suggestion expected[5];
+    Suggestion best[5];
+    const char *queries[] = {"cat", "", "scattered", "xyz"};
+    for (int q = 0; q < 4; q++)
+    {
+        for (int count = 0; count <= 5; count++)
+        {
+            int expectedFound = suggestScan(words, 10, queries[q], expected, count);
+            CuAssertIntEquals(test, expectedFound,
+                              wordBucketsSuggest(buckets, queries[q], best, count));
+            CuAssertTrue(test, memcmp(expected, best, sizeof(Suggestion) * expectedFound) == 0);
+        }
+    }
+    wordBucketsDelete(buckets);
+}
+
+void testDawg(CuTest *test)
+{
+    printf("\n--- Testing DAWG ---\n");
+    // Out of order, with shared prefixes and suffixes and the empty word.
+    const char *words[] = {"rats", "cat", "cats", "", "bats", "bat", "rat", "car", "ca"};
+    Dawg *dawg = dawgNew(words, 9);
+    for (int i = 0; i < 9; i++)
+    {
+        CuAssertIntEquals(test, i, dawgFind(dawg, words[i]));
+    }
+    CuAssertIntEquals(test, -1, dawgFind(dawg, "c"));
+    CuAssertIntEquals(test, -1, dawgFind(dawg, "catsup"));
+    CuAssertIntEquals(test, -1, dawgFind(dawg, "dog"));
+    // The trie has 14 nodes, but "b" and "r" lead to the same words, as do
+    // "bat" and "cat", and all the leaves are alike.
+    CuAssertIntEquals(test, 7, dawg->numNodes);
+    CuAssertIntEquals(test, 9, dawg->count[dawg->root]);
+    dawgDelete(dawg);
+
+    // Random words over a small alphabet share many prefixes and suffixes.
+    char storage[600][10];
+    const char *random[600];
+    srand(17);
+    int numWords = 0;
+    while (numWords < 600)
+    {
+        int length = rand() % 9;
+        for (int j = 0; j < length; j++)
+        {
+            storage[numWords][j] = (char)('a' + rand() % 3);
+        }
+        storage[numWords][length] = '\0';
+        int seen = 0;
+        for (int i = 0; i < numWords && !seen; i++)
+        {
+            seen = strcmp(storage[i], storage[numWords]) == 0;
+        }
+        if (!seen)
+        {
+            random[numWords] = storage[numWords];
+            numWords++;
+        }
+    }
+    dawg = dawgNew(random, numWords);
+    for (int i = 0; i < numWords; i++)
+    {
+        CuAssertIntEquals(test, i, dawgFind(dawg, random[i]));
+    }
+    const char *queries[] = {"abc", "cccccc", "b", "", "abcabcabcabc"};
+    Suggestion expected[16];
+    Suggestion best[16];
+    for (int q = 0; q < 5; q++)
+    {
+        for (int k = 0; k <= 3; k++)
+        {
+            Suggestion *matches;
+            int found = dawgWithin(dawg, queries[q], k, &matches, NULL);
+            int within = 0;
+            for (int i = 0; i < numWords; i++)
+            {
+                within += levenshteinDistance(queries[q], random[i]) <= k;
+            }
+            CuAssertIntEquals(test, within, found);
+            for (int i = 0; i < found; i++)
+            {
+                CuAssertIntEquals(test, levenshteinDistance(queries[q], random[matches[i].word]),
+                                  matches[i].distance);
+            }
+            free(matches);
+        }
+        for (int count = 0; count <= 16; count += 4)
+        {
+            int found = suggestScan(random, numWords, queries[q], expected, count);
+            CuAssertIntEquals(test, found, dawgSuggest(dawg, queries[q], best, count));
+            CuAssertTrue(test, memcmp(expected, best, sizeof(Suggestion) * found) == 0);
+        }
+    }
+
+    // A word far longer than any dictionary word.
+    char *longWord = malloc(3001);
+    for (int i = 0; i < 3000; i++)
+    {
+        longWord[i] = (char)('a' + i % 3);
+    }
+    longWord[3000] = '\0';
+    int found = suggestScan(random, numWords, longWord, expected, 5);
+    CuAssertIntEquals(test, found, dawgSuggest(dawg, longWord, best, 5));
+    CuAssertTrue(test, memcmp(expected, best, sizeof(Suggestion) * found) == 0);
+    free(longWord);
+    dawgDelete(dawg);
+}
+
+/**
+ * Suggests with suggestScan over the dictionary's words, for testSpellBatch.
+ */
+static int suggestForTest(void *engine, const char *word, Suggestion *best, int count)
+{
+    Dictionary *dictionary = engine;
+    return suggestScan((const char *const *)dictionary->words, dictionary->numWords, word, best,
+                       count);
+}
+
+void testSpellBatch(CuTest *test)
+{
+    printf("\n--- Testing batch spell check ---\n");
+    char fileName[] = "/tmp/testSpellBatchXXXXXX";
+    int fd = mkstemp(fileName);
+    CuAssertTrue(test, fd >= 0);
+    FILE *file = fdopen(fd, "w");
+    fprintf(file, "the\ncat\nsat\non\nmat\ndon't\n");
+    fclose(file);
+    Dictionary *dictionary = dictionaryLoad(fileName, 1);
+    remove(fileName);
+    CuAssertPtrNotNull(test, dictionary);
+    CuAssertIntEquals(test, 5, dictionary->maxLength);
+
+    char text[] = "The cat sat on teh mat.\n'Don't' 42 cats, teh CAT\nsaat catcatcat";
+    Tokenizer tokenizer;
+    tokenizerInitBuffer(&tokenizer, text, strlen(text));
+    FILE *output = tmpfile();
+    Writer writer;
+    writerInit(&writer, output, 64);
+    SpellBatchStats stats;
+    spellBatchCheck(dictionary, &tokenizer, suggestForTest, dictionary, 2, 2, &writer, &stats);
+    writerCleanUp(&writer);
+    tokenizerCleanUp(&tokenizer);
+    CuAssertIntEquals(test, 12, stats.words);
+    CuAssertIntEquals(test, 5, stats.misspelled);
+    CuAssertIntEquals(test, 4, stats.distinct);
+    CuAssertIntEquals(test, 1, stats.skipped);
+    CuAssertIntEquals(test, 1, stats.tooLong);
+
+    // One line per distinct misspelling, in order of first appearance, and no
+    // suggestions for a word more than two letters longer than any.
+    char result[256];
+    rewind(output);
+    size_t length = fread(result, 1, sizeof(result) - 1, output);
+    result[length] = '\0';
+    CuAssertStrEquals(test, "teh\t2\t1:16\tthe,cat\ncats\t1\t2:12\tcat,sat\n"
+                            "saat\t1\t3:1\tsat,cat\ncatcatcat\t1\t3:6\t\n",
+                      result);
+    fclose(output);
+    dictionaryDelete(dictionary);
+}
+
+void testBkTree(CuTest *test)
+{
+    printf("\n--- Testing BK-tree ---\n");
+    CuAssertIntEquals(test, 3, levenshteinDistance("kitten", "sitting"));
+    CuAssertIntEquals(test, 0, levenshteinDistance("", ""));
+    CuAssertIntEquals(test, 4, levenshteinDistance("", "word"));
+
+    const char *words[] = {"book", "books", "cake", "boo", "boon", "cook", "cape", "cart",
+                           "brook", "back", "bake", "look", "hook", "shook", "took"};
+    int numWords = sizeof(words) / sizeof(words[0]);
+    BkTree *tree = bkTreeNew(words, numWords);
+    const char *queries[] = {"bok", "cak", "xyzzy", "shook", ""};
+    for (int q = 0; q < 5; q++)
+    {
+        for (int maxDistance = 0; maxDistance <= 4; maxDistance++)
+        {
+            Suggestion *matches;
+            long long visited = 0;
+            int found = bkTreeSearch(tree, queries[q], maxDistance, &matches, &visited);
+            CuAssertTrue(test, visited > 0 && visited <= numWords);
+            // Every word the tree finds is within the distance, and it finds
+            // as many as comparing with every word does.
+            int expected = 0;
+            for (int i = 0; i < numWords; i++)
+            {
+                expected += levenshteinDistance(queries[q], words[i]) <= maxDistance;
+            }
+            CuAssertIntEquals(test, expected, found);
+            qsort(matches, found, sizeof(Suggestion), suggestionCompare);
+            for (int i = 0; i < found; i++)
+            {
+                CuAssertIntEquals(test, levenshteinDistance(queries[q], words[matches[i].word]),
+                                  matches[i].distance);
+                CuAssertTrue(test, matches[i].distance <= maxDistance);
+                CuAssertTrue(test, i == 0 || matches[i - 1].distance < matches[i].distance ||
+                                       matches[i - 1].word < matches[i].word);
+            }
+            free(matches);
+        }
+    }
+    bkTreeDelete(tree);
+
+    BkTree *empty = bkTreeNew(NULL, 0);
+    Suggestion *matches;
+    CuAssertIntEquals(test, 0, bkTreeSearch(empty, "word", 3, &matches, NULL));
+    free(matches);
+    bkTreeDelete(empty);
+}
+
+void testDeletionIndex(CuTest *test)
+{
+    printf("\n--- Testing deletion index ---\n");
+    const char *words[] = {"book", "books", "cake", "boo", "boon", "cook", "cape", "cart",
+                           "brook", "back", "bake", "look", "hook", "shook", "took",
+                           "bookkeeper", "bookkeeping", "a", "aa", "abba"};
+    int numWords = sizeof(words) / sizeof(words[0]);
+    const char *queries[] = {"bok", "cak", "xyzzy", "shook", "", "bokkeeping", "bookeeper", "ab"};
+    int numQueries = sizeof(queries) / sizeof(queries[0]);
+    char fileName[] = "/tmp/testDeletionIndexXXXXXX";
+    int fd = mkstemp(fileName);
+    CuAssertTrue(test, fd >= 0);
+    close(fd);
+
+    for (int prefixLength = 1; prefixLength <= 8; prefixLength += 3)
+    {
+        DeletionIndex *built = deletionIndexNew(words, numWords, 3, prefixLength);
+        CuAssertIntEquals(test, 1, deletionIndexSave(built, fileName));
+        DeletionIndex *mapped = deletionIndexLoad(fileName, words, numWords);
+        CuAssertPtrNotNull(test, mapped);
+        CuAssertIntEquals(test, 3, mapped->maxDistance);
+        CuAssertIntEquals(test, prefixLength, mapped->prefixLength);
+        DeletionIndex *indexes[] = {built, mapped};
+        for (int n = 0; n < 2; n++)
+        {
+            for (int q = 0; q < numQueries; q++)
+            {
+                for (int maxDistance = 0; maxDistance <= 3; maxDistance++)
+                {
+                    // Same words as comparing with every word.
+                    Suggestion *matches;
+                    int found = deletionIndexSearch(indexes[n], queries[q], maxDistance,
+                                                    &matches, NULL);
+                    int expected = 0;
+                    for (int i = 0; i < numWords; i++)
+                    {
+                        expected += levenshteinDistance(queries[q], words[i]) <= maxDistance;
+                    }
+                    CuAssertIntEquals(test, expected, found);
+                    for (int i = 0; i < found; i++)
+                    {
+                        CuAssertIntEquals(test,
+                                          levenshteinDistance(queries[q], words[matches[i].word]),
+                                          matches[i].distance);
+                    }
+                    free(matches);
+                }
+            }
+        }
+        deletionIndexDelete(mapped);
+        deletionIndexDelete(built);
+    }
+
+    // Not loaded for other words.
+    CuAssertPtrEquals(test, NULL, deletionIndexLoad(fileName, words, numWords - 1));
+    const char *other[] = {"other"};
+    DeletionIndex *index = deletionIndexNew(other, 1, 1, 4);
+    CuAssertIntEquals(test, 1, deletionIndexSave(index, fileName));
+    CuAssertPtrEquals(test, NULL, deletionIndexLoad(fileName, words, 1));
+
+    // Not loaded with an entry past the words or offsets past the entries.
+    uint32_t bad = 2;
+    FILE *file = fopen(fileName, "r+b");
+    fseek(file, -(long)sizeof(bad), SEEK_END);
+    fwrite(&bad, sizeof(bad), 1, file);
+    fclose(file);
+    CuAssertPtrEquals(test, NULL, deletionIndexLoad(fileName, other, 1));
+    CuAssertIntEquals(test, 1, deletionIndexSave(index, fileName));
+    DeletionIndex *mapped = deletionIndexLoad(fileName, other, 1);
+    CuAssertPtrNotNull(test, mapped);
+    deletionIndexDelete(mapped);
+    file = fopen(fileName, "r+b");
+    fseek(file, -(long)(sizeof(DeletionEntry) * index->numEntries + sizeof(bad)), SEEK_END);
+    fwrite(&bad, sizeof(bad), 1, file);
+    fclose(file);
+    CuAssertPtrEquals(test, NULL, deletionIndexLoad(fileName, other, 1));
+    deletionIndexDelete(index);
+    remove(fileName);
+    CuAssertPtrEquals(test, NULL, deletionIndexLoad(fileName, other, 1));
+}
+
 // --- Test Suite ---
 
 void addAllTests(CuSuite *suite)
@@ -339,6 +1800,31 @@ void addAllTests(CuSuite *suite)
     SUITE_ADD_TEST(suite, testMultipleUnder);
     SUITE_ADD_TEST(suite, testMultipleOver);
     SUITE_ADD_TEST(suite, testValueUpdate);
+    SUITE_ADD_TEST(suite, testTokenizerBlocks);
+    SUITE_ADD_TEST(suite, testTokenizerBuffer);
+    SUITE_ADD_TEST(suite, testTokenizerRandom);
+    SUITE_ADD_TEST(suite, testTokenizerFoldCase);
+    SUITE_ADD_TEST(suite, testBlockReader);
+    SUITE_ADD_TEST(suite, testConcordanceParallel);
+    SUITE_ADD_TEST(suite, testTopWords);
+    SUITE_ADD_TEST(suite, testWordSort);
+    SUITE_ADD_TEST(suite, testInvertedIndex);
+    SUITE_ADD_TEST(suite, testCountMinSketch);
+    SUITE_ADD_TEST(suite, testSpaceSaving);
+    SUITE_ADD_TEST(suite, testNgramCounter);
+    SUITE_ADD_TEST(suite, testCheckpoint);
+    SUITE_ADD_TEST(suite, testProfile);
+    SUITE_ADD_TEST(suite, testCorpus);
+    SUITE_ADD_TEST(suite, testDictionary);
+    SUITE_ADD_TEST(suite, testLevenshtein);
+    SUITE_ADD_TEST(suite, testSuggest);
+    SUITE_ADD_TEST(suite, testSuggestPool);
+    SUITE_ADD_TEST(suite, testWordBatch);
+    SUITE_ADD_TEST(suite, testWordBuckets);
+    SUITE_ADD_TEST(suite, testDawg);
+    SUITE_ADD_TEST(suite, testBkTree);
+    SUITE_ADD_TEST(suite, testDeletionIndex);
+    SUITE_ADD_TEST(suite, testSpellBatch);
 }
 
 int main()
@@ -0,0 +1,616 @@
+#define _DEFAULT_SOURCE
+#include "tokenizer.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define TOKENIZER_X86
+#include <immintrin.h>
+#endif
+
+/**
+ * Returns 1 if the character can be part of a word and 0 otherwise.
+ * @param c
+ * @return 1 for digits, ASCII letters and apostrophes.
+ */
+static int isWordChar(unsigned char c)
+{
+    return (c >= '0' && c <= '9') ||
+           (c >= 'A' && c <= 'Z') ||
+           (c >= 'a' && c <= 'z') ||
+           c == '\'';
+}
+
+/**
+ * Returns a bitmask of the word characters among the first count (at most 64)
+ * bytes, bit i set if bytes[i] is a word character. Checks one byte at a time.
+ * @param bytes
+ * @param count
+ * @param fold 1 to also turn upper case letters into lower case in place.
+ * @return Word character bitmask.
+ */
+static uint64_t classifyScalar(char *bytes, size_t count, int fold)
+{
+    uint64_t mask = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        unsigned char c = (unsigned char)bytes[i];
+        mask |= (uint64_t)isWordChar(c) << i;
+        if (fold && c >= 'A' && c <= 'Z')
+        {
+            bytes[i] = (char)(c | 0x20);
+        }
+    }
+    return mask;
+}
+
+#ifndef TOKENIZER_X86
+
+/**
+ * Classifies a full 64-byte block one byte at a time.
+ */
+static uint64_t classifyBlockScalar(char *bytes, int fold)
+{
+    return classifyScalar(bytes, 64, fold);
+}
+
+#else
+
+/*
+ * The vector classifiers compare all bytes of a register at once. Signed byte
+ * compares reject everything above 0x7f, and OR-ing in 0x20 folds upper case
+ * letters onto lower case so one range test covers both. When folding, the
+ * same registers are written back with only the upper case letters folded,
+ * and only if there are any, so lower case text is never written to.
+ */
+
+/**
+ * Classifies a full 64-byte block, 16 bytes at a time with SSE2.
+ */
+static uint64_t classifyBlockSse2(char *bytes, int fold)
+{
+    const __m128i digitLow = _mm_set1_epi8('0' - 1);
+    const __m128i digitHigh = _mm_set1_epi8('9' + 1);
+    const __m128i letterLow = _mm_set1_epi8('a' - 1);
+    const __m128i letterHigh = _mm_set1_epi8('z' + 1);
+    const __m128i caseBit = _mm_set1_epi8(0x20);
+    const __m128i apostrophe = _mm_set1_epi8('\'');
+    const __m128i upperLow = _mm_set1_epi8('A' - 1);
+    const __m128i upperHigh = _mm_set1_epi8('Z' + 1);
+    uint64_t mask = 0;
+
+    for (int i = 0; i < 64; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(bytes + i));
+        if (fold)
+        {
+            __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(v, upperLow),
+                                          _mm_cmpgt_epi8(upperHigh, v));
+            if (_mm_movemask_epi8(upper) != 0)
+            {
+                v = _mm_or_si128(v, _mm_and_si128(upper, caseBit));
+                _mm_storeu_si128((__m128i *)(bytes + i), v);
+            }
+        }
+        __m128i folded = _mm_or_si128(v, caseBit);
+        __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(v, digitLow),
+                                      _mm_cmpgt_epi8(digitHigh, v));
+        __m128i letter = _mm_and_si128(_mm_cmpgt_epi8(folded, letterLow),
+                                       _mm_cmpgt_epi8(letterHigh, folded));
+        __m128i word = _mm_or_si128(_mm_or_si128(digit, letter),
+                                    _mm_cmpeq_epi8(v, apostrophe));
+        mask |= (uint64_t)(unsigned int)_mm_movemask_epi8(word) << i;
+    }
+    return mask;
+}
+
+/**
+ * Classifies a full 64-byte block, 32 bytes at a time with AVX2.
+ */
+__attribute__((target("avx2")))
+static uint64_t classifyBlockAvx2(char *bytes, int fold)
+{
+    const __m256i digitLow = _mm256_set1_epi8('0' - 1);
+    const __m256i digitHigh = _mm256_set1_epi8('9' + 1);
+    const __m256i letterLow = _mm256_set1_epi8('a' - 1);
+    const __m256i letterHigh = _mm256_set1_epi8('z' + 1);
+    const __m256i caseBit = _mm256_set1_epi8(0x20);
+    const __m256i apostrophe = _mm256_set1_epi8('\'');
+    const __m256i upperLow = _mm256_set1_epi8('A' - 1);
+    const __m256i upperHigh = _mm256_set1_epi8('Z' + 1);
+    uint64_t mask = 0;
+
+    for (int i = 0; i < 64; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(bytes + i));
+        if (fold)
+        {
+            __m256i upper = _mm256_and_si256(_mm256_cmpgt_epi8(v, upperLow),
+                                             _mm256_cmpgt_epi8(upperHigh, v));
+            if (_mm256_movemask_epi8(upper) != 0)
+            {
+                v = _mm256_or_si256(v, _mm256_and_si256(upper, caseBit));
+                _mm256_storeu_si256((__m256i *)(bytes + i), v);
+            }
+        }
+        __m256i folded = _mm256_or_si256(v, caseBit);
+        __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(v, digitLow),
+                                         _mm256_cmpgt_epi8(digitHigh, v));
+        __m256i letter = _mm256_and_si256(_mm256_cmpgt_epi8(folded, letterLow),
+                                          _mm256_cmpgt_epi8(letterHigh, folded));
+        __m256i word = _mm256_or_si256(_mm256_or_si256(digit, letter),
+                                       _mm256_cmpeq_epi8(v, apostrophe));
+        mask |= (uint64_t)(unsigned int)_mm256_movemask_epi8(word) << i;
+    }
+    return mask;
+}
+
+#endif
+
+/**
+ * Picks the fastest block classifier the CPU supports.
+ * @return Classifier function.
+ */
+static TokenizerClassify selectClassify(void)
+{
+#ifdef TOKENIZER_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return classifyBlockAvx2;
+    }
+    return classifyBlockSse2;
+#else
+    return classifyBlockScalar;
+#endif
+}
+
+/**
+ * Returns the index of the lowest set bit. The mask must not be 0.
+ * @param mask
+ * @return Bit index.
+ */
+static int lowestBit(uint64_t mask)
+{
+#ifdef __GNUC__
+    return __builtin_ctzll(mask);
+#else
+    int i = 0;
+    while (!(mask & 1))
+    {
+        mask >>= 1;
+        i++;
+    }
+    return i;
+#endif
+}
+
+/**
+ * Returns the index of the first buffered byte at or after from that is a word
+ * character (wordClass 1) or a separator (wordClass 0), or the buffer length if
+ * there is none. The class mask of the current 64-byte block is cached, so
+ * consecutive words in the same block reuse it and each boundary is found with
+ * a shift and a count of trailing zeros.
+ * @param tokenizer
+ * @param from
+ * @param wordClass
+ * @return Index of the first matching byte.
+ */
+static size_t tokenizerScan(Tokenizer *tokenizer, size_t from, int wordClass)
+{
+    while (from < tokenizer->length)
+    {
+        size_t base = from & ~(size_t)63;
+        if (base != tokenizer->maskBase)
+        {
+            if (base + 64 <= tokenizer->length)
+            {
+                tokenizer->mask = tokenizer->classify(tokenizer->buffer + base,
+                                                      tokenizer->foldCase);
+            }
+            else
+            {
+                // Bytes past the end are left as separators.
+                tokenizer->mask = classifyScalar(tokenizer->buffer + base,
+                                                 tokenizer->length - base,
+                                                 tokenizer->foldCase);
+            }
+            tokenizer->maskBase = base;
+        }
+
+        uint64_t bits = wordClass ? tokenizer->mask : ~tokenizer->mask;
+        bits >>= from - base;
+        if (bits != 0)
+        {
+            size_t found = from + lowestBit(bits);
+            return found < tokenizer->length ? found : tokenizer->length;
+        }
+        from = base + 64;
+    }
+    return tokenizer->length;
+}
+
+/**
+ * Initializes a tokenizer that reads the file in blocks of the given size.
+ * Blocks are read from the underlying file descriptor, bypassing the FILE
+ * buffer, so the file must not have been read through stdio before.
+ * @param tokenizer
+ * @param file
+ * @param blockSize Initial number of bytes read at a time.
+ */
+void tokenizerInit(Tokenizer *tokenizer, FILE *file, size_t blockSize)
+{
+    assert(tokenizer != NULL);
+    assert(file != NULL);
+    assert(blockSize > 0);
+    tokenizer->file = file;
+    tokenizer->buffer = malloc(blockSize + 1);
+    tokenizer->capacity = blockSize;
+    tokenizer->length = 0;
+    tokenizer->position = 0;
+    tokenizer->ownsBuffer = 1;
+    tokenizer->trackLines = 0;
+    tokenizer->offset = 0;
+    tokenizer->line = 1;
+    tokenizer->lineStart = 0;
+    tokenizer->classify = selectClassify();
+    tokenizer->foldCase = 1;
+    tokenizer->maskBase = SIZE_MAX;
+    tokenizer->reader = NULL;
+    tokenizer->error = 0;
+}
+
+/**
+ * Initializes a tokenizer over a memory range. Words are terminated in place,
+ * so the range must be writable, including the byte at data[length].
+ * @param tokenizer
+ * @param data
+ * @param length Number of bytes to tokenize.
+ */
+void tokenizerInitBuffer(Tokenizer *tokenizer, char *data, size_t length)
+{
+    assert(tokenizer != NULL);
+    assert(data != NULL);
+    tokenizer->file = NULL;
+    tokenizer->buffer = data;
+    tokenizer->capacity = length;
+    tokenizer->length = length;
+    tokenizer->position = 0;
+    tokenizer->ownsBuffer = 0;
+    tokenizer->trackLines = 0;
+    tokenizer->offset = 0;
+    tokenizer->line = 1;
+    tokenizer->lineStart = 0;
+    tokenizer->classify = selectClassify();
+    tokenizer->foldCase = 1;
+    tokenizer->maskBase = SIZE_MAX;
+    tokenizer->reader = NULL;
+    tokenizer->error = 0;
+}
+
+/**
+ * Stops the read-ahead thread, if any, and frees the buffer if the tokenizer
+ * owns it. Does not close the file.
+ * @param tokenizer
+ */
+void tokenizerCleanUp(Tokenizer *tokenizer)
+{
+    assert(tokenizer != NULL);
+    if (tokenizer->reader != NULL)
+    {
+        blockReaderDelete(tokenizer->reader);
+        tokenizer->reader = NULL;
+    }
+    if (tokenizer->ownsBuffer)
+    {
+        free(tokenizer->buffer);
+    }
+    tokenizer->buffer = NULL;
+}
+
+/**
+ * Creates a tokenizer reading the file in TOKENIZER_BLOCK_SIZE blocks.
+ * @param file
+ * @return The allocated tokenizer.
+ */
+Tokenizer *tokenizerNew(FILE *file)
+{
+    Tokenizer *tokenizer = malloc(sizeof(Tokenizer));
+    tokenizerInit(tokenizer, file, TOKENIZER_BLOCK_SIZE);
+    return tokenizer;
+}
+
+/**
+ * Frees the tokenizer and its buffer. Does not close the file.
+ * @param tokenizer
+ */
+void tokenizerDelete(Tokenizer *tokenizer)
+{
+    tokenizerCleanUp(tokenizer);
+    free(tokenizer);
+}
+
+/**
+ * Starts reading the file at the given offset instead of its current position.
+ * Must be called before the first word is read. Offsets kept by the tokenizer
+ * stay relative to the start of the file.
+ * @param tokenizer
+ * @param offset
+ * @return 1 on success, 0 if the file cannot seek.
+ */
+int tokenizerSeek(Tokenizer *tokenizer, size_t offset)
+{
+    assert(tokenizer->file != NULL);
+    assert(tokenizer->offset == 0 && tokenizer->length == 0);
+    if (lseek(fileno(tokenizer->file), (off_t)offset, SEEK_SET) < 0)
+    {
+        return 0;
+    }
+    tokenizer->offset = offset;
+    tokenizer->lineStart = offset;
+    return 1;
+}
+
+/**
+ * Moves reading the file to a BlockReader thread, so the next blocks are read
+ * from disk while the current one is tokenized. Must be called before the
+ * first word is read, after any tokenizerSeek.
+ * @param tokenizer
+ * @param depth Number of BLOCK_READER_BLOCK_SIZE blocks read ahead, at least 2.
+ * @return 1 on success, 0 if the thread could not be started, in which case
+ *         the tokenizer keeps reading the file itself.
+ */
+int tokenizerPipeline(Tokenizer *tokenizer, int depth)
+{
+    assert(tokenizer->file != NULL);
+    assert(tokenizer->reader == NULL && tokenizer->length == 0);
+    tokenizer->reader = blockReaderNew(fileno(tokenizer->file),
+                                       BLOCK_READER_BLOCK_SIZE, depth);
+    return tokenizer->reader != NULL;
+}
+
+/**
+ * Turns off case folding, so words are returned with their original case.
+ * Must be called before the first word is read.
+ * @param tokenizer
+ */
+void tokenizerKeepCase(Tokenizer *tokenizer)
+{
+    assert(tokenizer->maskBase == SIZE_MAX);
+    tokenizer->foldCase = 0;
+}
+
+/**
+ * Turns on tracking of the line and column of each word, available in
+ * wordLine and wordColumn after each call to tokenizerNext.
+ * @param tokenizer
+ */
+void tokenizerTrackLines(Tokenizer *tokenizer)
+{
+    tokenizer->trackLines = 1;
+}
+
+/**
+ * Counts the newlines among the buffered bytes [from, to) when tracking lines.
+ * @param tokenizer
+ * @param from
+ * @param to
+ */
+static void tokenizerCountLines(Tokenizer *tokenizer, size_t from, size_t to)
+{
+    if (!tokenizer->trackLines)
+    {
+        return;
+    }
+    const char *newline;
+    while (from < to &&
+           (newline = memchr(tokenizer->buffer + from, '\n', to - from)) != NULL)
+    {
+        from = newline - tokenizer->buffer + 1;
+        tokenizer->line++;
+        tokenizer->lineStart = tokenizer->offset + from;
+    }
+}
+
+/**
+ * Discards the consumed bytes, moves the unconsumed tail to the front of the
+ * buffer and reads up to a block after it. The buffer is doubled when the
+ * tail already fills it, so a word longer than a block is never split.
+ * @param tokenizer
+ * @return Number of bytes read, 0 at the end of the input.
+ */
+static size_t tokenizerFill(Tokenizer *tokenizer)
+{
+    if (tokenizer->file == NULL)
+    {
+        return 0;
+    }
+
+    size_t tail = tokenizer->length - tokenizer->position;
+    memmove(tokenizer->buffer, tokenizer->buffer + tokenizer->position, tail);
+    tokenizer->offset += tokenizer->position;
+    tokenizer->position = 0;
+    tokenizer->length = tail;
+    tokenizer->maskBase = SIZE_MAX;
+
+    if (tail == tokenizer->capacity)
+    {
+        tokenizer->capacity *= 2;
+        tokenizer->buffer = realloc(tokenizer->buffer, tokenizer->capacity + 1);
+    }
+
+    if (tokenizer->reader != NULL)
+    {
+        size_t copied = blockReaderRead(tokenizer->reader,
+                                        tokenizer->buffer + tail,
+                                        tokenizer->capacity - tail);
+        if (copied == 0)
+        {
+            // The reader thread has finished, so its error no longer changes.
+            tokenizer->error = tokenizer->reader->error;
+        }
+        tokenizer->length += copied;
+        return copied;
+    }
+
+    // Read the descriptor directly so a pipe returns whatever is available
+    // instead of blocking until a whole block has arrived.
+    ssize_t got;
+    do
+    {
+        got = read(fileno(tokenizer->file), tokenizer->buffer + tail,
+                   tokenizer->capacity - tail);
+    } while (got < 0 && errno == EINTR);
+    if (got <= 0)
+    {
+        tokenizer->error = got < 0 ? errno : 0;
+        return 0;
+    }
+    tokenizer->length += (size_t)got;
+    return (size_t)got;
+}
+
+/**
+ * Finds the next word. The word is a view into the tokenizer's buffer and is
+ * null terminated in place; it stays valid until the next call.
+ * @param tokenizer
+ * @param word Set to the start of the word.
+ * @param length Set to the number of characters in the word.
+ * @return 1 if a word was found, 0 at the end of the input or after a failed
+ *         read, which leaves error set.
+ */
+int tokenizerNext(Tokenizer *tokenizer, char **word, int *length)
+{
+    assert(tokenizer != NULL);
+
+    // Skip separators, refilling as long as the buffer runs dry.
+    size_t start = tokenizerScan(tokenizer, tokenizer->position, 1);
+    tokenizerCountLines(tokenizer, tokenizer->position, start);
+    while (start == tokenizer->length)
+    {
+        tokenizer->position = start;
+        if (tokenizerFill(tokenizer) == 0)
+        {
+            return 0;
+        }
+        start = tokenizerScan(tokenizer, 0, 1);
+        tokenizerCountLines(tokenizer, 0, start);
+    }
+    tokenizer->position = start;
+
+    // Find the end, pulling in more blocks if the word straddles them.
+    size_t end = tokenizerScan(tokenizer, start, 0);
+    while (end == tokenizer->length)
+    {
+        // Filling moves the word to the front of the buffer, even at the end
+        // of the input.
+        size_t scanned = end - tokenizer->position;
+        size_t read = tokenizerFill(tokenizer);
+        end = tokenizer->position + scanned;
+        if (read == 0)
+        {
+            break;
+        }
+        end = tokenizerScan(tokenizer, end, 0);
+    }
+    start = tokenizer->position;
+
+    if (tokenizer->trackLines)
+    {
+        tokenizer->wordLine = tokenizer->line;
+        tokenizer->wordColumn = tokenizer->offset + start - tokenizer->lineStart;
+        if (end < tokenizer->length)
+        {
+            tokenizerCountLines(tokenizer, end, end + 1);
+        }
+    }
+
+    // The separator (or the spare byte) is overwritten by the terminator.
+    tokenizer->buffer[end] = '\0';
+    tokenizer->position = end < tokenizer->length ? end + 1 : end;
+
+    *word = tokenizer->buffer + start;
+    *length = (int)(end - start);
+    return 1;
+}
+
+/**
+ * Returns the index just past the first separator at or after the given index,
+ * or length if there is none. Splitting a range there never cuts a word, and
+ * leaves the separator at the end of the first part so it can be overwritten
+ * by a terminator.
+ * @param data
+ * @param length
+ * @param at
+ * @return Split index.
+ */
+size_t tokenizerBoundary(const char *data, size_t length, size_t at)
+{
+    while (at < length && isWordChar((unsigned char)data[at]))
+    {
+        at++;
+    }
+    return at < length ? at + 1 : length;
+}
+
+/**
+ * Maps a whole file into memory for tokenizerInitBuffer. The mapping is
+ * private and writable, and is followed by at least one zeroed spare byte, so
+ * words can be terminated in place without touching the file.
+ * @param fileName
+ * @param length Set to the file size.
+ * @return The mapped data, or NULL if the file could not be mapped.
+ */
+char *tokenizerMapFile(const char *fileName, size_t *length)
+{
+    int fd = open(fileName, O_RDONLY);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0)
+    {
+        close(fd);
+        return NULL;
+    }
+    *length = (size_t)info.st_size;
+
+    // Reserve the spare byte with an anonymous mapping, then map the file
+    // over its start.
+    char *data = mmap(NULL, *length + 1, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED)
+    {
+        close(fd);
+        return NULL;
+    }
+    if (*length > 0 &&
+        mmap(data, *length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED,
+             fd, 0) == MAP_FAILED)
+    {
+        munmap(data, *length + 1);
+        close(fd);
+        return NULL;
+    }
+    close(fd);
+    return data;
+}
+
+/**
+ * Unmaps a file mapped with tokenizerMapFile.
+ * @param data
+ * @param length The file size returned by tokenizerMapFile.
+ */
+void tokenizerUnmapFile(char *data, size_t length)
+{
+    munmap(data, length + 1);
+}
@@ -0,0 +1,80 @@
+#ifndef TOKENIZER_H
+#define TOKENIZER_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "blockReader.h"
+
+#define TOKENIZER_BLOCK_SIZE 65536
+
+typedef struct Tokenizer Tokenizer;
+
+/*
+ * Classifies a 64-byte block, returning a bitmask with bit i set if bytes[i]
+ * is a word character. With fold set, also lowers the case of the block's
+ * letters in place.
+ */
+typedef uint64_t (*TokenizerClassify)(char *bytes, int fold);
+
+/*
+ * Splits a file or a memory range into words: runs of digits, ASCII letters
+ * and apostrophes. Words are returned as views into the tokenizer's buffer,
+ * so no memory is allocated per word, and are lower case unless
+ * tokenizerKeepCase is called.
+ */
+struct Tokenizer
+{
+    // File to read blocks from, or NULL when tokenizing a memory range.
+    FILE *file;
+    // Block buffer. Always has one spare byte after capacity for a '\0'.
+    char *buffer;
+    // Number of bytes the buffer can hold, not counting the spare byte.
+    size_t capacity;
+    // Number of valid bytes in the buffer.
+    size_t length;
+    // Index of the first byte not yet consumed.
+    size_t position;
+    // 1 if the buffer is owned by the tokenizer and must be freed.
+    int ownsBuffer;
+    // Block classifier chosen for this CPU (AVX2, SSE2 or scalar).
+    TokenizerClassify classify;
+    // 1 if letters are folded to lower case while classifying.
+    int foldCase;
+    // Buffer index of the block described by mask, or SIZE_MAX if none.
+    size_t maskBase;
+    // Word character bitmask of the cached block.
+    uint64_t mask;
+    // 1 if lines are counted, see tokenizerTrackLines.
+    int trackLines;
+    // Input offset of buffer[0].
+    size_t offset;
+    // Current line number, starting at 1, and input offset of its start.
+    long long line;
+    size_t lineStart;
+    // Line number and column (starting at 0) of the last word.
+    long long wordLine;
+    long long wordColumn;
+    // Thread reading the file ahead, or NULL if the file is read directly.
+    BlockReader *reader;
+    // errno of a failed read, 0 if none. Reading stops at the error as if the
+    // input ended there.
+    int error;
+};
+
+void tokenizerInit(Tokenizer *tokenizer, FILE *file, size_t blockSize);
+void tokenizerInitBuffer(Tokenizer *tokenizer, char *data, size_t length);
+void tokenizerCleanUp(Tokenizer *tokenizer);
+Tokenizer *tokenizerNew(FILE *file);
+void tokenizerDelete(Tokenizer *tokenizer);
+int tokenizerSeek(Tokenizer *tokenizer, size_t offset);
+int tokenizerPipeline(Tokenizer *tokenizer, int depth);
+void tokenizerKeepCase(Tokenizer *tokenizer);
+void tokenizerTrackLines(Tokenizer *tokenizer);
+int tokenizerNext(Tokenizer *tokenizer, char **word, int *length);
+
+size_t tokenizerBoundary(const char *data, size_t length, size_t at);
+char *tokenizerMapFile(const char *fileName, size_t *length);
+void tokenizerUnmapFile(char *data, size_t length);
+
+#endif
@@ -0,0 +1,410 @@
+#include "wordBatch.h"
+#include "levenshtein.h"
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <assert.h>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define WORD_BATCH_X86
+#include <immintrin.h>
+#endif
+
+/**
+ * Computes the distances of a word to a block one dictionary word at a time,
+ * reading the block's words from the packed buckets, which hold the words of
+ * each length in the same order as the blocks. Used where AVX2 is not
+ * available.
+ */
+static void distancesScalar(const WordBatch *batch, int block, const unsigned char *word,
+                            int length, int limit, int16_t *row, int *distances)
+{
+    (void)row;
+    int n = batch->blockLength[block];
+    const char *letters = batch->buckets->letters + batch->buckets->offset[n] +
+                          (size_t)(block - batch->firstBlock[n]) * WORD_BATCH_LANES * n;
+    for (int lane = 0; lane < WORD_BATCH_LANES; lane++, letters += n)
+    {
+        int id = batch->ids[block * WORD_BATCH_LANES + lane];
+        distances[lane] =
+            id >= 0 ? levenshteinBoundedLength((const char *)word, length, letters, n, limit)
+                    : limit + 1;
+    }
+}
+
+/**
+ * Computes the distances of a word to a block one dictionary word at a time,
+ * reading the words themselves. Used for words too long for the 16-bit lanes
+ * of the AVX2 kernel, whatever kernel the batch uses.
+ */
+static void distancesLong(const WordBatch *batch, int block, const unsigned char *word,
+                          int length, int limit, int16_t *row, int *distances)
+{
+    (void)row;
+    int n = batch->blockLength[block];
+    for (int lane = 0; lane < WORD_BATCH_LANES; lane++)
+    {
+        int id = batch->ids[block * WORD_BATCH_LANES + lane];
+        distances[lane] = id >= 0 ? levenshteinBoundedLength((const char *)word, length,
+                                                             batch->words[id], n, limit)
+                                  : limit + 1;
+    }
+}
+
+#ifdef WORD_BATCH_X86
+
+/**
+ * Computes the distances of a word to the 16 words of a block at once, one
+ * 16-bit lane per dictionary word. Row i of the recurrence is kept as one
+ * vector per letter of the block's words, and the computation stops once no
+ * lane can end within the limit.
+ */
+__attribute__((target("avx2")))
+static void distancesAvx2(const WordBatch *batch, int block, const unsigned char *word,
+                          int length, int limit, int16_t *row, int *distances)
+{
+    int n = batch->blockLength[block];
+    const unsigned char *letters = batch->letters + batch->blockOffset[block];
+    const __m256i one = _mm256_set1_epi16(1);
+    const __m256i bound = _mm256_set1_epi16((short)limit);
+    for (int j = 0; j <= n; j++)
+    {
+        _mm256_storeu_si256((__m256i *)(row + j * WORD_BATCH_LANES), _mm256_set1_epi16((short)j));
+    }
+    for (int i = 1; i <= length; i++)
+    {
+        __m256i letter = _mm256_set1_epi16(word[i - 1]);
+        __m256i diagonal = _mm256_loadu_si256((const __m256i *)row);
+        __m256i left = _mm256_set1_epi16((short)i);
+        _mm256_storeu_si256((__m256i *)row, left);
+        // Each cell plus the length difference left from it bounds the end.
+        __m256i smallest = _mm256_add_epi16(left, _mm256_set1_epi16((short)abs(n - (length - i))));
+        for (int j = 1; j <= n; j++)
+        {
+            __m256i up = _mm256_loadu_si256((const __m256i *)(row + j * WORD_BATCH_LANES));
+            __m256i column = _mm256_cvtepu8_epi16(
+                _mm_loadu_si128((const __m128i *)(letters + (j - 1) * WORD_BATCH_LANES)));
+            // Equal letters compare to -1, which cancels the substitution.
+            __m256i value = _mm256_add_epi16(_mm256_add_epi16(diagonal, one),
+                                             _mm256_cmpeq_epi16(column, letter));
+            value = _mm256_min_epi16(value, _mm256_add_epi16(_mm256_min_epi16(up, left), one));
+            _mm256_storeu_si256((__m256i *)(row + j * WORD_BATCH_LANES), value);
+            smallest = _mm256_min_epi16(
+                smallest,
+                _mm256_add_epi16(value, _mm256_set1_epi16((short)abs((n - j) - (length - i)))));
+            diagonal = up;
+            left = value;
+        }
+        if (_mm256_movemask_epi8(_mm256_cmpgt_epi16(smallest, bound)) == -1)
+        {
+            for (int lane = 0; lane < WORD_BATCH_LANES; lane++)
+            {
+                distances[lane] = limit + 1;
+            }
+            return;
+        }
+    }
+    for (int lane = 0; lane < WORD_BATCH_LANES; lane++)
+    {
+        int distance = row[n * WORD_BATCH_LANES + lane];
+        distances[lane] = distance <= limit ? distance : limit + 1;
+    }
+}
+
+#endif
+
+/**
+ * Picks the fastest kernel the CPU supports.
+ * @return Kernel function.
+ */
+static WordBatchKernel selectKernel(void)
+{
+#ifdef WORD_BATCH_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return distancesAvx2;
+    }
+#endif
+    return distancesScalar;
+}
+
+/**
+ * Lays out the words in blocks by length. Within a length, words keep their
+ * dictionary order, and the empty lanes of the last block repeat its last
+ * word so that they never keep a block from stopping early.
+ * @param words
+ * @param numWords
+ * @return The batch.
+ */
+WordBatch *wordBatchNew(const char *const *words, int numWords)
+{
+    assert(words != NULL || numWords == 0);
+    WordBatch *batch = malloc(sizeof(WordBatch));
+    batch->words = words;
+    batch->numWords = numWords;
+    batch->maxLength = 0;
+    int *lengths = malloc(sizeof(int) * (numWords + 1));
+    for (int i = 0; i < numWords; i++)
+    {
+        lengths[i] = (int)strlen(words[i]);
+        assert(lengths[i] <= WORD_BATCH_MAX_LENGTH);
+        batch->maxLength = lengths[i] > batch->maxLength ? lengths[i] : batch->maxLength;
+    }
+
+    // Words and blocks of each length, then the first block of each length.
+    int *counts = calloc(batch->maxLength + 2, sizeof(int));
+    for (int i = 0; i < numWords; i++)
+    {
+        counts[lengths[i]]++;
+    }
+    batch->firstBlock = malloc(sizeof(int) * (batch->maxLength + 2));
+    batch->numBlocks = 0;
+    for (int l = 0; l <= batch->maxLength; l++)
+    {
+        batch->firstBlock[l] = batch->numBlocks;
+        batch->numBlocks += (counts[l] + WORD_BATCH_LANES - 1) / WORD_BATCH_LANES;
+    }
+    batch->firstBlock[batch->maxLength + 1] = batch->numBlocks;
+
+    batch->blockLength = malloc(sizeof(int) * (batch->numBlocks + 1));
+    batch->blockOffset = malloc(sizeof(size_t) * (batch->numBlocks + 1));
+    batch->ids = malloc(sizeof(int) * WORD_BATCH_LANES * (batch->numBlocks + 1));
+    size_t size = 0;
+    for (int l = 0; l <= batch->maxLength; l++)
+    {
+        for (int b = batch->firstBlock[l]; b < batch->firstBlock[l + 1]; b++)
+        {
+            batch->blockLength[b] = l;
+            batch->blockOffset[b] = size;
+            size += (size_t)l * WORD_BATCH_LANES;
+        }
+    }
+    batch->letters = malloc(size + 1);
+
+    // Slot of the next word of each length.
+    int *next = malloc(sizeof(int) * (batch->maxLength + 1));
+    for (int l = 0; l <= batch->maxLength; l++)
+    {
+        next[l] = batch->firstBlock[l] * WORD_BATCH_LANES;
+    }
+    for (int i = 0; i < numWords; i++)
+    {
+        int slot = next[lengths[i]]++;
+        int block = slot / WORD_BATCH_LANES;
+        unsigned char *letters = batch->letters + batch->blockOffset[block];
+        for (int j = 0; j < lengths[i]; j++)
+        {
+            letters[j * WORD_BATCH_LANES + slot % WORD_BATCH_LANES] = (unsigned char)words[i][j];
+        }
+        batch->ids[slot] = i;
+    }
+    for (int l = 0; l <= batch->maxLength; l++)
+    {
+        for (int slot = next[l]; slot < batch->firstBlock[l + 1] * WORD_BATCH_LANES; slot++)
+        {
+            int block = slot / WORD_BATCH_LANES;
+            unsigned char *letters = batch->letters + batch->blockOffset[block];
+            for (int j = 0; j < l; j++)
+            {
+                letters[j * WORD_BATCH_LANES + slot % WORD_BATCH_LANES] =
+                    letters[j * WORD_BATCH_LANES + (slot - 1) % WORD_BATCH_LANES];
+            }
+            batch->ids[slot] = -1;
+        }
+    }
+    free(next);
+    free(counts);
+    free(lengths);
+    batch->kernel = selectKernel();
+    batch->buckets = NULL;
+    if (batch->kernel == distancesScalar)
+    {
+        wordBatchUseScalar(batch);
+    }
+    return batch;
+}
+
+/**
+ * Frees the batch. Does not free the words.
+ * @param batch
+ */
+void wordBatchDelete(WordBatch *batch)
+{
+    assert(batch != NULL);
+    free(batch->firstBlock);
+    free(batch->blockLength);
+    free(batch->blockOffset);
+    free(batch->ids);
+    free(batch->letters);
+    if (batch->buckets != NULL)
+    {
+        wordBucketsDelete(batch->buckets);
+    }
+    free(batch);
+}
+
+/**
+ * Makes the batch compare one word at a time, as on CPUs without AVX2.
+ * @param batch
+ */
+void wordBatchUseScalar(WordBatch *batch)
+{
+    if (batch->buckets == NULL)
+    {
+        batch->buckets = wordBucketsNew(batch->words, batch->numWords);
+    }
+    batch->kernel = distancesScalar;
+}
+
+/**
+ * Returns the kernel to compare a word of the given length with, which is the
+ * batch's own unless the word is too long for 16-bit lanes.
+ * @param batch
+ * @param length
+ * @return Kernel function.
+ */
+static WordBatchKernel queryKernel(const WordBatch *batch, int length)
+{
+    return length > WORD_BATCH_MAX_LENGTH ? distancesLong : batch->kernel;
+}
+
+/**
+ * Computes the distance of a word to every dictionary word.
+ * @param batch
+ * @param word
+ * @param limit Largest distance of interest.
+ * @param distances Set to the distance to each word, limit + 1 for those
+ *                  farther than limit.
+ */
+void wordBatchDistances(WordBatch *batch, const char *word, int limit, int *distances)
+{
+    assert(batch != NULL);
+    assert(word != NULL);
+    int length = (int)strlen(word);
+    int longest = length > batch->maxLength ? length : batch->maxLength;
+    limit = limit < longest ? limit : longest;
+    WordBatchKernel kernel = queryKernel(batch, length);
+    int16_t *row = malloc(sizeof(int16_t) * WORD_BATCH_LANES * (batch->maxLength + 1));
+    int lanes[WORD_BATCH_LANES];
+    for (int b = 0; b < batch->numBlocks; b++)
+    {
+        if (abs(batch->blockLength[b] - length) > limit)
+        {
+            for (int lane = 0; lane < WORD_BATCH_LANES; lane++)
+            {
+                lanes[lane] = limit + 1;
+            }
+        }
+        else
+        {
+            kernel(batch, b, (const unsigned char *)word, length, limit, row, lanes);
+        }
+        for (int lane = 0; lane < WORD_BATCH_LANES; lane++)
+        {
+            int id = batch->ids[b * WORD_BATCH_LANES + lane];
+            if (id >= 0)
+            {
+                distances[id] = lanes[lane];
+            }
+        }
+    }
+    free(row);
+}
+
+/**
+ * Offers the dictionary words to a heap, a block at a time. Lengths are
+ * visited from the word's own length outwards, since closer lengths tend to
+ * hold closer words, and the scan stops at the first length further from the
+ * word's than any suggestion kept can be. Several threads can share a scan,
+ * each taking every stride-th block from offset on and pruning with a shared
+ * limit as suggestScanRange does.
+ * @param batch
+ * @param word
+ * @param offset First block of this thread.
+ * @param stride Number of threads.
+ * @param heap
+ * @param sharedLimit Limit shared with other threads, or NULL.
+ */
+void wordBatchScan(WordBatch *batch, const char *word, int offset, int stride,
+                   SuggestionHeap *heap, int *sharedLimit)
+{
+    assert(batch != NULL);
+    assert(word != NULL);
+    assert(offset >= 0 && offset < stride);
+    int length = (int)strlen(word);
+    int longest = length > batch->maxLength ? length : batch->maxLength;
+    WordBatchKernel kernel = queryKernel(batch, length);
+    int16_t *row = malloc(sizeof(int16_t) * WORD_BATCH_LANES * (batch->maxLength + 1));
+    int distances[WORD_BATCH_LANES];
+    for (int difference = 0; difference <= longest; difference++)
+    {
+        // Largest distance any word could be kept at.
+        int limit = suggestionHeapLimit(heap, -1, longest);
+        if (sharedLimit != NULL)
+        {
+            int shared = __atomic_load_n(sharedLimit, __ATOMIC_RELAXED);
+            limit = shared < limit ? shared : limit;
+        }
+        if (difference > limit)
+        {
+            break;
+        }
+        for (int side = 0; side < (difference == 0 ? 1 : 2); side++)
+        {
+            int l = side == 0 ? length - difference : length + difference;
+            if (l < 0 || l > batch->maxLength)
+            {
+                continue;
+            }
+            for (int b = batch->firstBlock[l]; b < batch->firstBlock[l + 1]; b++)
+            {
+                if (b % stride != offset)
+                {
+                    continue;
+                }
+                // Lanes are in dictionary order, so the first one may tie.
+                const int *ids = batch->ids + b * WORD_BATCH_LANES;
+                limit = suggestionHeapLimit(heap, ids[0], longest);
+                if (sharedLimit != NULL)
+                {
+                    int shared = __atomic_load_n(sharedLimit, __ATOMIC_RELAXED);
+                    limit = shared < limit ? shared : limit;
+                }
+                if (difference > limit)
+                {
+                    continue;
+                }
+                kernel(batch, b, (const unsigned char *)word, length, limit, row, distances);
+                for (int lane = 0; lane < WORD_BATCH_LANES; lane++)
+                {
+                    if (ids[lane] >= 0 && distances[lane] <= limit &&
+                        suggestionHeapOffer(heap, ids[lane], distances[lane]) &&
+                        sharedLimit != NULL)
+                    {
+                        suggestionHeapShare(heap, sharedLimit);
+                    }
+                }
+            }
+        }
+    }
+    free(row);
+}
+
+/**
+ * Finds the closest dictionary words to a word. Gives the same suggestions as
+ * suggestScan.
+ * @param batch
+ * @param word
+ * @param best Filled with the closest words, nearest first, ties in
+ *             dictionary order.
+ * @param count Number of words wanted.
+ * @return Number of words found.
+ */
+int wordBatchSuggest(WordBatch *batch, const char *word, Suggestion *best, int count)
+{
+    SuggestionHeap heap;
+    suggestionHeapInit(&heap, best, count);
+    wordBatchScan(batch, word, 0, 1, &heap, NULL);
+    return suggestionHeapSort(&heap);
+}
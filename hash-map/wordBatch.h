@@ -0,0 +1,58 @@
+#ifndef WORD_BATCH_H
+#define WORD_BATCH_H
+
+#include "suggest.h"
+#include "wordBuckets.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define WORD_BATCH_LANES 16
+#define WORD_BATCH_MAX_LENGTH 32767
+
+typedef struct WordBatch WordBatch;
+
+/*
+ * Computes the distances of a word to the words of one block, each distance
+ * more than limit as limit + 1.
+ */
+typedef void (*WordBatchKernel)(const WordBatch *batch, int block, const unsigned char *word,
+                                int length, int limit, int16_t *row, int *distances);
+
+/*
+ * The words of a dictionary in blocks of WORD_BATCH_LANES words of the same
+ * length, stored column-major: the first letters of the block's words, then
+ * their second letters and so on. A word is compared with a whole block at
+ * once, one vector lane per dictionary word, with every lane following the
+ * same steps of the edit distance recurrence since all the words have the
+ * same length. Blocks are grouped by length, so a search skips the lengths
+ * too far from the query's.
+ */
+struct WordBatch
+{
+    const char *const *words;
+    int numWords;
+    int maxLength;
+    int numBlocks;
+    // Blocks of length l are firstBlock[l] to firstBlock[l + 1].
+    int *firstBlock;
+    // Length of each block's words and offset of its letters.
+    int *blockLength;
+    size_t *blockOffset;
+    // Word number in each lane of each block, -1 for an empty lane.
+    int *ids;
+    unsigned char *letters;
+    // Fastest kernel the CPU supports.
+    WordBatchKernel kernel;
+    // Same words packed by length for the scalar kernel, NULL if unused.
+    WordBuckets *buckets;
+};
+
+WordBatch *wordBatchNew(const char *const *words, int numWords);
+void wordBatchDelete(WordBatch *batch);
+void wordBatchUseScalar(WordBatch *batch);
+void wordBatchDistances(WordBatch *batch, const char *word, int limit, int *distances);
+void wordBatchScan(WordBatch *batch, const char *word, int offset, int stride,
+                   SuggestionHeap *heap, int *sharedLimit);
+int wordBatchSuggest(WordBatch *batch, const char *word, Suggestion *best, int count);
+
+#endif
@@ -0,0 +1,217 @@
+#include "wordBuckets.h"
+#include "levenshtein.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+/**
+ * Packs the words by length. Within a length, words keep their dictionary
+ * order.
+ * @param words
+ * @param numWords
+ * @return The buckets.
+ */
+WordBuckets *wordBucketsNew(const char *const *words, int numWords)
+{
+    assert(words != NULL || numWords == 0);
+    WordBuckets *buckets = malloc(sizeof(WordBuckets));
+    buckets->words = words;
+    buckets->numWords = numWords;
+    buckets->maxLength = 0;
+    int *lengths = malloc(sizeof(int) * (numWords + 1));
+    for (int i = 0; i < numWords; i++)
+    {
+        lengths[i] = (int)strlen(words[i]);
+        buckets->maxLength = lengths[i] > buckets->maxLength ? lengths[i] : buckets->maxLength;
+    }
+
+    // Count the words of each length, then turn the counts into starts.
+    buckets->first = calloc(buckets->maxLength + 2, sizeof(int));
+    buckets->offset = malloc(sizeof(size_t) * (buckets->maxLength + 2));
+    for (int i = 0; i < numWords; i++)
+    {
+        buckets->first[lengths[i] + 1]++;
+    }
+    buckets->offset[0] = 0;
+    for (int l = 0; l <= buckets->maxLength; l++)
+    {
+        buckets->offset[l + 1] = buckets->offset[l] + (size_t)buckets->first[l + 1] * l;
+        buckets->first[l + 1] += buckets->first[l];
+    }
+    buckets->ids = malloc(sizeof(int) * (numWords + 1));
+    buckets->letters = malloc(buckets->offset[buckets->maxLength + 1] + 1);
+
+    int *next = malloc(sizeof(int) * (buckets->maxLength + 1));
+    memcpy(next, buckets->first, sizeof(int) * (buckets->maxLength + 1));
+    for (int i = 0; i < numWords; i++)
+    {
+        int l = lengths[i];
+        int slot = next[l]++;
+        buckets->ids[slot] = i;
+        memcpy(buckets->letters + buckets->offset[l] + (size_t)(slot - buckets->first[l]) * l,
+               words[i], l);
+    }
+    free(next);
+    free(lengths);
+    return buckets;
+}
+
+/**
+ * Frees the buckets. Does not free the words.
+ * @param buckets
+ */
+void wordBucketsDelete(WordBuckets *buckets)
+{
+    assert(buckets != NULL);
+    free(buckets->first);
+    free(buckets->offset);
+    free(buckets->ids);
+    free(buckets->letters);
+    free(buckets);
+}
+
+/**
+ * @param buckets
+ * @return Bytes allocated for the buckets, not counting the words.
+ */
+size_t wordBucketsBytes(WordBuckets *buckets)
+{
+    return sizeof(WordBuckets) + (sizeof(int) + sizeof(size_t)) * (buckets->maxLength + 2) +
+           sizeof(int) * (buckets->numWords + 1) + buckets->offset[buckets->maxLength + 1] + 1;
+}
+
+/**
+ * Finds every word within the given distance of the query, reading only the
+ * lengths within that distance of the query's.
+ * @param buckets
+ * @param word
+ * @param maxDistance
+ * @param matches Set to an allocated array of the words found, by length and
+ *                then in dictionary order, to be freed by the caller.
+ * @param visited If not NULL, incremented by the number of distances computed.
+ * @return Number of words found.
+ */
+int wordBucketsWithin(WordBuckets *buckets, const char *word, int maxDistance,
+                      Suggestion **matches, long long *visited)
+{
+    assert(buckets != NULL);
+    assert(word != NULL);
+    assert(maxDistance >= 0);
+    int length = (int)strlen(word);
+    int low = length - maxDistance > 0 ? length - maxDistance : 0;
+    int high = length + maxDistance < buckets->maxLength ? length + maxDistance
+                                                         : buckets->maxLength;
+    int capacity = 16;
+    int found = 0;
+    *matches = malloc(sizeof(Suggestion) * capacity);
+    if (low > high)
+    {
+        return 0;
+    }
+    for (int l = low; l <= high; l++)
+    {
+        const char *letters = buckets->letters + buckets->offset[l];
+        for (int slot = buckets->first[l]; slot < buckets->first[l + 1]; slot++, letters += l)
+        {
+            int distance = levenshteinBoundedLength(word, length, letters, l, maxDistance);
+            if (distance > maxDistance)
+            {
+                continue;
+            }
+            if (found == capacity)
+            {
+                capacity *= 2;
+                *matches = realloc(*matches, sizeof(Suggestion) * capacity);
+            }
+            (*matches)[found].word = buckets->ids[slot];
+            (*matches)[found].distance = distance;
+            found++;
+        }
+    }
+    if (visited != NULL)
+    {
+        *visited += buckets->first[high + 1] - buckets->first[low];
+    }
+    return found;
+}
+
+/**
+ * Offers the dictionary words to a heap, visiting lengths from the word's own
+ * length outwards, and stopping at the first length further from the word's
+ * than any suggestion kept can be. Pruning with a shared limit is as in
+ * suggestScanRange.
+ * @param buckets
+ * @param word
+ * @param heap
+ * @param sharedLimit Limit shared with other threads, or NULL.
+ */
+void wordBucketsScan(WordBuckets *buckets, const char *word, SuggestionHeap *heap,
+                     int *sharedLimit)
+{
+    assert(buckets != NULL);
+    assert(word != NULL);
+    int length = (int)strlen(word);
+    int longest = length > buckets->maxLength ? length : buckets->maxLength;
+    for (int difference = 0; difference <= longest; difference++)
+    {
+        for (int side = 0; side < (difference == 0 ? 1 : 2); side++)
+        {
+            int l = side == 0 ? length - difference : length + difference;
+            if (l < 0 || l > buckets->maxLength)
+            {
+                continue;
+            }
+            const char *letters = buckets->letters + buckets->offset[l];
+            for (int slot = buckets->first[l]; slot < buckets->first[l + 1];
+                 slot++, letters += l)
+            {
+                int limit = suggestionHeapLimit(heap, buckets->ids[slot], longest);
+                if (sharedLimit != NULL)
+                {
+                    int shared = __atomic_load_n(sharedLimit, __ATOMIC_RELAXED);
+                    limit = shared < limit ? shared : limit;
+                }
+                if (difference > limit)
+                {
+                    // Later words of this length can only tie or lose.
+                    break;
+                }
+                int distance = levenshteinBoundedLength(word, length, letters, l, limit);
+                if (distance <= limit &&
+                    suggestionHeapOffer(heap, buckets->ids[slot], distance) &&
+                    sharedLimit != NULL)
+                {
+                    suggestionHeapShare(heap, sharedLimit);
+                }
+            }
+        }
+        int limit = suggestionHeapLimit(heap, -1, longest);
+        if (sharedLimit != NULL)
+        {
+            int shared = __atomic_load_n(sharedLimit, __ATOMIC_RELAXED);
+            limit = shared < limit ? shared : limit;
+        }
+        if (difference >= limit)
+        {
+            break;
+        }
+    }
+}
+
+/**
+ * Finds the closest dictionary words to a word. Gives the same suggestions as
+ * suggestScan.
+ * @param buckets
+ * @param word
+ * @param best Filled with the closest words, nearest first, ties in
+ *             dictionary order.
+ * @param count Number of words wanted.
+ * @return Number of words found.
+ */
+int wordBucketsSuggest(WordBuckets *buckets, const char *word, Suggestion *best, int count)
+{
+    SuggestionHeap heap;
+    suggestionHeapInit(&heap, best, count);
+    wordBucketsScan(buckets, word, &heap, NULL);
+    return suggestionHeapSort(&heap);
+}
@@ -0,0 +1,37 @@
+#ifndef WORD_BUCKETS_H
+#define WORD_BUCKETS_H
+
+#include "suggest.h"
+#include <stddef.h>
+
+typedef struct WordBuckets WordBuckets;
+
+/*
+ * The words of a dictionary grouped by length, each group packed into one
+ * array without terminators: word i of length l starts l * i bytes into its
+ * group. A word within distance k of a query has a length within k of the
+ * query's, so a search reads only those groups, from start to end.
+ */
+struct WordBuckets
+{
+    const char *const *words;
+    int numWords;
+    int maxLength;
+    // Words of length l are ids[first[l]] to ids[first[l + 1] - 1], and their
+    // letters start at letters + offset[l].
+    int *first;
+    size_t *offset;
+    int *ids;
+    char *letters;
+};
+
+WordBuckets *wordBucketsNew(const char *const *words, int numWords);
+void wordBucketsDelete(WordBuckets *buckets);
+size_t wordBucketsBytes(WordBuckets *buckets);
+int wordBucketsWithin(WordBuckets *buckets, const char *word, int maxDistance,
+                      Suggestion **matches, long long *visited);
+void wordBucketsScan(WordBuckets *buckets, const char *word, SuggestionHeap *heap,
+                     int *sharedLimit);
+int wordBucketsSuggest(WordBuckets *buckets, const char *word, Suggestion *best, int count);
+
+#endif
@@ -0,0 +1,264 @@
+#include "wordSort.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+
+// Below this many words, sorting is not worth starting threads for.
+#define PARALLEL_SORT_THRESHOLD 100000
+#define INSERTION_SORT_THRESHOLD 16
+
+/**
+ * Gathers all links of the map into a dense array.
+ * @param map
+ * @param size Set to the number of words.
+ * @return The allocated array.
+ */
+WordCount *wordCountsFromMap(HashMap *map, int *size)
+{
+    assert(map != NULL);
+    WordCount *words = malloc(sizeof(WordCount) * (hashMapSize(map) + 1));
+    int n = 0;
+    for (int i = 0; i < hashMapCapacity(map); i++)
+    {
+        for (HashLink *link = map->table[i]; link != NULL; link = link->next)
+        {
+            words[n].word = link->key;
+            words[n].count = link->value;
+            n++;
+        }
+    }
+    *size = n;
+    return words;
+}
+
+static void swap(WordCount *words, int i, int j)
+{
+    WordCount temp = words[i];
+    words[i] = words[j];
+    words[j] = temp;
+}
+
+static int charAt(const WordCount *word, int depth)
+{
+    return (unsigned char)word->word[depth];
+}
+
+/**
+ * Sorts words that share their first depth characters with multikey
+ * quicksort: a three-way partition on the character at depth, recursing into
+ * the equal part one character deeper. Each character is compared about
+ * once per level, instead of whole strings per comparison.
+ * @param words
+ * @param size
+ * @param depth
+ */
+static void multikeySort(WordCount *words, int size, int depth)
+{
+    while (size > INSERTION_SORT_THRESHOLD)
+    {
+        // Median of three pivot, moved to the front.
+        int a = charAt(&words[0], depth);
+        int b = charAt(&words[size / 2], depth);
+        int c = charAt(&words[size - 1], depth);
+        int mid = (a < b) ? (b < c ? size / 2 : (a < c ? size - 1 : 0))
+                          : (a < c ? 0 : (b < c ? size - 1 : size / 2));
+        swap(words, 0, mid);
+        int pivot = charAt(&words[0], depth);
+
+        int lt = 0;
+        int gt = size - 1;
+        int i = 1;
+        while (i <= gt)
+        {
+            int ch = charAt(&words[i], depth);
+            if (ch < pivot)
+            {
+                swap(words, lt++, i++);
+            }
+            else if (ch > pivot)
+            {
+                swap(words, i, gt--);
+            }
+            else
+            {
+                i++;
+            }
+        }
+
+        multikeySort(words, lt, depth);
+        if (pivot != 0)
+        {
+            multikeySort(words + lt, gt - lt + 1, depth + 1);
+        }
+        // Loop on the greater part instead of recursing.
+        words += gt + 1;
+        size -= gt + 1;
+    }
+
+    for (int i = 1; i < size; i++)
+    {
+        WordCount word = words[i];
+        int j = i;
+        while (j > 0 && strcmp(words[j - 1].word + depth, word.word + depth) > 0)
+        {
+            words[j] = words[j - 1];
+            j--;
+        }
+        words[j] = word;
+    }
+}
+
+typedef struct SortQueue SortQueue;
+
+/*
+ * First-character buckets shared by the sorting threads. Each thread takes the
+ * next unsorted bucket until none are left.
+ */
+struct SortQueue
+{
+    WordCount *words;
+    int starts[257];
+    int next;
+    pthread_mutex_t lock;
+};
+
+static void *sortBuckets(void *arg)
+{
+    SortQueue *queue = arg;
+    while (1)
+    {
+        pthread_mutex_lock(&queue->lock);
+        int bucket = queue->next++;
+        pthread_mutex_unlock(&queue->lock);
+        if (bucket >= 256)
+        {
+            return NULL;
+        }
+        int start = queue->starts[bucket];
+        multikeySort(queue->words + start, queue->starts[bucket + 1] - start, 1);
+    }
+}
+
+/**
+ * Sorts words alphabetically (by byte value). Large arrays are first
+ * distributed by their first character with a counting sort, and the buckets
+ * are then sorted by the given number of threads.
+ * @param words
+ * @param size
+ * @param threads
+ */
+void wordSortAlpha(WordCount *words, int size, int threads)
+{
+    if (threads <= 1 || size < PARALLEL_SORT_THRESHOLD)
+    {
+        multikeySort(words, size, 0);
+        return;
+    }
+
+    SortQueue queue;
+    int counts[256] = {0};
+    for (int i = 0; i < size; i++)
+    {
+        counts[charAt(&words[i], 0)]++;
+    }
+    queue.starts[0] = 0;
+    for (int c = 0; c < 256; c++)
+    {
+        queue.starts[c + 1] = queue.starts[c] + counts[c];
+    }
+
+    WordCount *sorted = malloc(sizeof(WordCount) * size);
+    int next[256];
+    memcpy(next, queue.starts, sizeof(next));
+    for (int i = 0; i < size; i++)
+    {
+        sorted[next[charAt(&words[i], 0)]++] = words[i];
+    }
+
+    queue.words = sorted;
+    queue.next = 0;
+    pthread_mutex_init(&queue.lock, NULL);
+    pthread_t *workers = malloc(sizeof(pthread_t) * threads);
+    for (int i = 0; i < threads; i++)
+    {
+        pthread_create(&workers[i], NULL, sortBuckets, &queue);
+    }
+    for (int i = 0; i < threads; i++)
+    {
+        pthread_join(workers[i], NULL);
+    }
+    pthread_mutex_destroy(&queue.lock);
+    free(workers);
+
+    memcpy(words, sorted, sizeof(WordCount) * size);
+    free(sorted);
+}
+
+/**
+ * Sorts words by count, largest first, breaking ties alphabetically. The words
+ * are sorted alphabetically and then by count with a stable LSD radix sort,
+ * one pass per byte of the count, skipping bytes that are equal for all words.
+ * @param words
+ * @param size
+ * @param threads Threads used for the alphabetical pass.
+ */
+void wordSortCount(WordCount *words, int size, int threads)
+{
+    wordSortAlpha(words, size, threads);
+
+    WordCount *buffer = malloc(sizeof(WordCount) * (size + 1));
+    WordCount *from = words;
+    WordCount *to = buffer;
+    for (int shift = 0; shift < 32; shift += 8)
+    {
+        int counts[256] = {0};
+        for (int i = 0; i < size; i++)
+        {
+            // Inverting the digit puts larger counts first.
+            counts[255 - (((unsigned int)from[i].count >> shift) & 0xff)]++;
+        }
+        if (size == 0 || counts[255 - (((unsigned int)from[0].count >> shift) & 0xff)] == size)
+        {
+            continue;
+        }
+
+        int next[256];
+        next[0] = 0;
+        for (int d = 1; d < 256; d++)
+        {
+            next[d] = next[d - 1] + counts[d - 1];
+        }
+        for (int i = 0; i < size; i++)
+        {
+            to[next[255 - (((unsigned int)from[i].count >> shift) & 0xff)]++] = from[i];
+        }
+        WordCount *temp = from;
+        from = to;
+        to = temp;
+    }
+
+    if (from != words)
+    {
+        memcpy(words, from, sizeof(WordCount) * size);
+    }
+    free(buffer);
+}
+
+/**
+ * Writes one "word<TAB>count" line per word.
+ * @param writer
+ * @param words
+ * @param size
+ */
+void wordCountsWrite(Writer *writer, WordCount *words, int size)
+{
+    for (int i = 0; i < size; i++)
+    {
+        writerString(writer, words[i].word, strlen(words[i].word));
+        writerChar(writer, '\t');
+        writerInt(writer, words[i].count);
+        writerChar(writer, '\n');
+    }
+}
@@ -0,0 +1,24 @@
+#ifndef WORD_SORT_H
+#define WORD_SORT_H
+
+#include "hashMap.h"
+#include "writer.h"
+
+typedef struct WordCount WordCount;
+
+/*
+ * A word and its count, gathered from a map into a dense array for sorting.
+ * The word points to the map's key, so the map must outlive the array.
+ */
+struct WordCount
+{
+    const char *word;
+    int count;
+};
+
+WordCount *wordCountsFromMap(HashMap *map, int *size);
+void wordSortAlpha(WordCount *words, int size, int threads);
+void wordSortCount(WordCount *words, int size, int threads);
+void wordCountsWrite(Writer *writer, WordCount *words, int size);
+
+#endif
@@ -0,0 +1,145 @@
+#define _POSIX_C_SOURCE 200809L
+#include "writer.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/**
+ * Initializes a writer with a buffer of the given size. Anything already
+ * buffered in the file should be flushed first so output stays in order.
+ * @param writer
+ * @param file
+ * @param capacity Buffer size in bytes.
+ */
+void writerInit(Writer *writer, FILE *file, size_t capacity)
+{
+    assert(writer != NULL);
+    assert(file != NULL);
+    assert(capacity >= 32);
+    writer->file = file;
+    writer->buffer = malloc(capacity);
+    writer->length = 0;
+    writer->capacity = capacity;
+}
+
+/**
+ * Flushes the remaining output and frees the buffer. Does not close the file.
+ * @param writer
+ */
+void writerCleanUp(Writer *writer)
+{
+    writerFlush(writer);
+    free(writer->buffer);
+    writer->buffer = NULL;
+}
+
+/**
+ * Writes the buffered output to the file.
+ * @param writer
+ */
+void writerFlush(Writer *writer)
+{
+    if (writer->length > 0)
+    {
+        fwrite(writer->buffer, 1, writer->length, writer->file);
+        writer->length = 0;
+    }
+    fflush(writer->file);
+}
+
+/**
+ * Appends a string of the given length.
+ * @param writer
+ * @param string
+ * @param length
+ */
+void writerString(Writer *writer, const char *string, size_t length)
+{
+    if (writer->length + length > writer->capacity)
+    {
+        writerFlush(writer);
+        if (length > writer->capacity)
+        {
+            fwrite(string, 1, length, writer->file);
+            return;
+        }
+    }
+    memcpy(writer->buffer + writer->length, string, length);
+    writer->length += length;
+}
+
+/**
+ * Appends a single character.
+ * @param writer
+ * @param c
+ */
+void writerChar(Writer *writer, char c)
+{
+    if (writer->length == writer->capacity)
+    {
+        writerFlush(writer);
+    }
+    writer->buffer[writer->length++] = c;
+}
+
+/**
+ * Appends the decimal representation of an integer.
+ * @param writer
+ * @param value
+ */
+void writerInt(Writer *writer, long long value)
+{
+    char digits[24];
+    int i = sizeof(digits);
+    unsigned long long magnitude = value < 0 ? 0ULL - (unsigned long long)value
+                                             : (unsigned long long)value;
+    do
+    {
+        digits[--i] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+    if (value < 0)
+    {
+        digits[--i] = '-';
+    }
+    writerString(writer, digits + i, sizeof(digits) - i);
+}
+
+/**
+ * Renames a file written and flushed to disk over the target, then flushes
+ * the directory of the target so that the rename itself survives a crash.
+ * @param temporary
+ * @param path
+ * @return 1 on success, 0 on failure.
+ */
+int writerReplaceFile(const char *temporary, const char *path)
+{
+    if (rename(temporary, path) != 0)
+    {
+        return 0;
+    }
+    const char *slash = strrchr(path, '/');
+    size_t length = slash == NULL ? 0 : slash == path ? 1 : (size_t)(slash - path);
+    char *directory = malloc(length + 2);
+    if (length == 0)
+    {
+        strcpy(directory, ".");
+    }
+    else
+    {
+        memcpy(directory, path, length);
+        directory[length] = '\0';
+    }
+    int fd = open(directory, O_RDONLY);
+    free(directory);
+    if (fd < 0)
+    {
+        return 0;
+    }
+    int ok = fsync(fd) == 0;
+    ok = close(fd) == 0 && ok;
+    return ok;
+}
@@ -0,0 +1,31 @@
+#ifndef WRITER_H
+#define WRITER_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+#define WRITER_BUFFER_SIZE (1 << 20)
+
+typedef struct Writer Writer;
+
+/*
+ * Collects output in a large buffer and writes it to a file in big chunks,
+ * avoiding the per-call overhead of printf for line-oriented output.
+ */
+struct Writer
+{
+    FILE *file;
+    char *buffer;
+    size_t length;
+    size_t capacity;
+};
+
+void writerInit(Writer *writer, FILE *file, size_t capacity);
+void writerCleanUp(Writer *writer);
+void writerFlush(Writer *writer);
+void writerString(Writer *writer, const char *string, size_t length);
+void writerChar(Writer *writer, char c);
+void writerInt(Writer *writer, long long value);
+int writerReplaceFile(const char *temporary, const char *path);
+
+#endif